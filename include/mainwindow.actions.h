@@ -36,6 +36,8 @@ private:
     NativeExecutive::CReadWriteLock *lockActionQueue;
     NativeExecutive::CCondVar *condHasActions;
 
+    bool isTerminating;
+
     struct actionToken
     {
         actionRuntime_t cb;
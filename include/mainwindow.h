@@ -125,6 +125,8 @@ extern CFileTranslator *sysAppRoot;
 
 #define _FEATURES_NOT_IN_CURRENT_RELEASE
 
+struct txdLoadAction;
+
 class MainWindow : public QMainWindow, public magicTextLocalizationItem
 {
     friend class TexAddDialog;
@@ -158,10 +160,14 @@ private:
     void dropEvent( QDropEvent *evt ) override;
 
 public:
-    bool openTxdFile(QString fileName, bool silent = false);
+    // Loads the TXD in the background and makes it current once it is loaded.
+    // A newer request cancels the load that is still running.
+    void openTxdFile(QString fileName, bool silent = false);
+    void cancelTxdLoading(void);
     void setCurrentTXD(rw::TexDictionary *txdObj);
     rw::TexDictionary* getCurrentTXD(void)              { return this->currentTXD; }
     void updateTextureList(bool selectLastItemInList);
+    void addTextureToList(rw::TextureBase *texHandle);
 
     void updateFriendlyIcons();
 
@@ -181,6 +187,7 @@ public:
     void clearViewImage(void);
 
     rw::Interface* GetEngine(void) { return this->rwEngine; }
+    MagicActionSystem* GetActionSystem(void) { return this->actionSystem; }
 
     QString GetCurrentPlatform();
 
@@ -238,7 +245,7 @@ public slots:
     void onOpenFile(bool checked);
     void onCloseCurrent(bool checked);
 
-    void onTextureItemChanged(QListWidgetItem *texInfoItem, QListWidgetItem *prevTexInfoItem);
+    void onTextureItemChanged(const QModelIndex& texInfoIndex, const QModelIndex& prevTexInfoIndex);
 
     void onToggleShowFullImage(bool checked);
     void onToggleShowMipmapLayers(bool checked);
@@ -305,7 +312,7 @@ private:
     rw::Interface *rwEngine;
     rw::TexDictionary *currentTXD;
 
-    TexInfoWidget *currentSelectedTexture;
+    TexInfoItem *currentSelectedTexture;
 
     QFileInfo openedTXDFileInfo;
     bool hasOpenedTXDFileInfo;
@@ -319,7 +326,8 @@ private:
 
     QString recommendedTxdPlatform;
 
-    QListWidget *textureListWidget;
+    QListView *textureListView;
+    TexInfoModel *textureListModel;
 
     TexViewportWidget *imageView; // we handle full 2d-viewport as a scroll-area
     QLabel *imageWidget;    // we use label to put image on it
@@ -415,7 +423,17 @@ private:
         void ReportException( const std::exception& except ) override;
         void ReportException( const rw::RwException& except ) override;
     };
-    // TODO: actually use EditorActionSystem to spawn parallel tasks to GUI activity.
+    EditorActionSystem *actionSystem;
+
+    // TXD loads that have not finished yet; only the current one is wanted.
+    std::list <txdLoadAction*> txdLoads;
+    txdLoadAction *currentTxdLoad;
+    class QProgressDialog *txdLoadProgressDlg;
+
+    void finishTxdLoading( txdLoadAction *action );
+    void shutdownTxdLoading( void );
+
+    void customEvent( QEvent *evt ) override;
 
     // REMEMBER TO DELETE EVERY WIDGET THAT DEPENDS ON MAINWINDOW INSIDE OF MAINWINDOW DESTRUCTOR.
     // OTHERWISE THE EDITOR COULD CRASH.
@@ -43,6 +43,7 @@ private:
     QComboBox *selGameBox;
     QCheckBox *propGenMipmaps;
     MagicLineEdit *propGenMipmapsMax;
+    MagicLineEdit *editMemoryBudget;
     QCheckBox *propCompressTextures;
     MagicLineEdit *editCompressionQuality;
     QCheckBox *propPalettizeTextures;
@@ -30,6 +30,7 @@ public:
 
 public slots:
     void OnRequestConvert( bool checked );
+    void OnRequestDryRun( bool checked );
     void OnRequestCancel( bool checked );
 
 protected:
@@ -52,14 +53,21 @@ private:
     QCheckBox *propCompressTextures;
     QCheckBox *propReconstructIMG;
     QCheckBox *propCompressedIMG;
+    MagicLineEdit *editMemoryBudget;
 
     ProgressLogEdit logEditControl;
 
     QPushButton *buttonConvert;
+    QPushButton *buttonDryRun;
+
+    void startConversionThread( bool isDryRun );
 
 public:
     volatile rw::thread_t conversionThread;
 
+    // Only estimate the conversion instead of running it.
+    bool isDryRun;
+
     rw::rwlock *volatile convConsistencyLock;
 
     RwListEntry <MassConvertWindow> node;
@@ -37,6 +37,8 @@ private:
     QRadioButton *optionExportPlain;
     QRadioButton *optionExportTXDName;
     QRadioButton *optionExportFolders;
+    MagicLineEdit *editMemoryBudget;
+    QCheckBox *propUseScanIndex;
 
     RwListEntry <MassExportWindow> node;
 };
@@ -35,4 +35,5 @@ private:
     // Advanced tab.
     QCheckBox *optionDeserWithoutBlocklengths;
     QComboBox *selectWarningLevel;
+    QLineEdit *editMemDecompressLimit;
 };
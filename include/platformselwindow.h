@@ -101,10 +101,11 @@ public slots:
             this->mainWnd->SetTXDPlatformString( currentTXD, ansiSelPlatform.c_str() );
 
             // Update the main window view and texture descriptions.
-            this->mainWnd->updateTextureView();
-
+            // The descriptions go first, since they drop the images of the old platform.
             this->mainWnd->updateAllTextureMetaInfo();
 
+            this->mainWnd->updateTextureView();
+
             // An important change like that should be logged.
             this->mainWnd->txdLog->addLogMessage( QString( "changed TXD platform to " ) + selPlatform );
         }
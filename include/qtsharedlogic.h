@@ -104,6 +104,28 @@ namespace qtshared
         return genMipGroup;
     }
 
+    // Upper limit of decoded texture data of a mass tool, in megabytes.
+    inline QLayout* createMemoryBudgetGroup( QObject *parent, rw::uint32 curBudget, MagicLineEdit*& editBudgetOut )
+    {
+        QHBoxLayout *budgetGroup = new QHBoxLayout();
+
+        budgetGroup->addWidget( CreateLabelL( "Tools.MemBudget" ), 0, Qt::AlignLeft );
+
+        MagicLineEdit *budgetEdit = new MagicLineEdit( QString( "%1" ).arg( curBudget ) );
+
+        QIntValidator *budgetVal = new QIntValidator( 0, 1024 * 1024, parent );
+
+        budgetEdit->setValidator( budgetVal );
+
+        editBudgetOut = budgetEdit;
+
+        budgetEdit->setMaximumWidth( 80 );
+
+        budgetGroup->addWidget( budgetEdit, 0, Qt::AlignRight );
+
+        return budgetGroup;
+    }
+
     inline QLayout* createGameRootInputOutputForm( const rw::rwStaticString <wchar_t>& curGameRoot, const rw::rwStaticString <wchar_t>& curOutputRoot, MagicLineEdit*& editGameRootOut, MagicLineEdit*& editOutputRootOut )
     {
         QFormLayout *basicPathForm = new QFormLayout();
@@ -15,7 +15,7 @@ private:
     QComboBox* createFilterBox( void ) const;
 
 public:
-    RenderPropWindow( MainWindow *mainWnd, TexInfoWidget *texInfo );
+    RenderPropWindow( MainWindow *mainWnd, TexInfoItem *texInfo );
     ~RenderPropWindow( void );
 
     void updateContent( MainWindow *mainWnd ) override;
@@ -34,7 +34,7 @@ private:
 
     MainWindow *mainWnd;
 
-    TexInfoWidget *texInfo;
+    TexInfoItem *texInfo;
 
     QPushButton *buttonSet;
     QComboBox *filterComboBox;
@@ -10,7 +10,7 @@
 
 struct TexResizeWindow : public QDialog, public magicTextLocalizationItem
 {
-    inline TexResizeWindow( MainWindow *mainWnd, TexInfoWidget *texInfo ) : QDialog( mainWnd )
+    inline TexResizeWindow( MainWindow *mainWnd, TexInfoItem *texInfo ) : QDialog( mainWnd )
     {
         this->setWindowFlags( this->windowFlags() & ~Qt::WindowContextHelpButtonHint );
 
@@ -120,7 +120,7 @@ public slots:
         // Do the resize.
         bool shouldClose = true;
 
-        if ( TexInfoWidget *texInfo = this->texInfo )
+        if ( TexInfoItem *texInfo = this->texInfo )
         {
             if ( rw::TextureBase *texHandle = texInfo->GetTextureHandle() )
             {
@@ -164,9 +164,10 @@ public slots:
                             this->mainWnd->NotifyChange();
 
                             // Since we succeeded, we should update the view and things.
-                            this->mainWnd->updateTextureView();
-
+                            // The texture info has to know about the change before the view asks for the image.
                             texInfo->updateInfo();
+
+                            this->mainWnd->updateTextureView();
                         }
                     }
                 }
@@ -190,7 +191,7 @@ private:
         // Only allow setting if we have a width and height, whose values are different from the original.
         bool allowSet = true;
 
-        if ( TexInfoWidget *texInfo = this->texInfo )
+        if ( TexInfoItem *texInfo = this->texInfo )
         {
             if ( rw::TextureBase *texHandle = texInfo->GetTextureHandle() )
             {
@@ -259,7 +260,7 @@ private:
 
     MainWindow *mainWnd;
 
-    TexInfoWidget *texInfo;
+    TexInfoItem *texInfo;
 
     QPushButton *buttonSet;
     MagicLineEdit *widthEdit;
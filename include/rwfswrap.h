@@ -3,6 +3,31 @@
 
 CFile* RawOpenGlobalFile( CFileSystem *fileSys, const filePath& path, const filePath& mode );
 
+// The RW stream reads ahead in a window of the given size, which is 64KB by default;
+// zero passes every access straight to the CFile. Writes are passed straight through,
+// so that the writer sees every failure.
+// The CFile has to be left alone while the RW stream exists.
 rw::Stream* RwStreamCreateTranslated( rw::Interface *rwEngine, CFile *stream );
+rw::Stream* RwStreamCreateTranslated( rw::Interface *rwEngine, CFile *stream, size_t bufferSize );
+
+// For writing whole files: the window is sized to the expected output, up to 4MB, and
+// written out at block-aligned offsets. If preallocate is set and the output does not
+// fit into one window, an empty CFile is grown to the expected size up front and cut to
+// what was written when the RW stream is destroyed. The last window is written when the RW stream is destroyed; writeFailedOut
+// is set if that fails, so it has to outlive the RW stream.
+rw::Stream* RwStreamCreateOutput( rw::Interface *rwEngine, CFile *stream, rw::uint64 expectedSize, bool preallocate, bool& writeFailedOut );
+
+// Reads the whole CFile through a memory mapping, so that its bytes are not copied
+// through the read path. Returns nullptr if the CFile cannot be mapped; then use a
+// translated stream instead. The RW stream is read-only.
+rw::Stream* RwStreamCreateMapped( rw::Interface *rwEngine, CFile *stream );
+
+// Run after every read of a reader stream with the new position and the size of the
+// stream. It may throw to abort the reader.
+typedef void (*rwStreamReadCallback_t)( rw::int64 streamPos, rw::int64 streamSize, void *ud );
+
+// Reads the whole CFile through a mapping if possible and through a translated stream
+// otherwise, and reports the progress to readCB.
+rw::Stream* RwStreamCreateReader( rw::Interface *rwEngine, CFile *stream, rwStreamReadCallback_t readCB, void *ud );
 
 #endif //_RENDERWARE_FILESYSTEM_STREAM_WRAP_
\ No newline at end of file
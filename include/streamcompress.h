@@ -1,15 +1,53 @@
 #pragma once
 
+#include <vector>
+
 struct compressionProvider abstract
 {
     virtual bool        Decompress( CFile *inputStream, CFile *outputStream ) = 0;
     virtual bool        Compress( CFile *inputStream, CFile *outputStream ) = 0;
 };
 
+// Magic bytes at the start of a compressed stream.
+// Bytes whose mask is zero are not compared; a null mask compares all bytes.
+struct compressionSignature
+{
+    size_t offset;
+    size_t length;
+    const unsigned char *magic;
+    const unsigned char *mask;
+};
+
 struct compressionManager abstract
 {
+    // Short name of the format, like "LZO".
+    virtual const char* GetName( void ) const = 0;
+
     virtual bool        IsStreamCompressed( CFile *stream ) const = 0;
 
+    // Managers that declare signatures are only asked about streams that match one of them.
+    // Streams are read only once to check all signatures, so this should be preferred.
+    virtual size_t      GetSignatures( const compressionSignature*& signaturesOut ) const
+    {
+        signaturesOut = nullptr;
+        return 0;
+    }
+
+    // Managers can decode while the stream is being read, so that big payloads do not have to
+    // be decompressed in full before the first byte is available.
+    // On success the returned stream takes over the compressed stream.
+    virtual CFile*      OpenDecompressionStream( CFile *compressed )
+    {
+        return nullptr;
+    }
+
+    // Managers whose format stores the size of the decompressed payload return it here.
+    // The stream is at its start; its position does not have to be restored.
+    virtual bool        GetDecompressedSize( CFile *compressed, fsOffsetNumber_t& sizeOut ) const
+    {
+        return false;
+    }
+
     virtual compressionProvider*    CreateProvider( void ) = 0;
     virtual void                    DestroyProvider( compressionProvider *prov ) = 0;
 };
@@ -17,6 +55,19 @@ struct compressionManager abstract
 // API to decode possibly compressed streams.
 CFile* CreateDecompressedStream( MainWindow *mainWnd, CFile *compressed );
 
+// Compressed streams that decompress up to this size are decoded into memory. Bigger ones are decoded
+// while they are read if their manager supports it, otherwise into a file of the temporary repository.
+// Streams of unknown decompressed size leave memory once they grow past the limit.
+// Zero never decompresses into memory.
+void SetInMemoryDecompressionLimit( MainWindow *mainWnd, size_t maxDecompressedSize );
+size_t GetInMemoryDecompressionLimit( MainWindow *mainWnd );
+
 // Register your own providers.
 bool RegisterStreamCompressionManager( MainWindow *mainWnd, compressionManager *manager );
-bool UnregisterStreamCompressionManager( MainWindow *mainWnd, compressionManager *manager );
\ No newline at end of file
+bool UnregisterStreamCompressionManager( MainWindow *mainWnd, compressionManager *manager );
+
+std::vector <compressionManager*> GetStreamCompressionManagers( MainWindow *mainWnd );
+
+// Runs all registered managers over the TXDs and IMG archives of a corpus directory and writes
+// compression speed, ratio and the overhead of format detection as JSON.
+bool RunStreamCompressionBenchmark( MainWindow *mainWnd, CFileTranslator *corpusRoot, CFile *resultStream, unsigned int iterations );
\ No newline at end of file
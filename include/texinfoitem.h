@@ -1,41 +1,25 @@
 #pragma once
 
-#include <QtWidgets/QLabel>
-#include <QtWidgets/QVBoxLayout>
+#include <QtCore/QAbstractListModel>
+#include <QtWidgets/QStyledItemDelegate>
+#include <QtGui/QPixmap>
 #include "languages.h"
 
-class TexInfoWidget : public QWidget, public magicTextLocalizationItem
-{
-public:
-	TexInfoWidget(QListWidgetItem *listItem, rw::TextureBase *texItem) : QWidget()
-    {
-        QLabel *texName = new QLabel(QString());
-        texName->setFixedHeight(23);
-        texName->setObjectName("label19px");
-        QLabel *texInfo = new QLabel(QString());
-        texInfo->setObjectName("texInfo");
-        QVBoxLayout *layout = new QVBoxLayout();
-        layout->setContentsMargins(5, 4, 0, 5);
-        layout->addWidget(texName);
-        layout->addWidget(texInfo);
-
-        this->texNameLabel = texName;
-        this->texInfoLabel = texInfo;
-        this->rwTextureHandle = texItem;
-        this->listItem = listItem;
+#include <vector>
+#include <list>
 
-        this->updateInfo();
+class TexInfoModel;
+struct texThumbnailAction;
 
-        this->setLayout(layout);
-
-        RegisterTextLocalizationItem( this );
-    }
+// Texture entry of the editor texture list.
+// Dialogs keep it as handle to the texture they work on; it is painted by TexInfoDelegate.
+class TexInfoItem
+{
+    friend class TexInfoModel;
 
-    ~TexInfoWidget( void )
-    {
-        UnregisterTextLocalizationItem( this );
-    }
+    TexInfoItem( TexInfoModel *model, rw::TextureBase *texItem );
 
+public:
     inline void SetTextureHandle( rw::TextureBase *texHandle )
     {
         this->rwTextureHandle = texHandle;
@@ -127,44 +111,117 @@ public:
         return textureInfo;
     }
 
-    inline void updateInfo( void )
-    {
-        // Construct some information about our texture item.
-        if ( rw::TextureBase *texHandle = this->rwTextureHandle )
-        {
-            QString textureInfo;
+    // Call this if the texture has changed.
+    // The text and the thumbnail are made again once the row is painted.
+    void updateInfo( void );
 
-            if ( rw::Raster *rasterInfo = texHandle->GetRaster() )
-            {
-                textureInfo = getDefaultRasterInfoString( rasterInfo );
-            }
+    const QString& GetNameText( void );
+    const QString& GetInfoText( void );
 
-            this->texNameLabel->setText( ansi_to_qt( texHandle->GetName() ) );
-            this->texInfoLabel->setText( textureInfo );
-        }
-        else
-        {
-            this->texNameLabel->setText( getLanguageItemByKey( "Main.TexInfo.NoTex" ) );
-            this->texInfoLabel->setText( getLanguageItemByKey( "Main.TexInfo.Invalid" ) );
-        }
-    }
+    // Removes this item from the texture list and deletes it.
+    void remove( void );
 
-    void updateContent( MainWindow *mainWnd )
-    {
-        this->updateInfo();
-    }
+private:
+    void buildText( void );
+
+    TexInfoModel *model;
+
+    rw::TextureBase *rwTextureHandle;
+
+    bool hasText;
+    QString nameText;
+    QString infoText;
 
-    inline void remove( void )
+    // The thumbnail is made on the action thread of the editor.
+    bool hasThumbnail;
+    bool isThumbnailPending;
+    QPixmap thumbnail;
+};
+
+// Model of the editor texture list.
+// Rows are only described when the view asks for them, so huge TXDs do not cost anything up front.
+class TexInfoModel : public QAbstractListModel, public magicTextLocalizationItem
+{
+public:
+    enum
     {
-        delete this->listItem;
-    }
+        TexInfoRole = Qt::UserRole
+    };
+
+    TexInfoModel( MainWindow *mainWnd, QObject *parent );
+    ~TexInfoModel( void );
+
+    int rowCount( const QModelIndex& parent = QModelIndex() ) const override;
+    QVariant data( const QModelIndex& index, int role = Qt::DisplayRole ) const override;
+
+    // Lists all textures of a TXD, replacing the previous rows.
+    // Pass nullptr to clear the list.
+    void setTextures( rw::TexDictionary *txdObj );
+
+    TexInfoItem* addTexture( rw::TextureBase *texHandle );
+    void removeItem( TexInfoItem *texInfo );
+
+    TexInfoItem* getItem( const QModelIndex& index ) const;
+    QModelIndex getIndex( const TexInfoItem *texInfo ) const;
+
+    // Called when the text of items has to be put together again.
+    void itemChanged( TexInfoItem *texInfo );
+    void allItemsChanged( void );
+
+    // Called when the pixels of all textures may have changed.
+    void allTexturesChanged( void );
+
+    // Images shown in the texture viewport, so that going back to a texture does not decode it again.
+    // They are kept until their texture changes or the memory is needed for more recent ones.
+    bool getViewPixmap( TexInfoItem *texInfo, bool drawMipmapLayers, QPixmap& pixmapOut );
+    void putViewPixmap( TexInfoItem *texInfo, bool drawMipmapLayers, const QPixmap& pixmap );
+
+    void updateContent( MainWindow *mainWnd ) override;
+
+    // Must be called once the action system of the editor is gone.
+    void shutdownThumbnails( void );
+
+protected:
+    void customEvent( QEvent *evt ) override;
 
 private:
-    QLabel *texNameLabel;
-    QLabel *texInfoLabel;
+    void deleteItems( void );
 
-    rw::TextureBase *rwTextureHandle;
+    void requestThumbnail( TexInfoItem *texInfo );
+    void forgetThumbnail( TexInfoItem *texInfo );
+    void launchNextThumbnail( void );
+    void finishThumbnail( texThumbnailAction *action );
 
-public:
-    QListWidgetItem *listItem;
+    void forgetViewPixmaps( TexInfoItem *texInfo );
+
+    MainWindow *mainWnd;
+
+    std::vector <TexInfoItem*> items;
+
+    // Rows that were painted without a thumbnail, most recent first.
+    std::list <TexInfoItem*> pendingThumbnails;
+    texThumbnailAction *runningThumbnail;
+    bool isShutdown;
+
+    struct viewPixmapEntry
+    {
+        TexInfoItem *texInfo;
+        bool drawMipmapLayers;
+        QPixmap pixmap;
+        size_t byteSize;
+    };
+
+    // Most recently used first.
+    std::list <viewPixmapEntry> viewPixmaps;
+    size_t viewPixmapBytes;
 };
+
+// Paints the thumbnail of the texture next to its name and raster info.
+class TexInfoDelegate : public QStyledItemDelegate
+{
+public:
+    using QStyledItemDelegate::QStyledItemDelegate;
+
+    void paint( QPainter *painter, const QStyleOptionViewItem& option, const QModelIndex& index ) const override;
+    QSize sizeHint( const QStyleOptionViewItem& option, const QModelIndex& index ) const override;
+};
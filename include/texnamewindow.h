@@ -6,7 +6,7 @@
 
 struct TexNameWindow : public QDialog, public magicTextLocalizationItem
 {
-    TexNameWindow( MainWindow *mainWnd, TexInfoWidget *texInfo );
+    TexNameWindow( MainWindow *mainWnd, TexInfoItem *texInfo );
     ~TexNameWindow( void );
 
     void updateContent( MainWindow *mainWnd ) override;
@@ -28,7 +28,7 @@ private:
 
     MainWindow *mainWnd;
 
-    TexInfoWidget *texInfo;
+    TexInfoItem *texInfo;
 
     MagicLineEdit *texNameEdit;
 
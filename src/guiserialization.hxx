@@ -12,7 +12,8 @@ enum magic_serializer_ids
     MAGICSERIALIZE_EXPORTALLWINDOW,
     MAGICSERIALIZE_MASSBUILD,
     MAGICSERIALIZE_LANGUAGE,
-    MAGICSERIALIZE_HELPERRUNTIME
+    MAGICSERIALIZE_HELPERRUNTIME,
+    MAGICSERIALIZE_STREAMCOMPRESS
 };
 
 // Our string blocks.
@@ -22,6 +22,8 @@ Q_IMPORT_PLUGIN(QGifPlugin)
 
 #include <QtGui/QImageWriter>
 
+#include "qtrwutils.hxx"
+
 struct ScopedSystemEventFilter
 {
     inline ScopedSystemEventFilter(QObject *receiver, QEvent *evt)
@@ -141,6 +143,8 @@ extern void InitializeExportAllWindowSerialization( void );
 extern void InitializeMassconvToolEnvironment(void);
 extern void InitializeMassExportToolEnvironment( void );
 extern void InitializeMassBuildEnvironment( void );
+extern void InitializeToolMemoryBudgetEnv( void );
+extern void InitializeToolTraceEnv( void );
 extern void InitializeGUISerialization(void);
 extern void InitializeStreamCompressionEnvironment( void );
 
@@ -153,6 +157,101 @@ static void important_message( const char *msg, const char *title )
 #endif //CROSS PLATFORM CODE
 }
 
+// magictxd --codec-benchmark <corpus directory> [<result file>] [<iterations>]
+static int runCodecBenchmark( MainWindow *mainWnd, const QStringList& args )
+{
+    QString corpusPath = QFileInfo( args.at( 2 ) ).absoluteFilePath() + '/';
+    QString resultPath = QFileInfo( args.size() >= 4 ? args.at( 3 ) : QString( "codec_benchmark.json" ) ).absoluteFilePath();
+    unsigned int iterations = ( args.size() >= 5 ? args.at( 4 ).toUInt() : 3 );
+
+    CFileTranslator *corpusRoot = mainWnd->fileSystem->CreateTranslator( qt_to_filePath( corpusPath ) );
+
+    if ( corpusRoot == nullptr )
+    {
+        important_message( "could not open the corpus directory", "Codec Benchmark" );
+        return -1;
+    }
+
+    bool success = false;
+
+    try
+    {
+        CFile *resultStream = fileRoot->Open( qt_to_filePath( resultPath ), L"wb" );
+
+        if ( resultStream )
+        {
+            try
+            {
+                success = RunStreamCompressionBenchmark( mainWnd, corpusRoot, resultStream, iterations );
+            }
+            catch( ... )
+            {
+                delete resultStream;
+
+                throw;
+            }
+
+            delete resultStream;
+        }
+    }
+    catch( ... )
+    {
+        delete corpusRoot;
+
+        throw;
+    }
+
+    delete corpusRoot;
+
+    return ( success ? 0 : -1 );
+}
+
+// magictxd --pixel-benchmark [<result file>] [<iterations>]
+static int runPixelBenchmark( MainWindow *mainWnd, const QStringList& args )
+{
+    QString resultPath = QFileInfo( args.size() >= 3 ? args.at( 2 ) : QString( "pixel_benchmark.json" ) ).absoluteFilePath();
+    unsigned int iterations = ( args.size() >= 4 ? args.at( 3 ).toUInt() : 10 );
+
+    bool success = false;
+
+    CFile *resultStream = fileRoot->Open( qt_to_filePath( resultPath ), L"wb" );
+
+    if ( resultStream )
+    {
+        try
+        {
+            success = RunBitmapConversionBenchmark( mainWnd->GetEngine(), resultStream, iterations );
+        }
+        catch( ... )
+        {
+            delete resultStream;
+
+            throw;
+        }
+
+        delete resultStream;
+    }
+
+    return ( success ? 0 : -1 );
+}
+
+// Modes of the command line that run a tool instead of the editor.
+static bool isCommandLineToolRequested( const QStringList& args )
+{
+    return ( ( args.size() >= 3 && args.at( 1 ) == "--codec-benchmark" ) ||
+             ( args.size() >= 2 && args.at( 1 ) == "--pixel-benchmark" ) );
+}
+
+static int runCommandLineTool( MainWindow *mainWnd, const QStringList& args )
+{
+    if ( args.at( 1 ) == "--codec-benchmark" )
+    {
+        return runCodecBenchmark( mainWnd, args );
+    }
+
+    return runPixelBenchmark( mainWnd, args );
+}
+
 // Global app-root-only system file translator.
 CFileTranslator *sysAppRoot = nullptr;
 
@@ -171,8 +270,10 @@ int main(int argc, char *argv[])
     InitializeMassconvToolEnvironment();
     InitializeMassExportToolEnvironment();
     InitializeMassBuildEnvironment();
-    InitializeGUISerialization();
+    InitializeToolMemoryBudgetEnv();
+    InitializeToolTraceEnv();
     InitializeStreamCompressionEnvironment();
+    InitializeGUISerialization();     // last, so that the configuration is loaded into all of the above
 
     int iRet = -1;
 
@@ -300,6 +401,23 @@ int main(int argc, char *argv[])
                             throw rw::RwException( "Failed to construct the Qt MainWindow" );
                         }
 
+                        // Command line tools run without showing the editor.
+                        QStringList toolargs = a.arguments();
+
+                        if ( isCommandLineToolRequested( toolargs ) )
+                        {
+                            try
+                            {
+                                iRet = runCommandLineTool( w, toolargs );
+                            }
+                            catch( ... )
+                            {
+                                mainWindowFactory.Destroy( memAlloc, w );
+
+                                throw;
+                            }
+                        }
+                        else
                         try
                         {
                             w->setWindowIcon(QIcon(w->makeAppPath("resources/icons/stars.png")));
@@ -6,6 +6,10 @@
 MagicActionSystem::MagicActionSystem( NativeExecutive::CExecutiveManager *natExec )
 {
     this->nativeExec = natExec;
+    this->isTerminating = false;
+
+    this->lockActionQueue = natExec->CreateReadWriteLock();
+    this->condHasActions = natExec->CreateConditionVariable();
 
     // Remember that it is okay to act like a spoiled brat inside of magic-txd and use
     // the lambda version of CreateThread. In realtime-critical code you must never do that
@@ -28,16 +32,23 @@ MagicActionSystem::MagicActionSystem( NativeExecutive::CExecutiveManager *natExe
             {
                 NativeExecutive::CReadWriteWriteContextSafe <> ctxFetchTask( this->lockActionQueue );
 
-                this->condHasActions->Wait( ctxFetchTask );
+                // Actions may have been launched before we got here.
+                while ( this->isTerminating == false && this->actionQueue.empty() )
+                {
+                    this->condHasActions->Wait( ctxFetchTask );
+                }
 
-                if ( this->actionQueue.empty() == false )
+                if ( this->isTerminating )
                 {
-                    token = std::move( this->actionQueue.back() );
+                    break;
+                }
 
-                    this->actionQueue.pop_back();
+                // Actions are run in the order they were launched.
+                token = std::move( this->actionQueue.front() );
 
-                    hasActionToken = true;
-                }
+                this->actionQueue.pop_front();
+
+                hasActionToken = true;
             }
 
             // If we have an action, we perform it!
@@ -91,6 +102,15 @@ MagicActionSystem::~MagicActionSystem( void )
     NativeExecutive::CExecutiveManager *nativeExec = this->nativeExec;
 
     // Terminate the sheduler.
+    // A running action is interrupted at its next hazard check; queued ones are dropped.
+    {
+        NativeExecutive::CReadWriteWriteContext <> ctxTerminate( this->lockActionQueue );
+
+        this->isTerminating = true;
+
+        this->condHasActions->Signal();
+    }
+
     NativeExecutive::CExecThread *shedThread = this->shedulerThread;
 
     shedThread->Terminate( true );
@@ -98,6 +118,9 @@ MagicActionSystem::~MagicActionSystem( void )
     nativeExec->CloseThread( shedThread );
 
     this->shedulerThread = NULL;
+
+    nativeExec->CloseConditionVariable( this->condHasActions );
+    nativeExec->CloseReadWriteLock( this->lockActionQueue );
 }
 
 void MagicActionSystem::LaunchAction( actionRuntime_t cb, void *ud )
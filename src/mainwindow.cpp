@@ -6,6 +6,7 @@
 #include <QtWidgets/qsplitter.h>
 #include <QtGui/qmovie.h>
 #include <QtWidgets/QFileDialog>
+#include <QtWidgets/QProgressDialog>
 #include <QtCore/QDir>
 #include <QtGui/QDesktopServices>
 #include <QtGui/qdrag.h>
@@ -14,6 +15,8 @@
 #include <QtGui/QDropEvent>
 #include <QtCore/qmimedata.h>
 
+#include <atomic>
+
 #include "styles.h"
 #include "rwversiondialog.h"
 #include "texnamewindow.h"
@@ -92,6 +95,10 @@ MainWindow::MainWindow(QString appPath, rw::Interface *engineInterface, CFileSys
 
     this->hasOpenedTXDFileInfo = false;
 
+    this->actionSystem = nullptr;
+    this->currentTxdLoad = nullptr;
+    this->txdLoadProgressDlg = nullptr;
+
     this->rwEngine = engineInterface;
 
     // Set-up the warning manager.
@@ -101,6 +108,9 @@ MainWindow::MainWindow(QString appPath, rw::Interface *engineInterface, CFileSys
 
     try
     {
+        // Long operations like loading of TXDs run on this.
+        this->actionSystem = new EditorActionSystem( this );
+
 	    /* --- Window --- */
         updateWindowTitle();
         //setMinimumSize(620, 300);
@@ -115,16 +125,23 @@ MainWindow::MainWindow(QString appPath, rw::Interface *engineInterface, CFileSys
 	    this->txdLog = new TxdLog(this, this->m_appPath, this);
 
 	    /* --- List --- */
-	    QListWidget *listWidget = new QListWidget();
-	    listWidget->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
-		//listWidget->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
-        listWidget->setMaximumWidth(350);
-	    //listWidget->setSelectionMode(QAbstractItemView::ExtendedSelection);
+        // We will store all our texture names in this.
+        // Rows are painted on demand, so this stays fast for TXDs with thousands of textures.
+        TexInfoModel *listModel = new TexInfoModel(this, this);
 
-        connect( listWidget, &QListWidget::currentItemChanged, this, &MainWindow::onTextureItemChanged );
+	    QListView *listView = new QListView();
+	    listView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+		//listView->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+        listView->setMaximumWidth(350);
+        listView->setUniformItemSizes(true);
+	    //listView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+        listView->setItemDelegate(new TexInfoDelegate(listView));
+        listView->setModel(listModel);
 
-        // We will store all our texture names in this.
-        this->textureListWidget = listWidget;
+        connect( listView->selectionModel(), &QItemSelectionModel::currentChanged, this, &MainWindow::onTextureItemChanged );
+
+        this->textureListView = listView;
+        this->textureListModel = listModel;
 
 	    /* --- Viewport --- */
 		imageView = new TexViewportWidget(this);
@@ -138,7 +155,7 @@ MainWindow::MainWindow(QString appPath, rw::Interface *engineInterface, CFileSys
 
 	    /* --- Splitter --- */
         mainSplitter = new QSplitter;
-	    mainSplitter->addWidget(listWidget);
+	    mainSplitter->addWidget(listView);
 		mainSplitter->addWidget(imageView);
 	    QList<int> sizes;
 	    sizes.push_back(200);
@@ -663,6 +680,8 @@ MainWindow::MainWindow(QString appPath, rw::Interface *engineInterface, CFileSys
     }
     catch( ... )
     {
+        delete this->actionSystem;
+
         rwEngine->SetWarningManager( nullptr );
 
         throw;
@@ -682,6 +701,11 @@ MainWindow::~MainWindow()
 {
     UnregisterTextLocalizationItem( this );
 
+    // Stop any loading before anything that it uses goes away.
+    this->shutdownTxdLoading();
+
+    this->textureListModel->shutdownThumbnails();
+
     // If we have a loaded TXD, get rid of it.
     if ( this->currentTXD )
     {
@@ -830,7 +854,7 @@ void MainWindow::UpdateExportAccessibility( void )
             {
                 try
                 {
-                    if ( TexInfoWidget *curSelTex = this->currentSelectedTexture )
+                    if ( TexInfoItem *curSelTex = this->currentSelectedTexture )
                     {
                         if ( rw::Raster *texRaster = curSelTex->GetTextureHandle()->GetRaster() )
                         {
@@ -1035,12 +1059,10 @@ void MainWindow::dropEvent( QDropEvent *evt )
                     // * TXD file?
                     if ( extention.equals( L"TXD", false ) )
                     {
-                        bool loadedTXD = this->openTxdFile( qtPath, false );
+                        // It is loaded in the background.
+                        this->openTxdFile( qtPath, false );
 
-                        if ( loadedTXD )
-                        {
-                            hasHandledFile = true;
-                        }
+                        hasHandledFile = true;
                     }
 
                     if ( !hasHandledFile )
@@ -1164,7 +1186,7 @@ void MainWindow::setCurrentTXD( rw::TexDictionary *txdObj )
         this->ClearModifiedState();
 
         // Clear anything in the GUI that represented the previous TXD.
-        this->textureListWidget->clear();
+        this->textureListModel->setTextures( nullptr );
     }
 
     if ( txdObj != nullptr )
@@ -1182,37 +1204,30 @@ void MainWindow::updateTextureList( bool selectLastItemInList )
 {
     rw::TexDictionary *txdObj = this->currentTXD;
 
-    QListWidget *listWidget = this->textureListWidget;
-
-    listWidget->clear();
+    TexInfoModel *listModel = this->textureListModel;
 
     // We have no more selected texture item.
     this->currentSelectedTexture = nullptr;
 
     // this->hideFriendlyIcons();
 
-    if ( txdObj )
-    {
-        TexInfoWidget *texInfoToSelect = nullptr;
+    listModel->setTextures( txdObj );
 
-	    for ( rw::TexDictionary::texIter_t iter( txdObj->GetTextureIterator() ); iter.IsEnd() == false; iter.Increment() )
-	    {
-            rw::TextureBase *texItem = iter.Resolve();
+    int rowCount = listModel->rowCount();
 
-	        QListWidgetItem *item = new QListWidgetItem;
-	        listWidget->addItem(item);
-            TexInfoWidget *texInfoWidget = new TexInfoWidget(item, texItem);
-	        listWidget->setItemWidget(item, texInfoWidget);
-		    item->setSizeHint(QSize(listWidget->sizeHintForColumn(0), 54));
+    if ( rowCount > 0 )
+    {
+	    // select first or last item in a list
+        this->textureListView->setCurrentIndex( listModel->index( selectLastItemInList ? rowCount - 1 : 0 ) );
+    }
+}
 
-		    // select first or last item in a list
-		    if (!texInfoToSelect || selectLastItemInList)
-                texInfoToSelect = texInfoWidget;
-	    }
+void MainWindow::addTextureToList( rw::TextureBase *texHandle )
+{
+    // Only the new row has to be described, the others stay as they are.
+    TexInfoItem *texInfo = this->textureListModel->addTexture( texHandle );
 
-        if (texInfoToSelect)
-            listWidget->setCurrentItem(texInfoToSelect->listItem);
-    }
+    this->textureListView->setCurrentIndex( this->textureListModel->getIndex( texInfo ) );
 }
 
 void MainWindow::updateWindowTitle( void )
@@ -1301,7 +1316,7 @@ void MainWindow::updateWindowTitle( void )
 
 void MainWindow::updateTextureMetaInfo( void )
 {
-    if ( TexInfoWidget *infoWidget = this->currentSelectedTexture )
+    if ( TexInfoItem *infoWidget = this->currentSelectedTexture )
     {
         // Update it.
         infoWidget->updateInfo();
@@ -1313,21 +1328,9 @@ void MainWindow::updateTextureMetaInfo( void )
 
 void MainWindow::updateAllTextureMetaInfo( void )
 {
-    QListWidget *textureList = this->textureListWidget;
-
-    int rowCount = textureList->count();
-
-    for ( int row = 0; row < rowCount; row++ )
-    {
-        QListWidgetItem *item = textureList->item( row );
-
-        TexInfoWidget *texInfo = dynamic_cast <TexInfoWidget*> ( textureList->itemWidget( item ) );
-
-        if ( texInfo )
-        {
-            texInfo->updateInfo();
-        }
-    }
+    // The visible rows are described again once they are painted.
+    this->textureListModel->allItemsChanged();
+    this->textureListModel->allTexturesChanged();
 
     // Make sure we update exportability.
     this->UpdateExportAccessibility();
@@ -1366,114 +1369,378 @@ static CFile* OpenGlobalFile( MainWindow *mainWnd, const filePath& path, const f
     return theFile;
 }
 
-bool MainWindow::openTxdFile(QString fileName, bool silent)
+// Loading of a TXD on the action thread of the editor.
+struct txdLoadAction
 {
-    bool success = false;
+    inline txdLoadAction( MainWindow *mainWnd, QString fileName, bool silent ) : isCancelled( false )
+    {
+        this->mainWnd = mainWnd;
+        this->fileName = std::move( fileName );
+        this->silent = silent;
+        this->lastPercent = -1;
+        this->loadedTXD = nullptr;
+    }
 
-    if ( !silent )
+    MainWindow *mainWnd;
+    QString fileName;
+    bool silent;
+
+    // Set by the GUI thread; the reader gives up at its next read.
+    std::atomic <bool> isCancelled;
+
+    int lastPercent;
+
+    // Results for the GUI thread, once the action has finished.
+    struct warningBuffer : public rw::WarningManagerInterface
     {
-        this->txdLog->beforeTxdLoading();
+        void OnWarning( rw::rwStaticString <char>&& msg ) override
+        {
+            this->messages.push_back( ansi_to_qt( msg ) );
+        }
+
+        std::vector <QString> messages;
+    };
+
+    warningBuffer warnings;
+
+    rw::TexDictionary *loadedTXD;
+    QString errorMessage;
+    QString foundObjectType;
+};
+
+struct txdLoadProgressEvent : public QEvent
+{
+    inline txdLoadProgressEvent( txdLoadAction *action, int percent ) : QEvent( QEvent::User )
+    {
+        this->action = action;
+        this->percent = percent;
     }
 
-    if (fileName.length() != 0)
+    txdLoadAction *action;
+    int percent;
+};
+
+struct txdLoadFinishEvent : public QEvent
+{
+    inline txdLoadFinishEvent( txdLoadAction *action ) : QEvent( QEvent::User )
     {
-        // We got a file name, try to load that TXD file into our editor.
-        std::wstring unicodeFileName = fileName.toStdWString();
+        this->action = action;
+    }
 
-        CFile *fileStream = OpenGlobalFile( this, unicodeFileName.c_str(), L"rb" );
+    txdLoadAction *action;
+};
 
-        if ( fileStream )
-        {
-            try
-            {
-                rw::Stream *txdFileStream = RwStreamCreateTranslated( this->rwEngine, fileStream );
+static void txdLoadReadCallback( rw::int64 streamPos, rw::int64 streamSize, void *ud )
+{
+    txdLoadAction *action = (txdLoadAction*)ud;
 
-                // If the opening succeeded, process things.
-                if (txdFileStream)
-                {
-                    if ( !silent )
-                    {
-                        this->txdLog->addLogMessage(QString("loading TXD: ") + fileName);
-                    }
+    // Allow the editor to shut down while we load.
+    rw::CheckThreadHazards( action->mainWnd->GetEngine() );
 
-                    // Parse the input file.
-                    rw::RwObject *parsedObject = nullptr;
+    if ( action->isCancelled )
+    {
+        throw rw::RwException( "loading was cancelled" );
+    }
 
-                    try
-                    {
-                        parsedObject = this->rwEngine->Deserialize(txdFileStream);
-                    }
-                    catch (rw::RwException& except)
-                    {
-                        if ( !silent )
-                        {
-                            this->txdLog->showError(QString("failed to load the TXD archive: %1").arg(ansi_to_qt(except.message)));
-                        }
-                    }
+    // The bulk of a TXD are its texture chunks, which are read one by one.
+    if ( streamSize > 0 )
+    {
+        int percent = (int)( ( streamPos * 100 ) / streamSize );
 
-                    if (parsedObject)
-                    {
-                        try
-                        {
-                            // Try to cast it to a TXD. If it fails we did not get a TXD.
-                            rw::TexDictionary *newTXD = rw::ToTexDictionary(this->rwEngine, parsedObject);
+        if ( percent != action->lastPercent )
+        {
+            action->lastPercent = percent;
 
-                            if (newTXD)
-                            {
-                                // Okay, we got a new TXD.
-                                // Set it as our current object in the editor.
-                                this->setCurrentTXD(newTXD);
+            QCoreApplication::postEvent( action->mainWnd, new txdLoadProgressEvent( action, percent ) );
+        }
+    }
+}
 
-                                this->setCurrentFilePath(fileName);
+static void loadTxdForAction( txdLoadAction *action )
+{
+    MainWindow *mainWnd = action->mainWnd;
 
-                                this->updateFriendlyIcons();
+    rw::Interface *rwEngine = mainWnd->GetEngine();
 
-                                success = true;
-                            }
-                            else
-                            {
-                                const char *objTypeName = this->rwEngine->GetObjectTypeName(parsedObject);
+    std::wstring unicodeFileName = action->fileName.toStdWString();
 
-                                if ( !silent )
-                                {
-                                    this->txdLog->addLogMessage(QString("found %1 but expected a texture dictionary").arg(objTypeName), LOGMSG_WARNING);
-                                }
+    CFile *fileStream = OpenGlobalFile( mainWnd, unicodeFileName.c_str(), L"rb" );
 
-                                // Get rid of the object that is not a TXD.
-                                this->rwEngine->DeleteRwObject(parsedObject);
-                            }
-                        }
-                        catch( ... )
-                        {
-                            // We failed in some way, so delete the RW object.
-                            this->rwEngine->DeleteRwObject( parsedObject );
+    if ( fileStream == nullptr )
+        return;
 
-                            throw;
-                        }
-                    }
-                    // if parsedObject is NULL, the RenderWare implementation should have error'ed us already.
+    try
+    {
+        rw::Stream *txdFileStream = RwStreamCreateReader( rwEngine, fileStream, txdLoadReadCallback, action );
 
-                    // Remember to close the stream again.
-                    this->rwEngine->DeleteStream(txdFileStream); //Open TXD file...
-                }
+        if ( txdFileStream )
+        {
+            rw::RwObject *parsedObject = nullptr;
+
+            try
+            {
+                parsedObject = rwEngine->Deserialize( txdFileStream );
             }
             catch( ... )
             {
-                delete fileStream;
+                rwEngine->DeleteStream( txdFileStream );
 
                 throw;
             }
 
-            delete fileStream;
+            rwEngine->DeleteStream( txdFileStream );
+
+            if ( parsedObject )
+            {
+                // Try to cast it to a TXD. If it fails we did not get a TXD.
+                if ( rw::TexDictionary *newTXD = rw::ToTexDictionary( rwEngine, parsedObject ) )
+                {
+                    action->loadedTXD = newTXD;
+                }
+                else
+                {
+                    action->foundObjectType = rwEngine->GetObjectTypeName( parsedObject );
+
+                    rwEngine->DeleteRwObject( parsedObject );
+                }
+            }
+        }
+    }
+    catch( ... )
+    {
+        delete fileStream;
+
+        throw;
+    }
+
+    delete fileStream;
+}
+
+static void txdLoadActionRuntime( MagicActionSystem *system, void *ud )
+{
+    txdLoadAction *action = (txdLoadAction*)ud;
+
+    MainWindow *mainWnd = action->mainWnd;
+
+    rw::Interface *rwEngine = mainWnd->GetEngine();
+
+    // Loads that were replaced before it was their turn are skipped.
+    if ( !action->isCancelled )
+    {
+        // The warnings must not reach the GUI from this thread.
+        rw::AssignThreadedRuntimeConfig( rwEngine );
+
+        try
+        {
+            rwEngine->SetWarningManager( &action->warnings );
+
+            try
+            {
+                loadTxdForAction( action );
+            }
+            catch( rw::RwException& except )
+            {
+                action->errorMessage = ansi_to_qt( except.message );
+            }
+            catch( std::exception& except )
+            {
+                action->errorMessage = except.what();
+            }
+        }
+        catch( ... )
+        {
+            rw::ReleaseThreadedRuntimeConfig( rwEngine );
+
+            throw;
         }
+
+        rw::ReleaseThreadedRuntimeConfig( rwEngine );
     }
 
+    QCoreApplication::postEvent( mainWnd, new txdLoadFinishEvent( action ) );
+}
+
+void MainWindow::openTxdFile(QString fileName, bool silent)
+{
+    if ( fileName.length() == 0 )
+        return;
+
+    // Any earlier request is replaced, since we could only show one TXD anyway.
+    this->cancelTxdLoading();
+
     if ( !silent )
     {
-        this->txdLog->afterTxdLoading();
+        this->txdLog->beforeTxdLoading();
+
+        this->txdLog->addLogMessage(QString("loading TXD: ") + fileName);
+    }
+
+    txdLoadAction *action = new txdLoadAction( this, fileName, silent );
+
+    this->txdLoads.push_back( action );
+    this->currentTxdLoad = action;
+
+    // Small TXDs are loaded before the progress shows up.
+    QProgressDialog *progressDlg = new QProgressDialog( this );
+    progressDlg->setWindowModality( Qt::WindowModal );
+    progressDlg->setLabelText( QString("loading TXD: ") + QFileInfo( fileName ).fileName() );
+    progressDlg->setRange( 0, 100 );
+    progressDlg->setMinimumDuration( 500 );
+    progressDlg->setAutoClose( false );
+    progressDlg->setAutoReset( false );
+    progressDlg->setValue( 0 );
+
+    connect( progressDlg, &QProgressDialog::canceled, this,
+        [this]( void )
+    {
+        this->cancelTxdLoading();
+    });
+
+    this->txdLoadProgressDlg = progressDlg;
+
+    this->actionSystem->LaunchAction( txdLoadActionRuntime, action );
+}
+
+void MainWindow::cancelTxdLoading( void )
+{
+    // The action finishes on its own; its result is thrown away then.
+    if ( txdLoadAction *action = this->currentTxdLoad )
+    {
+        action->isCancelled = true;
+
+        this->currentTxdLoad = nullptr;
+
+        // Its messages are in the log already, so show them like a finished load would.
+        if ( !action->silent )
+        {
+            this->txdLog->afterTxdLoading();
+        }
+    }
+
+    if ( QProgressDialog *progressDlg = this->txdLoadProgressDlg )
+    {
+        this->txdLoadProgressDlg = nullptr;
+
+        progressDlg->deleteLater();
+    }
+}
+
+void MainWindow::finishTxdLoading( txdLoadAction *action )
+{
+    this->txdLoads.remove( action );
+
+    rw::TexDictionary *newTXD = action->loadedTXD;
+
+    if ( action == this->currentTxdLoad )
+    {
+        this->currentTxdLoad = nullptr;
+
+        if ( QProgressDialog *progressDlg = this->txdLoadProgressDlg )
+        {
+            this->txdLoadProgressDlg = nullptr;
+
+            progressDlg->deleteLater();
+        }
+
+        bool silent = action->silent;
+
+        for ( const QString& warning : action->warnings.messages )
+        {
+            this->txdLog->addLogMessage( warning, LOGMSG_WARNING );
+        }
+
+        if ( newTXD )
+        {
+            // Okay, we got a new TXD.
+            // Set it as our current object in the editor.
+            this->setCurrentTXD( newTXD );
+
+            this->setCurrentFilePath( action->fileName );
+
+            this->updateFriendlyIcons();
+        }
+        else if ( !silent )
+        {
+            if ( action->errorMessage.isEmpty() == false )
+            {
+                this->txdLog->showError(QString("failed to load the TXD archive: %1").arg(action->errorMessage));
+            }
+            else if ( action->foundObjectType.isEmpty() == false )
+            {
+                this->txdLog->addLogMessage(QString("found %1 but expected a texture dictionary").arg(action->foundObjectType), LOGMSG_WARNING);
+            }
+        }
+
+        if ( !silent )
+        {
+            this->txdLog->afterTxdLoading();
+        }
+    }
+    else if ( newTXD )
+    {
+        // Nobody wants it anymore.
+        this->rwEngine->DeleteRwObject( newTXD );
+    }
+
+    delete action;
+}
+
+void MainWindow::shutdownTxdLoading( void )
+{
+    // We are going away, so nothing should pop up anymore.
+    this->currentTxdLoad = nullptr;
+
+    this->cancelTxdLoading();
+
+    for ( txdLoadAction *action : this->txdLoads )
+    {
+        action->isCancelled = true;
     }
 
-    return success;
+    if ( EditorActionSystem *actionSystem = this->actionSystem )
+    {
+        delete actionSystem;
+
+        this->actionSystem = nullptr;
+    }
+
+    // Loads that did not finish are thrown away with their results.
+    for ( txdLoadAction *action : this->txdLoads )
+    {
+        if ( rw::TexDictionary *loadedTXD = action->loadedTXD )
+        {
+            this->rwEngine->DeleteRwObject( loadedTXD );
+        }
+
+        delete action;
+    }
+
+    this->txdLoads.clear();
+}
+
+void MainWindow::customEvent( QEvent *evt )
+{
+    if ( txdLoadProgressEvent *progressEvt = dynamic_cast <txdLoadProgressEvent*> ( evt ) )
+    {
+        if ( progressEvt->action == this->currentTxdLoad )
+        {
+            if ( QProgressDialog *progressDlg = this->txdLoadProgressDlg )
+            {
+                progressDlg->setValue( progressEvt->percent );
+            }
+        }
+
+        return;
+    }
+
+    if ( txdLoadFinishEvent *finishEvt = dynamic_cast <txdLoadFinishEvent*> ( evt ) )
+    {
+        this->finishTxdLoading( finishEvt->action );
+
+        return;
+    }
+
+    QMainWindow::customEvent( evt );
 }
 
 void MainWindow::onOpenFile( bool checked )
@@ -1512,13 +1779,9 @@ void MainWindow::onCloseCurrent( bool checked )
     });
 }
 
-void MainWindow::onTextureItemChanged(QListWidgetItem *listItem, QListWidgetItem *prevTexInfoItem)
+void MainWindow::onTextureItemChanged(const QModelIndex& texInfoIndex, const QModelIndex& prevTexInfoIndex)
 {
-    QListWidget *texListWidget = this->textureListWidget;
-
-    QWidget *listItemWidget = texListWidget->itemWidget( listItem );
-
-    TexInfoWidget *texItem = dynamic_cast <TexInfoWidget*> ( listItemWidget );
+    TexInfoItem *texItem = this->textureListModel->getItem( texInfoIndex );
 
     this->currentSelectedTexture = texItem;
 
@@ -1538,7 +1801,7 @@ void MainWindow::adjustDimensionsByViewport( void )
 
 void MainWindow::updateTextureView( void )
 {
-    TexInfoWidget *texItem = this->currentSelectedTexture;
+    TexInfoItem *texItem = this->currentSelectedTexture;
 
     if ( texItem != nullptr )
     {
@@ -1549,24 +1812,36 @@ void MainWindow::updateTextureView( void )
 		{
             try
             {
-			    // Get a bitmap to the raster.
-			    // This is a 2D color component surface.
-			    rw::Bitmap rasterBitmap( this->rwEngine, 32, rw::RASTER_8888, rw::COLOR_BGRA );
+                bool drawMipmapLayers = ( this->drawMipmapLayers && rasterData->getMipmapCount() > 1 );
 
-                if ( this->drawMipmapLayers && rasterData->getMipmapCount() > 1 )
-                {
-                    rasterBitmap.setBgColor( 1.0, 1.0, 1.0, 0.0 );
+                QPixmap texPixmap;
 
-                    rw::DebugDrawMipmaps( this->rwEngine, rasterData, rasterBitmap );
-                }
-                else
+                // Textures that were shown recently do not have to be decoded again.
+                if ( !this->textureListModel->getViewPixmap( texItem, drawMipmapLayers, texPixmap ) )
                 {
-                    rasterBitmap = rasterData->getBitmap();
-                }
+			        // Get a bitmap to the raster.
+			        // This is a 2D color component surface.
+			        rw::Bitmap rasterBitmap( this->rwEngine, 32, rw::RASTER_8888, rw::COLOR_BGRA );
+
+                    if ( drawMipmapLayers )
+                    {
+                        rasterBitmap.setBgColor( 1.0, 1.0, 1.0, 0.0 );
+
+                        rw::DebugDrawMipmaps( this->rwEngine, rasterData, rasterBitmap );
+                    }
+                    else
+                    {
+                        rasterBitmap = rasterData->getBitmap();
+                    }
 
-			    QImage texImage = convertRWBitmapToQImage( rasterBitmap );
+			        QImage texImage = convertRWBitmapToQImage( rasterBitmap );
 
-			    imageWidget->setPixmap(QPixmap::fromImage(texImage));
+                    texPixmap = QPixmap::fromImage(texImage);
+
+                    this->textureListModel->putViewPixmap( texItem, drawMipmapLayers, texPixmap );
+                }
+
+			    imageWidget->setPixmap(texPixmap);
                 this->updateTextureViewport();
 			    imageWidget->show();
             }
@@ -1670,7 +1945,7 @@ void MainWindow::onToogleLightTheme(bool checked) {
 void MainWindow::onSetupMipmapLayers( bool checked )
 {
     // We just generate up to the top mipmap level for now.
-    if ( TexInfoWidget *texInfo = this->currentSelectedTexture )
+    if ( TexInfoItem *texInfo = this->currentSelectedTexture )
     {
         rw::TextureBase *texture = texInfo->GetTextureHandle();
 
@@ -1716,7 +1991,7 @@ void MainWindow::onSetupMipmapLayers( bool checked )
 void MainWindow::onClearMipmapLayers( bool checked )
 {
     // Here is a quick way to clear mipmap layers from a texture.
-    if ( TexInfoWidget *texInfo = this->currentSelectedTexture )
+    if ( TexInfoItem *texInfo = this->currentSelectedTexture )
     {
         rw::TextureBase *texture = texInfo->GetTextureHandle();
 
@@ -1769,35 +2044,71 @@ bool MainWindow::saveCurrentTXDAt( QString txdFullPath )
         // We serialize what we have at the location we loaded the TXD from.
         std::wstring unicodeFullPath = txdFullPath.toStdWString();
 
-        rw::streamConstructionFileParamW_t fileOpenParam( unicodeFullPath.c_str() );
-
-        rw::Stream *newTXDStream = this->rwEngine->CreateStream( rw::RWSTREAMTYPE_FILE_W, rw::RWSTREAMMODE_CREATE, &fileOpenParam );
+        // The TXD usually comes out about as big as it was when we loaded it.
+        // Ask before opening, which empties the file.
+        rw::uint64 expectedSize = 0;
 
-        if ( newTXDStream )
+        if ( this->hasOpenedTXDFileInfo )
         {
-            // TODO: add security measures to prevent overwriting a valid TXD with garbage.
+            expectedSize = (rw::uint64)this->openedTXDFileInfo.size();
+        }
 
-            // Write the TXD into it.
+        CFile *targetFile = RawOpenGlobalFile( this->fileSystem, unicodeFullPath.c_str(), L"wb" );
+
+        if ( targetFile )
+        {
             try
             {
-                this->rwEngine->Serialize( currentTXD, newTXDStream );
+                bool writeFailed;
+
+                rw::Stream *newTXDStream = RwStreamCreateOutput( this->rwEngine, targetFile, expectedSize, true, writeFailed );
+
+                if ( newTXDStream )
+                {
+                    // TODO: add security measures to prevent overwriting a valid TXD with garbage.
+
+                    bool hasSerialized = false;
 
-                // Success, so lets update our target filename.
-                this->setCurrentFilePath( txdFullPath );
+                    // Write the TXD into it.
+                    try
+                    {
+                        this->rwEngine->Serialize( currentTXD, newTXDStream );
 
-                // We are no longer modified.
-                this->ClearModifiedState();
+                        hasSerialized = true;
+                    }
+                    catch( rw::RwException& except )
+                    {
+                        this->txdLog->addLogMessage(QString("failed to save the TXD archive: %1").arg(except.message.GetConstString()), LOGMSG_ERROR);
+                    }
 
-                // Tell the runtime about the success :)
-                didSave = true;
+                    // Close the stream, which writes out the rest.
+                    this->rwEngine->DeleteStream( newTXDStream );
+
+                    if ( hasSerialized && writeFailed )
+                    {
+                        this->txdLog->addLogMessage(QString("failed to save the TXD archive: could not write to the file"), LOGMSG_ERROR);
+                    }
+                    else if ( hasSerialized )
+                    {
+                        // Success, so lets update our target filename.
+                        this->setCurrentFilePath( txdFullPath );
+
+                        // We are no longer modified.
+                        this->ClearModifiedState();
+
+                        // Tell the runtime about the success :)
+                        didSave = true;
+                    }
+                }
             }
-            catch( rw::RwException& except )
+            catch( ... )
             {
-				this->txdLog->addLogMessage(QString("failed to save the TXD archive: %1").arg(except.message.GetConstString()), LOGMSG_ERROR);
+                delete targetFile;
+
+                throw;
             }
 
-            // Close the stream.
-            this->rwEngine->DeleteStream( newTXDStream );
+            delete targetFile;
         }
         else
         {
@@ -1897,7 +2208,7 @@ void MainWindow::DefaultTextureAddAndPrepare( rw::TextureBase *newTexture, const
     newTexture->AddToDictionary( currentTXD );
 
     // Update the texture list.
-    this->updateTextureList(true);
+    this->addTextureToList( newTexture );
 
     // We have modified the TXD.
     this->NotifyChange();
@@ -1917,7 +2228,7 @@ void MainWindow::DoAddTexture( const TexAddDialog::texAddOperation& params )
         texHandle->AddToDictionary( this->currentTXD );
 
         // Update the texture list.
-        this->updateTextureList(true);
+        this->addTextureToList( texHandle );
 
         this->NotifyChange();
     }
@@ -2180,7 +2491,7 @@ void MainWindow::onReplaceTexture( bool checked )
     // (name, addressing mode, etc) but different raster properties (maybe).
 
     // We need to have a texture selected to replace.
-    if ( TexInfoWidget *curSelTexItem = this->currentSelectedTexture )
+    if ( TexInfoItem *curSelTexItem = this->currentSelectedTexture )
     {
         QString overwriteTexName = ansi_to_qt( curSelTexItem->GetTextureHandle()->GetName() );
 
@@ -2255,7 +2566,7 @@ void MainWindow::onRemoveTexture( bool checked )
 {
     // Pretty simple. We get rid of the currently selected texture item.
 
-    if ( TexInfoWidget *curSelTexItem = this->currentSelectedTexture )
+    if ( TexInfoItem *curSelTexItem = this->currentSelectedTexture )
     {
         // Forget about this selected item.
         this->currentSelectedTexture = nullptr;
@@ -2269,8 +2580,8 @@ void MainWindow::onRemoveTexture( bool checked )
         // Now kill the texture.
         this->rwEngine->DeleteRwObject( tex );
 
-        // If we have no more items in the list widget, we should hide our texture view page.
-        if ( this->textureListWidget->selectedItems().count() == 0 )
+        // If we have no more items in the list, we should hide our texture view page.
+        if ( this->currentSelectedTexture == nullptr )
         {
             this->clearViewImage();
 
@@ -2290,7 +2601,7 @@ void MainWindow::onRenameTexture( bool checked )
     if ( this->texNameDlg )
         return;
 
-    if ( TexInfoWidget *texInfo = this->currentSelectedTexture )
+    if ( TexInfoItem *texInfo = this->currentSelectedTexture )
     {
         TexNameWindow *texNameDlg = new TexNameWindow( this, texInfo );
 
@@ -2302,7 +2613,7 @@ void MainWindow::onResizeTexture( bool checked )
 {
     // Change the texture dimensions.
 
-    if ( TexInfoWidget *texInfo = this->currentSelectedTexture )
+    if ( TexInfoItem *texInfo = this->currentSelectedTexture )
     {
         if ( TexResizeWindow *curDlg = this->resizeDlg )
         {
@@ -2322,7 +2633,7 @@ void MainWindow::onManipulateTexture( bool checked )
     // We can easily reuse the texture add dialog for this task.
 
     // For that we need a selected texture.
-    if ( TexInfoWidget *curSelTexItem = this->currentSelectedTexture )
+    if ( TexInfoItem *curSelTexItem = this->currentSelectedTexture )
     {
         auto cb_lambda = [=, this] ( const TexAddDialog::texAddOperation& params )
         {
@@ -2365,7 +2676,7 @@ void MainWindow::onExportTexture( bool checked )
 
     // Make sure we have selected a texture in the texture list.
     // Get it.
-    TexInfoWidget *selectedTexture = this->currentSelectedTexture;
+    TexInfoItem *selectedTexture = this->currentSelectedTexture;
 
     if ( selectedTexture != nullptr )
     {
@@ -2619,7 +2930,7 @@ void MainWindow::onSetupRenderingProps( bool checked )
     if ( checked == true )
         return;
 
-    if ( TexInfoWidget *texInfo = this->currentSelectedTexture )
+    if ( TexInfoItem *texInfo = this->currentSelectedTexture )
     {
         if ( RenderPropWindow *curDlg = this->renderPropDlg )
         {
@@ -62,6 +62,11 @@ struct massbuildEnv : public magicSerializationProvider
         endian::little_endian <eSerializedPaletteType> paletteType;
     };
 
+    struct massbuild_budget_struct
+    {
+        endian::little_endian <rw::uint32> memoryBudget;
+    };
+
     void Load( MainWindow *mainWnd, rw::BlockProvider& cfgBlock ) override
     {
         // Load our state.
@@ -101,6 +106,12 @@ struct massbuildEnv : public magicSerializationProvider
 
             this->config.paletteType = runtimePaletteType;
         }
+
+        // Configurations of older versions end here, so the default stays.
+        massbuild_budget_struct budgetStruct;
+        cfgBlock.readStruct( budgetStruct );
+
+        this->config.memoryBudget = budgetStruct.memoryBudget;
     }
 
     void Save( const MainWindow *mainWnd, rw::BlockProvider& cfgBlock ) const override
@@ -142,6 +153,11 @@ struct massbuildEnv : public magicSerializationProvider
         }
 
         cfgBlock.writeStruct( cfgStruct );
+
+        massbuild_budget_struct budgetStruct;
+        budgetStruct.memoryBudget = this->config.memoryBudget;
+
+        cfgBlock.writeStruct( budgetStruct );
     }
 
     TxdBuildModule::run_config config;
@@ -204,6 +220,14 @@ MassBuildWindow::MassBuildWindow( MainWindow *mainWnd ) : QDialog( mainWnd )
         )
     );
 
+    leftPaneLayout->addLayout(
+        qtshared::createMemoryBudgetGroup(
+            this,
+            env->config.memoryBudget,
+            this->editMemoryBudget
+        )
+    );
+
     // Meta-properties.
     QCheckBox *propCloseAfterComplete = CreateCheckBoxL( "Tools.MassBld.CloseOnCmplt" );
 
@@ -374,6 +398,7 @@ void MassBuildWindow::serialize( void )
 
     env->config.generateMipmaps = this->propGenMipmaps->isChecked();
     env->config.curMipMaxLevel = this->propGenMipmapsMax->text().toInt();
+    env->config.memoryBudget = this->editMemoryBudget->text().toUInt();
 
     env->closeOnCompletion = this->propCloseAfterComplete->isChecked();
 
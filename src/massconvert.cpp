@@ -78,6 +78,11 @@ struct massconvEnv : public magicSerializationProvider
         bool c_ignoreSecureWarnings;
     };
 
+    struct txdgen_budget_struct
+    {
+        endian::little_endian <rw::uint32> c_memoryBudget;
+    };
+
     void Load( MainWindow *mainWnd, rw::BlockProvider& massconvBlock ) override
     {
         RwReadUnicodeString( massconvBlock, this->txdgenConfig.c_gameRoot );
@@ -105,6 +110,12 @@ struct massconvEnv : public magicSerializationProvider
         txdgenConfig.c_outputDebug = cfgStruct.c_outputDebug;
         txdgenConfig.c_warningLevel = cfgStruct.c_warningLevel;
         txdgenConfig.c_ignoreSecureWarnings = cfgStruct.c_ignoreSecureWarnings;
+
+        // Configurations of older versions end here, so the default stays.
+        txdgen_budget_struct budgetStruct;
+        massconvBlock.readStruct( budgetStruct );
+
+        txdgenConfig.c_memoryBudget = budgetStruct.c_memoryBudget;
     }
 
     void Save( const MainWindow *mainWnd, rw::BlockProvider& massconvEnvBlock ) const override
@@ -134,6 +145,11 @@ struct massconvEnv : public magicSerializationProvider
         cfgStruct.c_ignoreSecureWarnings = this->txdgenConfig.c_ignoreSecureWarnings;
 
         massconvEnvBlock.writeStruct( cfgStruct );
+
+        txdgen_budget_struct budgetStruct;
+        budgetStruct.c_memoryBudget = this->txdgenConfig.c_memoryBudget;
+
+        massconvEnvBlock.writeStruct( budgetStruct );
     }
 
     TxdGenModule::run_config txdgenConfig;
@@ -235,6 +251,14 @@ MassConvertWindow::MassConvertWindow( MainWindow *mainwnd ) : QDialog( mainwnd )
 
     leftPanelLayout->addWidget( propCompressedIMG );
 
+    leftPanelLayout->addLayout(
+        qtshared::createMemoryBudgetGroup(
+            this,
+            massconv->txdgenConfig.c_memoryBudget,
+            this->editMemoryBudget
+        )
+    );
+
     // Add a log.
     layout.top->addWidget( logEditControl.CreateLogWidget() );
 
@@ -243,6 +267,7 @@ MassConvertWindow::MassConvertWindow( MainWindow *mainwnd ) : QDialog( mainwnd )
     this->convConsistencyLock = rw::CreateReadWriteLock( rwEngine );
 
     this->conversionThread = NULL;
+    this->isDryRun = false;
 
     // buttons at the bottom
     QPushButton *buttonConvert = CreateButtonL("Tools.MassCnv.Convert");
@@ -253,6 +278,14 @@ MassConvertWindow::MassConvertWindow( MainWindow *mainwnd ) : QDialog( mainwnd )
 
     layout.bottom->addWidget(buttonConvert, 0, Qt::AlignCenter);
 
+    QPushButton *buttonDryRun = CreateButtonL("Tools.MassCnv.DryRun");
+
+    this->buttonDryRun = buttonDryRun;
+
+    connect(buttonDryRun, &QPushButton::clicked, this, &MassConvertWindow::OnRequestDryRun);
+
+    layout.bottom->addWidget(buttonDryRun, 0, Qt::AlignCenter);
+
     QPushButton *buttonCancel = CreateButtonL("Tools.MassCnv.Cancel");
 
     connect(buttonCancel, &QPushButton::clicked, this, &MassConvertWindow::OnRequestCancel);
@@ -326,6 +359,7 @@ void MassConvertWindow::serialize( void )
     massconv->txdgenConfig.compressTextures = this->propCompressTextures->isChecked();
     massconv->txdgenConfig.c_reconstructIMGArchives = this->propReconstructIMG->isChecked();
     massconv->txdgenConfig.c_imgArchivesCompressed = this->propCompressedIMG->isChecked();
+    massconv->txdgenConfig.c_memoryBudget = this->editMemoryBudget->text().toUInt();
 }
 
 struct ConversionFinishEvent : public QEvent
@@ -381,11 +415,18 @@ static void convThreadEntryPoint( rw::thread_t threadHandle, rw::Interface *engi
 
     try
     {
-        massconvWnd->postLogMessage( "starting conversion...\n\n" );
-
         MassConvertTxdGenModule module( massconvWnd, engineInterface );
 
-        module.ApplicationMain( run_cfg );
+        if ( massconvWnd->isDryRun )
+        {
+            module.DryRun( run_cfg );
+        }
+        else
+        {
+            massconvWnd->postLogMessage( "starting conversion...\n\n" );
+
+            module.ApplicationMain( run_cfg );
+        }
 
         // Notify the application that we finished.
         {
@@ -394,7 +435,10 @@ static void convThreadEntryPoint( rw::thread_t threadHandle, rw::Interface *engi
             QCoreApplication::postEvent( massconvWnd, evt );
         }
 
-        massconvWnd->postLogMessage( "\nconversion finished!\n\n" );
+        if ( !massconvWnd->isDryRun )
+        {
+            massconvWnd->postLogMessage( "\nconversion finished!\n\n" );
+        }
     }
     catch( ... )
     {
@@ -413,6 +457,16 @@ static void convThreadEntryPoint( rw::thread_t threadHandle, rw::Interface *engi
 }
 
 void MassConvertWindow::OnRequestConvert( bool checked )
+{
+    this->startConversionThread( false );
+}
+
+void MassConvertWindow::OnRequestDryRun( bool checked )
+{
+    this->startConversionThread( true );
+}
+
+void MassConvertWindow::startConversionThread( bool isDryRun )
 {
     if ( this->conversionThread )
         return;
@@ -420,9 +474,12 @@ void MassConvertWindow::OnRequestConvert( bool checked )
     // Update configuration.
     this->serialize();
 
-    // Disable the conversion button, since we cannot run two conversions at the same time in
+    // Disable the conversion buttons, since we cannot run two conversions at the same time in
     // the same window.
     this->buttonConvert->setDisabled( true );
+    this->buttonDryRun->setDisabled( true );
+
+    this->isDryRun = isDryRun;
 
     // Run some the conversion in a seperate thread.
     rw::Interface *rwEngine = this->mainwnd->GetEngine();
@@ -448,8 +505,9 @@ void MassConvertWindow::customEvent( QEvent *evt )
     {
         (void)convEndEvt;
 
-        // We can enable the conversion button again.
+        // We can enable the conversion buttons again.
         this->buttonConvert->setDisabled( false );
+        this->buttonDryRun->setDisabled( false );
 
         return;
     }
@@ -41,6 +41,16 @@ struct massexportEnv : public magicSerializationProvider
         endian::little_endian <MassExportModule::eOutputType> outputType;
     };
 
+    struct massexp_budget_struct
+    {
+        endian::little_endian <rw::uint32> memoryBudget;
+    };
+
+    struct massexp_scanindex_struct
+    {
+        bool useScanIndex;
+    };
+
     void Load( MainWindow *mainWnd, rw::BlockProvider& massexportBlock ) override
     {
         RwReadUnicodeString( massexportBlock, this->config.gameRoot );
@@ -51,6 +61,17 @@ struct massexportEnv : public magicSerializationProvider
         massexportBlock.readStruct( cfgStruct );
 
         this->config.outputType = cfgStruct.outputType;
+
+        // Configurations of older versions end here, so the default stays.
+        massexp_budget_struct budgetStruct;
+        massexportBlock.readStruct( budgetStruct );
+
+        this->config.memoryBudget = budgetStruct.memoryBudget;
+
+        massexp_scanindex_struct scanIndexStruct;
+        massexportBlock.readStruct( scanIndexStruct );
+
+        this->config.useScanIndex = scanIndexStruct.useScanIndex;
     }
 
     void Save( const MainWindow *mainWnd, rw::BlockProvider& massexportBlock ) const override
@@ -63,6 +84,16 @@ struct massexportEnv : public magicSerializationProvider
         cfgStruct.outputType = this->config.outputType;
 
         massexportBlock.writeStruct( cfgStruct );
+
+        massexp_budget_struct budgetStruct;
+        budgetStruct.memoryBudget = this->config.memoryBudget;
+
+        massexportBlock.writeStruct( budgetStruct );
+
+        massexp_scanindex_struct scanIndexStruct;
+        scanIndexStruct.useScanIndex = this->config.useScanIndex;
+
+        massexportBlock.writeStruct( scanIndexStruct );
     }
 
     MassExportModule::run_config config;
@@ -198,6 +229,18 @@ MassExportWindow::MassExportWindow( MainWindow *mainWnd ) : QDialog( mainWnd )
 
     layout.top->addWidget( optionExportFolders );
 
+    layout.top->addSpacing( 10 );
+
+    layout.top->addLayout( qtshared::createMemoryBudgetGroup( this, env->config.memoryBudget, this->editMemoryBudget ) );
+
+    QCheckBox *propUseScanIndex = CreateCheckBoxL( "Tools.ScanIndex" );
+
+    propUseScanIndex->setChecked( env->config.useScanIndex );
+
+    this->propUseScanIndex = propUseScanIndex;
+
+    layout.top->addWidget( propUseScanIndex );
+
     // The dialog is done, we finish off with the typical buttons.
     QPushButton *buttonExport = CreateButtonL( "Tools.MassExp.Export" );
 
@@ -346,6 +389,10 @@ void MassExportWindow::serialize( void )
     }
 
     env->config.outputType = outputType;
+
+    env->config.memoryBudget = this->editMemoryBudget->text().toUInt();
+
+    env->config.useScanIndex = this->propUseScanIndex->isChecked();
 }
 
 void InitializeMassExportToolEnvironment( void )
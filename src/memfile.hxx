@@ -0,0 +1,194 @@
+// File stream that lives entirely in memory.
+// Used whenever we want to keep a file around without going through the disk.
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <string.h>
+
+struct CMemoryFile : public CFile
+{
+    inline CMemoryFile( filePath path )
+        : path( std::move( path ) )
+    {
+        this->seekPos = 0;
+    }
+
+    inline ~CMemoryFile( void )
+    {
+        return;
+    }
+
+    // Reads the remaining contents of another stream into this file.
+    inline void ReadFromStream( CFile *srcStream )
+    {
+        char buffer[ 0x4000 ];
+
+        while ( true )
+        {
+            size_t readCount = srcStream->Read( buffer, sizeof( buffer ) );
+
+            if ( readCount == 0 )
+                break;
+
+            this->Write( buffer, readCount );
+        }
+
+        this->seekPos = 0;
+    }
+
+    // Direct access to the contents.
+    inline const char* GetData( void ) const
+    {
+        return this->data.data();
+    }
+
+    inline size_t GetDataSize( void ) const
+    {
+        return this->data.size();
+    }
+
+    inline void Reserve( size_t size )
+    {
+        this->data.reserve( size );
+    }
+
+    size_t Read( void *buffer, size_t readCount ) override
+    {
+        size_t dataSize = this->data.size();
+
+        if ( this->seekPos >= dataSize )
+            return 0;
+
+        size_t canRead = std::min( readCount, dataSize - this->seekPos );
+
+        memcpy( buffer, this->data.data() + this->seekPos, canRead );
+
+        this->seekPos += canRead;
+
+        return canRead;
+    }
+
+    size_t Write( const void *buffer, size_t writeCount ) override
+    {
+        size_t endPos = ( this->seekPos + writeCount );
+
+        if ( endPos > this->data.size() )
+        {
+            this->data.resize( endPos );
+        }
+
+        memcpy( this->data.data() + this->seekPos, buffer, writeCount );
+
+        this->seekPos = endPos;
+
+        return writeCount;
+    }
+
+    int Seek( long iOffset, int iType ) override
+    {
+        return this->SeekNative( iOffset, iType );
+    }
+
+    int SeekNative( fsOffsetNumber_t iOffset, int iType ) override
+    {
+        fsOffsetNumber_t basePos;
+
+        if ( iType == SEEK_SET )
+        {
+            basePos = 0;
+        }
+        else if ( iType == SEEK_CUR )
+        {
+            basePos = (fsOffsetNumber_t)this->seekPos;
+        }
+        else if ( iType == SEEK_END )
+        {
+            basePos = (fsOffsetNumber_t)this->data.size();
+        }
+        else
+        {
+            return -1;
+        }
+
+        fsOffsetNumber_t newPos = ( basePos + iOffset );
+
+        if ( newPos < 0 )
+            return -1;
+
+        this->seekPos = (size_t)newPos;
+
+        return 0;
+    }
+
+    long Tell( void ) const noexcept override
+    {
+        return (long)this->seekPos;
+    }
+
+    fsOffsetNumber_t TellNative( void ) const noexcept override
+    {
+        return (fsOffsetNumber_t)this->seekPos;
+    }
+
+    bool IsEOF( void ) const noexcept override
+    {
+        return ( this->seekPos >= this->data.size() );
+    }
+
+    bool QueryStats( filesysStats& statsOut ) const noexcept override
+    {
+        return false;
+    }
+
+    void SetFileTimes( time_t atime, time_t ctime, time_t mtime ) override
+    {
+        return;
+    }
+
+    void SetSeekEnd( void ) override
+    {
+        this->data.resize( this->seekPos );
+    }
+
+    size_t GetSize( void ) const noexcept override
+    {
+        return this->data.size();
+    }
+
+    fsOffsetNumber_t GetSizeNative( void ) const noexcept override
+    {
+        return (fsOffsetNumber_t)this->data.size();
+    }
+
+    void Flush( void ) override
+    {
+        return;
+    }
+
+    CFileMappingProvider* CreateMapping( void ) override
+    {
+        return nullptr;
+    }
+
+    filePath GetPath( void ) const override
+    {
+        return this->path;
+    }
+
+    bool IsReadable( void ) const noexcept override
+    {
+        return true;
+    }
+
+    bool IsWriteable( void ) const noexcept override
+    {
+        return true;
+    }
+
+private:
+    filePath path;
+    std::vector <char> data;
+    size_t seekPos;
+};
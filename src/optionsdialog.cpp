@@ -122,6 +122,19 @@ OptionsDialog::OptionsDialog( MainWindow *mainWnd ) : QDialog( mainWnd )
  
     advTabLayout->addLayout( layoutWarningLevel );
 
+    QHBoxLayout *layoutMemDecompress = new QHBoxLayout();
+
+    layoutMemDecompress->addWidget( CreateLabelL( "Main.Options.MemDec" ), 0, Qt::AlignLeft );
+
+    MagicLineEdit *editMemDecompressLimit = new MagicLineEdit( ansi_to_qt( std::to_string( GetInMemoryDecompressionLimit( mainWnd ) / ( 1024 * 1024 ) ) ) );
+    editMemDecompressLimit->setValidator( new QIntValidator( 0, 1024, this ) );
+
+    this->editMemDecompressLimit = editMemDecompressLimit;
+
+    layoutMemDecompress->addWidget( editMemDecompressLimit );
+
+    advTabLayout->addLayout( layoutMemDecompress );
+
     advTab->setLayout( advTabLayout );
 
     QPushButton *buttonAccept = CreateButtonL( "Main.Options.Accept" );
@@ -207,6 +220,16 @@ void OptionsDialog::serialize( void )
     int desiredWarningLevel = this->selectWarningLevel->currentIndex();
 
     rwEngine->SetWarningLevel( desiredWarningLevel );
+
+    //* Compressed files up to this size are decompressed into memory instead of into a temporary file.
+    bool isMemDecompressLimitValid;
+
+    unsigned int memDecompressLimit = this->editMemDecompressLimit->text().toUInt( &isMemDecompressLimitValid );
+
+    if ( isMemDecompressLimitValid )
+    {
+        SetInMemoryDecompressionLimit( mainWnd, (size_t)memDecompressLimit * 1024 * 1024 );
+    }
 }
 
 void OptionsDialog::OnChangeSelectedLanguage(int newIndex)
@@ -0,0 +1,111 @@
+#include "mainwindow.h"
+
+#include "qtrwutils.hxx"
+
+#include <chrono>
+#include <random>
+#include <string>
+
+// Benchmark of the bitmap to QImage conversion.
+// The bitmaps are filled with noise, since the conversion does not care about the content.
+
+struct benchBitmapLayout
+{
+    const char *name;
+    rw::eRasterFormat rasterFormat;
+    rw::uint32 depth;
+    rw::eColorOrdering colorOrder;
+};
+
+static const benchBitmapLayout benchLayouts[] =
+{
+    { "8888 BGRA", rw::RASTER_8888, 32, rw::COLOR_BGRA },
+    { "8888 RGBA", rw::RASTER_8888, 32, rw::COLOR_RGBA },
+    { "8888 ABGR", rw::RASTER_8888, 32, rw::COLOR_ABGR },
+    { "888 BGRA 32bit", rw::RASTER_888, 32, rw::COLOR_BGRA },
+    { "888 RGBA 24bit", rw::RASTER_888, 24, rw::COLOR_RGBA },
+    { "565 BGRA", rw::RASTER_565, 16, rw::COLOR_BGRA }
+};
+
+static const rw::uint32 benchBitmapSize = 1024;
+
+typedef std::chrono::steady_clock benchClock;
+
+static double secondsSince( benchClock::time_point startTime )
+{
+    return std::chrono::duration <double> ( benchClock::now() - startTime ).count();
+}
+
+bool RunBitmapConversionBenchmark( rw::Interface *rwEngine, CFile *resultStream, unsigned int iterations )
+{
+    if ( iterations == 0 )
+    {
+        iterations = 1;
+    }
+
+    std::mt19937 randomGen( 1337 );
+
+    double megapixels = ( (double)benchBitmapSize * benchBitmapSize * iterations / 1000000 );
+
+    std::string json = "{\n";
+    json += "  \"width\": " + std::to_string( benchBitmapSize ) + ",\n";
+    json += "  \"height\": " + std::to_string( benchBitmapSize ) + ",\n";
+    json += "  \"iterations\": " + std::to_string( iterations ) + ",\n";
+    json += "  \"layouts\": [";
+
+    bool isFirstLayout = true;
+
+    for ( const benchBitmapLayout& layout : benchLayouts )
+    {
+        rw::Bitmap bitmap( rwEngine, layout.depth, layout.rasterFormat, layout.colorOrder );
+
+        bitmap.setSize( benchBitmapSize, benchBitmapSize );
+
+        unsigned char *texels = (unsigned char*)bitmap.getTexelsData();
+        rw::uint32 dataSize = bitmap.getDataSize();
+
+        for ( rw::uint32 n = 0; n < dataSize; n++ )
+        {
+            texels[ n ] = (unsigned char)randomGen();
+        }
+
+        QImage genericImage;
+        QImage fastImage;
+
+        benchClock::time_point genericStart = benchClock::now();
+
+        for ( unsigned int iter = 0; iter < iterations; iter++ )
+        {
+            genericImage = convertRWBitmapToQImageGeneric( bitmap );
+        }
+
+        double genericSeconds = secondsSince( genericStart );
+
+        benchClock::time_point fastStart = benchClock::now();
+
+        for ( unsigned int iter = 0; iter < iterations; iter++ )
+        {
+            fastImage = convertRWBitmapToQImage( bitmap );
+        }
+
+        double fastSeconds = secondsSince( fastStart );
+
+        // Both have to give the same picture.
+        bool isIdentical = ( genericImage == fastImage );
+
+        json += ( isFirstLayout ? "\n" : ",\n" );
+        json += "    {\n";
+        json += "      \"name\": \"" + std::string( layout.name ) + "\",\n";
+        json += "      \"genericMPps\": " + std::to_string( genericSeconds > 0 ? megapixels / genericSeconds : 0.0 ) + ",\n";
+        json += "      \"fastMPps\": " + std::to_string( fastSeconds > 0 ? megapixels / fastSeconds : 0.0 ) + ",\n";
+        json += "      \"identical\": " + std::string( isIdentical ? "true" : "false" ) + "\n";
+        json += "    }";
+
+        isFirstLayout = false;
+    }
+
+    json += "\n  ]\n";
+    json += "}\n";
+
+    return ( resultStream->Write( json.c_str(), json.size() ) == json.size() );
+}
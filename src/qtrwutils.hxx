@@ -2,8 +2,10 @@
 // Should not be included into the global headers, this is an on-demand component.
 
 #include <algorithm>
+#include <cstring>
 
-inline QImage convertRWBitmapToQImage( const rw::Bitmap& rasterBitmap )
+// Converts any bitmap through its color interface; slow but works for every layout.
+inline QImage convertRWBitmapToQImageGeneric( const rw::Bitmap& rasterBitmap )
 {
 	rw::uint32 width, height;
 	rasterBitmap.getSize(width, height);
@@ -32,6 +34,165 @@ inline QImage convertRWBitmapToQImage( const rw::Bitmap& rasterBitmap )
     return texImage;
 }
 
+// Row kernels for the common bitmap layouts.
+// QImage::Format_ARGB32 keeps pixels as 0xAARRGGBB words, which is COLOR_BGRA in memory on little endian machines.
+// They are plain loops so that the compiler can vectorize them.
+namespace qtrwutils
+{
+
+inline void convertRowBGRA32( const void *srcRow, QRgb *dstRow, rw::uint32 width, bool hasAlpha )
+{
+    if ( hasAlpha )
+    {
+        memcpy( dstRow, srcRow, width * sizeof( QRgb ) );
+    }
+    else
+    {
+        const quint32 *srcColors = (const quint32*)srcRow;
+
+        for ( rw::uint32 x = 0; x < width; x++ )
+        {
+            dstRow[ x ] = ( srcColors[ x ] | 0xFF000000 );
+        }
+    }
+}
+
+inline void convertRowRGBA32( const void *srcRow, QRgb *dstRow, rw::uint32 width, bool hasAlpha )
+{
+    const quint32 *srcColors = (const quint32*)srcRow;
+
+    quint32 alphaMask = ( hasAlpha ? 0 : 0xFF000000 );
+
+    for ( rw::uint32 x = 0; x < width; x++ )
+    {
+        quint32 color = srcColors[ x ];
+
+        // Swap red and blue.
+        dstRow[ x ] = ( ( color & 0xFF00FF00 ) | ( ( color >> 16 ) & 0xFF ) | ( ( color & 0xFF ) << 16 ) | alphaMask );
+    }
+}
+
+inline void convertRowABGR32( const void *srcRow, QRgb *dstRow, rw::uint32 width, bool hasAlpha )
+{
+    const quint32 *srcColors = (const quint32*)srcRow;
+
+    quint32 alphaMask = ( hasAlpha ? 0 : 0xFF000000 );
+
+    for ( rw::uint32 x = 0; x < width; x++ )
+    {
+        quint32 color = srcColors[ x ];
+
+        // Move alpha from the lowest to the highest byte.
+        dstRow[ x ] = ( ( color >> 8 ) | ( color << 24 ) | alphaMask );
+    }
+}
+
+inline void convertRowBGR24( const void *srcRow, QRgb *dstRow, rw::uint32 width, bool hasAlpha )
+{
+    const uchar *srcBytes = (const uchar*)srcRow;
+
+    for ( rw::uint32 x = 0; x < width; x++ )
+    {
+        const uchar *srcColor = ( srcBytes + x * 3 );
+
+        dstRow[ x ] = ( 0xFF000000 | ( (quint32)srcColor[ 2 ] << 16 ) | ( (quint32)srcColor[ 1 ] << 8 ) | srcColor[ 0 ] );
+    }
+}
+
+inline void convertRowRGB24( const void *srcRow, QRgb *dstRow, rw::uint32 width, bool hasAlpha )
+{
+    const uchar *srcBytes = (const uchar*)srcRow;
+
+    for ( rw::uint32 x = 0; x < width; x++ )
+    {
+        const uchar *srcColor = ( srcBytes + x * 3 );
+
+        dstRow[ x ] = ( 0xFF000000 | ( (quint32)srcColor[ 0 ] << 16 ) | ( (quint32)srcColor[ 1 ] << 8 ) | srcColor[ 2 ] );
+    }
+}
+
+typedef void (*rowConverter_t)( const void *srcRow, QRgb *dstRow, rw::uint32 width, bool hasAlpha );
+
+// Returns nullptr if the layout has to go through the color interface.
+inline rowConverter_t getRowConverter( rw::eRasterFormat rasterFormat, rw::uint32 depth, rw::eColorOrdering colorOrder, bool& hasAlphaOut )
+{
+    if ( QSysInfo::ByteOrder != QSysInfo::LittleEndian )
+        return nullptr;
+
+    if ( rasterFormat == rw::RASTER_8888 || rasterFormat == rw::RASTER_888 )
+    {
+        hasAlphaOut = ( rasterFormat == rw::RASTER_8888 );
+
+        if ( depth == 32 )
+        {
+            if ( colorOrder == rw::COLOR_BGRA )
+            {
+                return convertRowBGRA32;
+            }
+            else if ( colorOrder == rw::COLOR_RGBA )
+            {
+                return convertRowRGBA32;
+            }
+            else if ( colorOrder == rw::COLOR_ABGR )
+            {
+                return convertRowABGR32;
+            }
+        }
+        else if ( depth == 24 && rasterFormat == rw::RASTER_888 )
+        {
+            if ( colorOrder == rw::COLOR_BGRA )
+            {
+                return convertRowBGR24;
+            }
+            else if ( colorOrder == rw::COLOR_RGBA )
+            {
+                return convertRowRGB24;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+}
+
+inline QImage convertRWBitmapToQImage( const rw::Bitmap& rasterBitmap )
+{
+    rw::uint32 width, height;
+    rasterBitmap.getSize( width, height );
+
+    rw::uint32 depth = rasterBitmap.getDepth();
+
+    bool hasAlpha;
+
+    qtrwutils::rowConverter_t rowConverter = qtrwutils::getRowConverter( rasterBitmap.getFormat(), depth, rasterBitmap.getColorOrder(), hasAlpha );
+
+    const void *texels = rasterBitmap.getTexelsData();
+    rw::uint32 rowSize = rasterBitmap.getRowSize();
+
+    // Make sure the rows really are where we expect them.
+    bool canUseRows =
+        rowConverter != nullptr && texels != nullptr &&
+        rowSize >= ( (size_t)width * depth / 8 ) &&
+        rasterBitmap.getDataSize() >= ( (size_t)rowSize * height );
+
+    if ( !canUseRows )
+    {
+        return convertRWBitmapToQImageGeneric( rasterBitmap );
+    }
+
+    QImage texImage( width, height, QImage::Format::Format_ARGB32 );
+
+    for ( rw::uint32 y = 0; y < height; y++ )
+    {
+        const void *srcRow = ( (const char*)texels + (size_t)rowSize * y );
+
+        rowConverter( srcRow, (QRgb*)texImage.scanLine( y ), width, hasAlpha );
+    }
+
+    return texImage;
+}
+
 inline QPixmap convertRWBitmapToQPixmap( const rw::Bitmap& rasterBitmap )
 {
 	return QPixmap::fromImage(
@@ -140,3 +301,7 @@ inline rw::rwStaticVector <rw::rwStaticString <char>> PlatformImportanceSort( Ma
 
     return sortedResult;
 }
+
+// Measures convertRWBitmapToQImage against the conversion through the color interface for the common
+// bitmap layouts and writes the throughput as JSON.
+bool RunBitmapConversionBenchmark( rw::Interface *rwEngine, CFile *resultStream, unsigned int iterations );
@@ -81,7 +81,7 @@ QComboBox* RenderPropWindow::createFilterBox( void ) const
 
     bool hasMipmaps = false;
     {
-        if ( TexInfoWidget *texInfo = this->texInfo )
+        if ( TexInfoItem *texInfo = this->texInfo )
         {
             if ( rw::TextureBase *texHandle = texInfo->GetTextureHandle() )
             {
@@ -108,7 +108,7 @@ QComboBox* RenderPropWindow::createFilterBox( void ) const
     return filterSelect;
 }
 
-RenderPropWindow::RenderPropWindow( MainWindow *mainWnd, TexInfoWidget *texInfo ) : QDialog( mainWnd )
+RenderPropWindow::RenderPropWindow( MainWindow *mainWnd, TexInfoItem *texInfo ) : QDialog( mainWnd )
 {
     this->setWindowFlags( this->windowFlags() & ~Qt::WindowContextHelpButtonHint );
 
@@ -227,7 +227,7 @@ void RenderPropWindow::updateContent( MainWindow *mainWnd )
 void RenderPropWindow::OnRequestSet( bool checked )
 {
     // Update the texture.
-    if ( TexInfoWidget *texInfo = this->texInfo )
+    if ( TexInfoItem *texInfo = this->texInfo )
     {
         if ( rw::TextureBase *texHandle = texInfo->GetTextureHandle() )
         {
@@ -293,7 +293,7 @@ void RenderPropWindow::UpdateAccessibility( void )
     // Only allow setting if we actually change from the original values.
     bool allowSet = true;
 
-    if ( TexInfoWidget *texInfo = this->texInfo )
+    if ( TexInfoItem *texInfo = this->texInfo )
     {
         if ( rw::TextureBase *texHandle = texInfo->GetTextureHandle() )
         {
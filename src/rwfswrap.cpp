@@ -37,6 +37,39 @@ CFile* RawOpenGlobalFile( CFileSystem *fileSys, const filePath& path, const file
     });
 }
 
+// The RW deserializer reads a lot of small chunk headers, which would each go through
+// the translator stack. So we read ahead in windows and collect writes.
+static const size_t defaultStreamBufferSize = 0x10000;
+
+// Output windows are sized to the expected output up to this size.
+static const size_t maxOutputBufferSize = 0x400000;
+
+// Write windows whose size is a multiple of this end on a file offset that is a multiple
+// of it, so that all but the first are written in aligned blocks.
+static const size_t streamBlockAlignment = 0x1000;
+
+struct eirStreamConstructionParams
+{
+    CFile *stream;
+    size_t bufferSize;
+    rw::int64 preallocSize;
+    bool bufferWrites;
+    bool *writeFailedOut;
+    rwStreamReadCallback_t readCB;
+    void *readUD;
+};
+
+// Read-only view of a whole file that is mapped into memory.
+struct eirMappingConstructionParams
+{
+    CFile *stream;
+    CFileMappingProvider *mapping;
+    const char *data;
+    size_t dataSize;
+    rwStreamReadCallback_t readCB;
+    void *readUD;
+};
+
 struct rwFileSystemStreamWrapEnv
 {
     struct eirFileSystemMetaInfo
@@ -44,6 +77,19 @@ struct rwFileSystemStreamWrapEnv
         inline eirFileSystemMetaInfo( void )
         {
             this->theStream = nullptr;
+            this->bufferSize = 0;
+            this->bufStart = 0;
+            this->bufLen = 0;
+            this->bufPos = 0;
+            this->windowSize = 0;
+            this->isWriteBuffer = false;
+            this->preallocEnd = 0;
+            this->writeEnd = 0;
+            this->bufferWrites = false;
+            this->writeFailedOut = nullptr;
+            this->readCB = nullptr;
+            this->readUD = nullptr;
+            this->readSize = 0;
         }
 
         inline ~eirFileSystemMetaInfo( void )
@@ -51,7 +97,82 @@ struct rwFileSystemStreamWrapEnv
             return;
         }
 
+        // Logical position of the stream.
+        inline rw::int64 GetPosition( void ) const
+        {
+            if ( this->bufLen != 0 || this->isWriteBuffer )
+            {
+                return ( this->bufStart + this->bufPos );
+            }
+
+            return this->theStream->TellNative();
+        }
+
+        inline size_t GetWriteWindowSize( rw::int64 windowStart ) const
+        {
+            size_t windowSize = this->bufferSize;
+
+            if ( windowSize % streamBlockAlignment == 0 )
+            {
+                windowSize -= (size_t)( windowStart % streamBlockAlignment );
+            }
+
+            return windowSize;
+        }
+
+        // Writes out pending data; the underlying stream is at the logical position afterwards.
+        inline void Flush( void )
+        {
+            if ( this->isWriteBuffer )
+            {
+                size_t pendingCount = this->bufLen;
+
+                this->bufLen = 0;
+                this->bufPos = 0;
+                this->isWriteBuffer = false;
+
+                if ( pendingCount != 0 && this->theStream->Write( this->buffer.data(), pendingCount ) != pendingCount )
+                {
+                    throw rw::RwException( "failed to write to stream" );
+                }
+            }
+            else if ( this->bufLen != 0 )
+            {
+                // Give back what we have read ahead.
+                rw::int64 logicalPos = ( this->bufStart + this->bufPos );
+
+                this->bufLen = 0;
+                this->bufPos = 0;
+
+                this->theStream->SeekNative( logicalPos, SEEK_SET );
+            }
+        }
+
         CFile *theStream;
+
+        // Read-ahead or write-behind window; a size of zero disables buffering.
+        // While reading, the underlying stream is at the end of the window.
+        // While writing, it is at the start of the window.
+        std::vector <char> buffer;
+        size_t bufferSize;
+        rw::int64 bufStart;
+        size_t bufLen;
+        size_t bufPos;
+        size_t windowSize;
+        bool isWriteBuffer;
+
+        // If the file was grown in advance, the end of that area and the end of what was written.
+        rw::int64 preallocEnd;
+        rw::int64 writeEnd;
+
+        // Writes are only collected if the creator finds out whether the last window could be written.
+        bool bufferWrites;
+        bool *writeFailedOut;
+
+        // Told about the progress of reading.
+        rwStreamReadCallback_t readCB;
+        void *readUD;
+        rw::int64 readSize;
     };
 
     struct eirFileSystemWrapperProvider : public rw::customStreamInterface, public rw::FileInterface
@@ -59,15 +180,67 @@ struct rwFileSystemStreamWrapEnv
         // *** rw::customStreamInterface IMPL
         void OnConstruct( rw::eStreamMode streamMode, void *userdata, void *membuf, size_t memSize ) const override
         {
+            const eirStreamConstructionParams *params = (const eirStreamConstructionParams*)userdata;
+
             eirFileSystemMetaInfo *meta = new (membuf) eirFileSystemMetaInfo;
 
-            meta->theStream = (CFile*)userdata;
+            meta->theStream = params->stream;
+            meta->bufferSize = params->bufferSize;
+            meta->bufferWrites = params->bufferWrites;
+            meta->writeFailedOut = params->writeFailedOut;
+            meta->readCB = params->readCB;
+            meta->readUD = params->readUD;
+
+            if ( params->readCB )
+            {
+                meta->readSize = params->stream->GetSizeNative();
+            }
+
+            // Reserve the space of a new file in one go, which keeps it from being fragmented.
+            // The rest is cut off again when we are done.
+            CFile *stream = params->stream;
+
+            if ( params->preallocSize > 0 && stream->GetSizeNative() == 0 )
+            {
+                fsOffsetNumber_t startPos = stream->TellNative();
+
+                stream->SeekNative( params->preallocSize, SEEK_SET );
+                stream->SetSeekEnd();
+                stream->SeekNative( startPos, SEEK_SET );
+
+                meta->preallocEnd = params->preallocSize;
+            }
         }
 
         void OnDestruct( void *memBuf, size_t memSize ) const override
         {
             eirFileSystemMetaInfo *meta = (eirFileSystemMetaInfo*)memBuf;
 
+            // The stream is used on its own afterwards, so it has to be where we left it.
+            try
+            {
+                meta->Flush();
+
+                if ( meta->preallocEnd != 0 )
+                {
+                    CFile *stream = meta->theStream;
+
+                    fsOffsetNumber_t endPos = stream->TellNative();
+
+                    stream->SeekNative( meta->writeEnd, SEEK_SET );
+                    stream->SetSeekEnd();
+                    stream->SeekNative( endPos, SEEK_SET );
+                }
+            }
+            catch( ... )
+            {
+                // We cannot throw from here, so tell the creator if it wants to know.
+                if ( meta->writeFailedOut )
+                {
+                    *meta->writeFailedOut = true;
+                }
+            }
+
             meta->~eirFileSystemMetaInfo();
         }
 
@@ -75,28 +248,156 @@ struct rwFileSystemStreamWrapEnv
         {
             eirFileSystemMetaInfo *meta = (eirFileSystemMetaInfo*)memBuf;
 
-            return meta->theStream->Read( out_buf, readCount );
+            if ( meta->bufferSize == 0 )
+            {
+                return meta->theStream->Read( out_buf, readCount );
+            }
+
+            if ( meta->isWriteBuffer )
+            {
+                meta->Flush();
+            }
+
+            char *outBuf = (char*)out_buf;
+
+            size_t totalRead = 0;
+
+            while ( totalRead < readCount )
+            {
+                size_t leftCount = ( readCount - totalRead );
+
+                if ( meta->bufPos < meta->bufLen )
+                {
+                    size_t canRead = std::min( leftCount, meta->bufLen - meta->bufPos );
+
+                    memcpy( outBuf + totalRead, meta->buffer.data() + meta->bufPos, canRead );
+
+                    meta->bufPos += canRead;
+                    totalRead += canRead;
+                    continue;
+                }
+
+                // The window is used up, so the underlying stream is at our position.
+                meta->bufLen = 0;
+                meta->bufPos = 0;
+
+                if ( leftCount >= meta->bufferSize )
+                {
+                    // Big reads do not need the window.
+                    totalRead += meta->theStream->Read( outBuf + totalRead, leftCount );
+                    break;
+                }
+
+                meta->bufStart = meta->theStream->TellNative();
+
+                if ( meta->buffer.size() != meta->bufferSize )
+                {
+                    meta->buffer.resize( meta->bufferSize );
+                }
+
+                meta->bufLen = meta->theStream->Read( meta->buffer.data(), meta->bufferSize );
+
+                if ( meta->bufLen == 0 )
+                    break;
+            }
+
+            if ( rwStreamReadCallback_t readCB = meta->readCB )
+            {
+                readCB( meta->GetPosition(), meta->readSize, meta->readUD );
+            }
+
+            return totalRead;
         }
 
         size_t Write( void *memBuf, const void *in_buf, size_t writeCount ) const override
         {
             eirFileSystemMetaInfo *meta = (eirFileSystemMetaInfo*)memBuf;
 
-            return meta->theStream->Write( in_buf, writeCount );
+            if ( meta->bufferSize == 0 )
+            {
+                return meta->theStream->Write( in_buf, writeCount );
+            }
+
+            if ( !meta->bufferWrites )
+            {
+                // Give back the read-ahead window first.
+                meta->Flush();
+
+                return meta->theStream->Write( in_buf, writeCount );
+            }
+
+            if ( meta->isWriteBuffer && meta->bufLen + writeCount > meta->windowSize )
+            {
+                meta->Flush();
+            }
+
+            if ( !meta->isWriteBuffer )
+            {
+                meta->Flush();
+
+                rw::int64 windowStart = meta->theStream->TellNative();
+
+                size_t windowSize = meta->GetWriteWindowSize( windowStart );
+
+                if ( writeCount > windowSize )
+                {
+                    // Big writes do not need the window.
+                    size_t actualWriteCount = meta->theStream->Write( in_buf, writeCount );
+
+                    meta->writeEnd = std::max( meta->writeEnd, (rw::int64)meta->theStream->TellNative() );
+
+                    return actualWriteCount;
+                }
+
+                meta->bufStart = windowStart;
+                meta->windowSize = windowSize;
+                meta->isWriteBuffer = true;
+            }
+
+            if ( meta->buffer.size() != meta->bufferSize )
+            {
+                meta->buffer.resize( meta->bufferSize );
+            }
+
+            memcpy( meta->buffer.data() + meta->bufLen, in_buf, writeCount );
+
+            meta->bufLen += writeCount;
+            meta->bufPos = meta->bufLen;
+
+            if ( meta->bufLen != 0 )
+            {
+                meta->writeEnd = std::max( meta->writeEnd, meta->bufStart + (rw::int64)meta->bufLen );
+            }
+
+            return writeCount;
         }
 
         void Skip( void *memBuf, rw::int64 skipCount ) const override
         {
             eirFileSystemMetaInfo *meta = (eirFileSystemMetaInfo*)memBuf;
 
+            // Skips inside of the read-ahead window stay in memory.
+            if ( !meta->isWriteBuffer && meta->bufLen != 0 )
+            {
+                rw::int64 newBufPos = ( (rw::int64)meta->bufPos + skipCount );
+
+                if ( newBufPos >= 0 && newBufPos <= (rw::int64)meta->bufLen )
+                {
+                    meta->bufPos = (size_t)newBufPos;
+                    return;
+                }
+            }
+
+            meta->Flush();
+
             meta->theStream->SeekNative( skipCount, SEEK_CUR );
         }
 
         rw::int64 Tell( const void *memBuf ) const override
         {
-            eirFileSystemMetaInfo *meta = (eirFileSystemMetaInfo*)memBuf;
+            const eirFileSystemMetaInfo *meta = (const eirFileSystemMetaInfo*)memBuf;
 
-            return meta->theStream->TellNative();
+            return meta->GetPosition();
         }
 
         void Seek( void *memBuf, rw::int64 stream_offset, rw::eSeekMode seek_mode ) const override
@@ -122,14 +423,53 @@ struct rwFileSystemStreamWrapEnv
 
             eirFileSystemMetaInfo *meta = (eirFileSystemMetaInfo*)memBuf;
 
+            // Seeks inside of the read-ahead window stay in memory.
+            if ( !meta->isWriteBuffer && meta->bufLen != 0 && ansi_seek != SEEK_END )
+            {
+                rw::int64 targetPos = stream_offset;
+
+                if ( ansi_seek == SEEK_CUR )
+                {
+                    targetPos += ( meta->bufStart + meta->bufPos );
+                }
+
+                if ( targetPos >= meta->bufStart && targetPos <= meta->bufStart + (rw::int64)meta->bufLen )
+                {
+                    meta->bufPos = (size_t)( targetPos - meta->bufStart );
+                    return;
+                }
+            }
+
+            meta->Flush();
+
+            // The grown area of the file is not part of the stream.
+            if ( meta->preallocEnd != 0 && ansi_seek == SEEK_END )
+            {
+                stream_offset += this->Size( meta );
+                ansi_seek = SEEK_SET;
+            }
+
             meta->theStream->SeekNative( stream_offset, ansi_seek );
         }
 
         rw::int64 Size( const void *memBuf ) const override
         {
-            eirFileSystemMetaInfo *meta = (eirFileSystemMetaInfo*)memBuf;
+            const eirFileSystemMetaInfo *meta = (const eirFileSystemMetaInfo*)memBuf;
+
+            rw::int64 streamSize = meta->theStream->GetSizeNative();
+
+            if ( meta->preallocEnd != 0 )
+            {
+                streamSize = meta->writeEnd;
+            }
+
+            // Pending writes may extend the stream.
+            if ( meta->isWriteBuffer && meta->bufLen != 0 )
+            {
+                streamSize = std::max( streamSize, meta->bufStart + (rw::int64)meta->bufLen );
+            }
 
-            return meta->theStream->GetSizeNative();
+            return streamSize;
         }
 
         bool SupportsSize( const void *memBuf ) const override
@@ -228,7 +568,136 @@ struct rwFileSystemStreamWrapEnv
         CFileSystem *nativeFileSystem;
     };
 
+    struct eirMappedStreamMetaInfo
+    {
+        CFile *theStream;
+        CFileMappingProvider *mapping;
+        const char *data;
+        size_t dataSize;
+        rw::int64 pos;
+
+        rwStreamReadCallback_t readCB;
+        void *readUD;
+    };
+
+    struct eirFileSystemMappingProvider : public rw::customStreamInterface
+    {
+        void OnConstruct( rw::eStreamMode streamMode, void *userdata, void *membuf, size_t memSize ) const override
+        {
+            const eirMappingConstructionParams *params = (const eirMappingConstructionParams*)userdata;
+
+            eirMappedStreamMetaInfo *meta = new (membuf) eirMappedStreamMetaInfo;
+
+            meta->theStream = params->stream;
+            meta->mapping = params->mapping;
+            meta->data = params->data;
+            meta->dataSize = params->dataSize;
+            meta->pos = 0;
+            meta->readCB = params->readCB;
+            meta->readUD = params->readUD;
+        }
+
+        void OnDestruct( void *memBuf, size_t memSize ) const override
+        {
+            eirMappedStreamMetaInfo *meta = (eirMappedStreamMetaInfo*)memBuf;
+
+            meta->mapping->UnMapFileRegion( (void*)meta->data );
+
+            delete meta->mapping;
+
+            // Leave the stream where a translated stream would have left it.
+            meta->theStream->SeekNative( meta->pos, SEEK_SET );
+
+            meta->~eirMappedStreamMetaInfo();
+        }
+
+        size_t Read( void *memBuf, void *out_buf, size_t readCount ) const override
+        {
+            eirMappedStreamMetaInfo *meta = (eirMappedStreamMetaInfo*)memBuf;
+
+            if ( meta->pos >= (rw::int64)meta->dataSize )
+                return 0;
+
+            size_t canRead = std::min( readCount, meta->dataSize - (size_t)meta->pos );
+
+            memcpy( out_buf, meta->data + meta->pos, canRead );
+
+            meta->pos += canRead;
+
+            if ( rwStreamReadCallback_t readCB = meta->readCB )
+            {
+                readCB( meta->pos, (rw::int64)meta->dataSize, meta->readUD );
+            }
+
+            return canRead;
+        }
+
+        size_t Write( void *memBuf, const void *in_buf, size_t writeCount ) const override
+        {
+            // The mapping is read-only.
+            return 0;
+        }
+
+        void Skip( void *memBuf, rw::int64 skipCount ) const override
+        {
+            eirMappedStreamMetaInfo *meta = (eirMappedStreamMetaInfo*)memBuf;
+
+            rw::int64 newPos = ( meta->pos + skipCount );
+
+            if ( newPos >= 0 )
+            {
+                meta->pos = newPos;
+            }
+        }
+
+        rw::int64 Tell( const void *memBuf ) const override
+        {
+            const eirMappedStreamMetaInfo *meta = (const eirMappedStreamMetaInfo*)memBuf;
+
+            return meta->pos;
+        }
+
+        void Seek( void *memBuf, rw::int64 stream_offset, rw::eSeekMode seek_mode ) const override
+        {
+            eirMappedStreamMetaInfo *meta = (eirMappedStreamMetaInfo*)memBuf;
+
+            rw::int64 newPos = stream_offset;
+
+            if ( seek_mode == rw::RWSEEK_CUR )
+            {
+                newPos += meta->pos;
+            }
+            else if ( seek_mode == rw::RWSEEK_END )
+            {
+                newPos += (rw::int64)meta->dataSize;
+            }
+            else if ( seek_mode != rw::RWSEEK_BEG )
+            {
+                assert( 0 );
+            }
+
+            // Like a file, we may be past the end but not in front of the start.
+            if ( newPos >= 0 )
+            {
+                meta->pos = newPos;
+            }
+        }
+
+        rw::int64 Size( const void *memBuf ) const override
+        {
+            const eirMappedStreamMetaInfo *meta = (const eirMappedStreamMetaInfo*)memBuf;
+
+            return (rw::int64)meta->dataSize;
+        }
+
+        bool SupportsSize( const void *memBuf ) const override
+        {
+            return true;
+        }
+    };
+
     eirFileSystemWrapperProvider eirfs_file_wrap;
+    eirFileSystemMappingProvider eirfs_mapping_wrap;
 
     inline void Initialize( MainWindow *mainwnd )
     {
@@ -240,6 +709,7 @@ struct rwFileSystemStreamWrapEnv
         eirfs_file_wrap.nativeFileSystem = fileSys;
 
         rwEngine->RegisterStream( "eirfs_file", sizeof( eirFileSystemMetaInfo ), &eirfs_file_wrap );
+        rwEngine->RegisterStream( "eirfs_mapping", sizeof( eirMappedStreamMetaInfo ), &eirfs_mapping_wrap );
 
         // For backwards compatibility with Windows XP we want to skip the CRT for all kinds of file operations
         // because the Visual Studio Windows XP compatibility layer is broken.
@@ -259,13 +729,157 @@ struct rwFileSystemStreamWrapEnv
 
 rw::Stream* RwStreamCreateTranslated( rw::Interface *rwEngine, CFile *eirStream )
 {
-    rw::streamConstructionCustomParam_t customParam( "eirfs_file", eirStream );
+    return RwStreamCreateTranslated( rwEngine, eirStream, defaultStreamBufferSize );
+}
+
+rw::Stream* RwStreamCreateTranslated( rw::Interface *rwEngine, CFile *eirStream, size_t bufferSize )
+{
+    eirStreamConstructionParams params;
+    params.stream = eirStream;
+    params.bufferSize = bufferSize;
+    params.preallocSize = 0;
+    params.bufferWrites = false;
+    params.writeFailedOut = nullptr;
+    params.readCB = nullptr;
+    params.readUD = nullptr;
+
+    rw::streamConstructionCustomParam_t customParam( "eirfs_file", &params );
+
+    rw::Stream *result = rwEngine->CreateStream( rw::RWSTREAMTYPE_CUSTOM, rw::RWSTREAMMODE_READWRITE, &customParam );
+
+    return result;
+}
+
+rw::Stream* RwStreamCreateOutput( rw::Interface *rwEngine, CFile *eirStream, rw::uint64 expectedSize, bool preallocate, bool& writeFailedOut )
+{
+    // Collect the whole output if it is small, otherwise write it in big aligned blocks.
+    rw::uint64 bufferSize = ( ( expectedSize + defaultStreamBufferSize - 1 ) / defaultStreamBufferSize ) * defaultStreamBufferSize;
+
+    bufferSize = std::max( bufferSize, (rw::uint64)defaultStreamBufferSize );
+    bufferSize = std::min( bufferSize, (rw::uint64)maxOutputBufferSize );
+
+    eirStreamConstructionParams params;
+    params.stream = eirStream;
+    params.bufferSize = (size_t)bufferSize;
+    params.preallocSize = 0;
+    params.bufferWrites = true;
+    params.writeFailedOut = &writeFailedOut;
+    params.readCB = nullptr;
+    params.readUD = nullptr;
+
+    // Files that are written in one go do not need it.
+    if ( preallocate && expectedSize > bufferSize )
+    {
+        params.preallocSize = (rw::int64)expectedSize;
+    }
+
+    writeFailedOut = false;
+
+    rw::streamConstructionCustomParam_t customParam( "eirfs_file", &params );
 
     rw::Stream *result = rwEngine->CreateStream( rw::RWSTREAMTYPE_CUSTOM, rw::RWSTREAMMODE_READWRITE, &customParam );
 
     return result;
 }
 
+static rw::Stream* createMappedStream( rw::Interface *rwEngine, CFile *eirStream, rwStreamReadCallback_t readCB, void *ud )
+{
+    fsOffsetNumber_t streamSize = eirStream->GetSizeNative();
+
+    // Empty files cannot be mapped and huge ones do not fit into the address space.
+    if ( streamSize <= 0 || (rw::uint64)streamSize > (rw::uint64)std::numeric_limits <size_t>::max() )
+        return nullptr;
+
+    // Streams that are decoded on the fly do not have a mapping.
+    CFileMappingProvider *mapping = eirStream->CreateMapping();
+
+    if ( mapping == nullptr )
+        return nullptr;
+
+    rw::Stream *result = nullptr;
+
+    try
+    {
+        filemapAccessMode mode;
+        mode.allowRead = true;
+        mode.allowWrite = false;
+        mode.makePrivate = false;
+
+        void *data = mapping->MapFileRegion( 0, (size_t)streamSize, mode );
+
+        if ( data != nullptr )
+        {
+            eirMappingConstructionParams params;
+            params.stream = eirStream;
+            params.mapping = mapping;
+            params.data = (const char*)data;
+            params.dataSize = (size_t)streamSize;
+            params.readCB = readCB;
+            params.readUD = ud;
+
+            rw::streamConstructionCustomParam_t customParam( "eirfs_mapping", &params );
+
+            try
+            {
+                result = rwEngine->CreateStream( rw::RWSTREAMTYPE_CUSTOM, rw::RWSTREAMMODE_READONLY, &customParam );
+            }
+            catch( ... )
+            {
+                mapping->UnMapFileRegion( data );
+
+                throw;
+            }
+
+            if ( result == nullptr )
+            {
+                mapping->UnMapFileRegion( data );
+            }
+        }
+    }
+    catch( ... )
+    {
+        delete mapping;
+
+        throw;
+    }
+
+    // The stream owns the mapping now.
+    if ( result == nullptr )
+    {
+        delete mapping;
+    }
+
+    return result;
+}
+
+rw::Stream* RwStreamCreateMapped( rw::Interface *rwEngine, CFile *eirStream )
+{
+    return createMappedStream( rwEngine, eirStream, nullptr, nullptr );
+}
+
+rw::Stream* RwStreamCreateReader( rw::Interface *rwEngine, CFile *eirStream, rwStreamReadCallback_t readCB, void *ud )
+{
+    rw::Stream *result = createMappedStream( rwEngine, eirStream, readCB, ud );
+
+    if ( result == nullptr )
+    {
+        eirStreamConstructionParams params;
+        params.stream = eirStream;
+        params.bufferSize = defaultStreamBufferSize;
+        params.preallocSize = 0;
+        params.bufferWrites = false;
+        params.writeFailedOut = nullptr;
+        params.readCB = readCB;
+        params.readUD = ud;
+
+        rw::streamConstructionCustomParam_t customParam( "eirfs_file", &params );
+
+        result = rwEngine->CreateStream( rw::RWSTREAMTYPE_CUSTOM, rw::RWSTREAMMODE_READWRITE, &customParam );
+    }
+
+    return result;
+}
+
 void InitializeRWFileSystemWrap( void )
 {
     mainWindowFactory.RegisterDependantStructPlugin <rwFileSystemStreamWrapEnv> ();
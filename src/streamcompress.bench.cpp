@@ -0,0 +1,327 @@
+#include "mainwindow.h"
+
+#include "memfile.hxx"
+
+#include <chrono>
+#include <string>
+
+// Benchmark of the registered stream compression managers.
+// The corpus is loaded into memory first, so that only the codecs are measured.
+
+struct benchPayload
+{
+    filePath path;
+    std::string name;
+    std::vector <char> data;
+};
+
+struct benchCodecResult
+{
+    const char *name;
+    rw::uint64 compressedBytes = 0;
+    double compressSeconds = 0;
+    double decompressSeconds = 0;
+    rw::uint32 failureCount = 0;
+};
+
+typedef std::chrono::steady_clock benchClock;
+
+static double secondsSince( benchClock::time_point startTime )
+{
+    return std::chrono::duration <double> ( benchClock::now() - startTime ).count();
+}
+
+static std::string jsonEscape( const std::string& str )
+{
+    std::string escaped;
+
+    for ( char c : str )
+    {
+        if ( c == '"' || c == '\\' )
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if ( (unsigned char)c < 0x20 )
+        {
+            escaped += ' ';
+        }
+        else
+        {
+            escaped += c;
+        }
+    }
+
+    return escaped;
+}
+
+static void fillMemoryFile( CMemoryFile& file, const std::vector <char>& data )
+{
+    file.Reserve( data.size() );
+    file.Write( data.data(), data.size() );
+    file.Seek( 0, SEEK_SET );
+}
+
+// Payloads that are compressed already are measured in their decoded form.
+static void addPayload( MainWindow *mainWnd, CFile *stream, const filePath& relPath, std::vector <benchPayload>& payloadsOut )
+{
+    stream = CreateDecompressedStream( mainWnd, stream );
+
+    try
+    {
+        CMemoryFile contents( relPath );
+
+        contents.ReadFromStream( stream );
+
+        benchPayload payload;
+        payload.path = relPath;
+        payload.name = relPath.convert_ansi <FileSysCommonAllocator> ().GetConstString();
+        payload.data.assign( contents.GetData(), contents.GetData() + contents.GetDataSize() );
+
+        payloadsOut.push_back( std::move( payload ) );
+    }
+    catch( ... )
+    {
+        delete stream;
+
+        throw;
+    }
+
+    delete stream;
+}
+
+static void loadCorpus( MainWindow *mainWnd, CFileTranslator *corpusRoot, std::vector <benchPayload>& payloadsOut )
+{
+    auto per_file_cb = [&]( const filePath& filePathAbs )
+    {
+        filePath relPath;
+
+        if ( !corpusRoot->GetRelativePathFromRoot( filePathAbs, true, relPath ) )
+            return;
+
+        filePath extention;
+
+        FileSystem::GetFileNameItem <FileSysCommonAllocator> ( filePathAbs, false, nullptr, &extention );
+
+        if ( extention.equals( "TXD", false ) )
+        {
+            if ( CFile *stream = corpusRoot->Open( filePathAbs, L"rb" ) )
+            {
+                addPayload( mainWnd, stream, relPath, payloadsOut );
+            }
+        }
+        else if ( extention.equals( "IMG", false ) )
+        {
+            CIMGArchiveTranslatorHandle *imgRoot = mainWnd->fileSystem->OpenIMGArchive( corpusRoot, filePathAbs, false );
+
+            if ( imgRoot )
+            {
+                try
+                {
+                    auto per_entry_cb = [&]( const filePath& entryPath )
+                    {
+                        filePath entryExt;
+
+                        FileSystem::GetFileNameItem <FileSysCommonAllocator> ( entryPath, false, nullptr, &entryExt );
+
+                        if ( entryExt.equals( "TXD", false ) == false )
+                            return;
+
+                        filePath entryRelPath;
+
+                        imgRoot->GetRelativePathFromRoot( entryPath, true, entryRelPath );
+
+                        filePath payloadPath = relPath;
+                        payloadPath += "/";
+                        payloadPath += entryRelPath;
+
+                        if ( CFile *stream = imgRoot->Open( entryPath, L"rb" ) )
+                        {
+                            addPayload( mainWnd, stream, payloadPath, payloadsOut );
+                        }
+                    };
+
+                    imgRoot->ScanDirectory( "//", "*", true, nullptr, std::move( per_entry_cb ), nullptr );
+                }
+                catch( ... )
+                {
+                    delete imgRoot;
+
+                    throw;
+                }
+
+                delete imgRoot;
+            }
+        }
+    };
+
+    corpusRoot->ScanDirectory( "//", "*", true, nullptr, std::move( per_file_cb ), nullptr );
+}
+
+static void benchmarkCodec( compressionManager *manager, const std::vector <benchPayload>& payloads, unsigned int iterations, benchCodecResult& resultOut )
+{
+    compressionProvider *provider = manager->CreateProvider();
+
+    if ( provider == nullptr )
+    {
+        resultOut.failureCount = (rw::uint32)payloads.size();
+        return;
+    }
+
+    try
+    {
+        for ( unsigned int iter = 0; iter < iterations; iter++ )
+        {
+            for ( const benchPayload& payload : payloads )
+            {
+                CMemoryFile input( payload.path );
+                CMemoryFile compressed( payload.path );
+                CMemoryFile decompressed( payload.path );
+
+                fillMemoryFile( input, payload.data );
+
+                benchClock::time_point compressStart = benchClock::now();
+
+                bool couldCompress = provider->Compress( &input, &compressed );
+
+                resultOut.compressSeconds += secondsSince( compressStart );
+
+                compressed.Seek( 0, SEEK_SET );
+
+                benchClock::time_point decompressStart = benchClock::now();
+
+                bool couldDecompress = ( couldCompress && provider->Decompress( &compressed, &decompressed ) );
+
+                resultOut.decompressSeconds += secondsSince( decompressStart );
+
+                // Check the round trip, too.
+                bool isIdentical =
+                    couldDecompress &&
+                    decompressed.GetDataSize() == payload.data.size() &&
+                    memcmp( decompressed.GetData(), payload.data.data(), payload.data.size() ) == 0;
+
+                if ( iter == 0 )
+                {
+                    resultOut.compressedBytes += compressed.GetDataSize();
+
+                    if ( !isIdentical )
+                    {
+                        resultOut.failureCount++;
+                    }
+                }
+            }
+        }
+    }
+    catch( ... )
+    {
+        manager->DestroyProvider( provider );
+
+        throw;
+    }
+
+    manager->DestroyProvider( provider );
+}
+
+bool RunStreamCompressionBenchmark( MainWindow *mainWnd, CFileTranslator *corpusRoot, CFile *resultStream, unsigned int iterations )
+{
+    if ( iterations == 0 )
+    {
+        iterations = 1;
+    }
+
+    std::vector <benchPayload> payloads;
+
+    loadCorpus( mainWnd, corpusRoot, payloads );
+
+    rw::uint64 corpusBytes = 0;
+
+    for ( const benchPayload& payload : payloads )
+    {
+        corpusBytes += payload.data.size();
+    }
+
+    std::vector <compressionManager*> managers = GetStreamCompressionManagers( mainWnd );
+
+    // Detection cost for files that are not compressed, which is most of what the mass tools see.
+    // Probing asks every manager in turn, which is what the detection did before signatures.
+    double detectSeconds = 0;
+    double probeSeconds = 0;
+
+    for ( unsigned int iter = 0; iter < iterations; iter++ )
+    {
+        for ( const benchPayload& payload : payloads )
+        {
+            CMemoryFile *input = new CMemoryFile( payload.path );
+
+            fillMemoryFile( *input, payload.data );
+
+            benchClock::time_point detectStart = benchClock::now();
+
+            CFile *result = CreateDecompressedStream( mainWnd, input );
+
+            detectSeconds += secondsSince( detectStart );
+
+            delete result;
+
+            CMemoryFile probeInput( payload.path );
+
+            fillMemoryFile( probeInput, payload.data );
+
+            benchClock::time_point probeStart = benchClock::now();
+
+            for ( compressionManager *manager : managers )
+            {
+                manager->IsStreamCompressed( &probeInput );
+
+                probeInput.Seek( 0, SEEK_SET );
+            }
+
+            probeSeconds += secondsSince( probeStart );
+        }
+    }
+
+    std::vector <benchCodecResult> results;
+
+    for ( compressionManager *manager : managers )
+    {
+        benchCodecResult result;
+        result.name = manager->GetName();
+
+        benchmarkCodec( manager, payloads, iterations, result );
+
+        results.push_back( result );
+    }
+
+    // Write the results.
+    double megabytes = ( (double)corpusBytes * iterations / ( 1024 * 1024 ) );
+    double fileRuns = std::max( (double)payloads.size() * iterations, 1.0 );
+
+    std::string json = "{\n";
+    json += "  \"files\": " + std::to_string( payloads.size() ) + ",\n";
+    json += "  \"bytes\": " + std::to_string( corpusBytes ) + ",\n";
+    json += "  \"iterations\": " + std::to_string( iterations ) + ",\n";
+    json += "  \"detection\": {\n";
+    json += "    \"nsPerFile\": " + std::to_string( detectSeconds * 1e9 / fileRuns ) + ",\n";
+    json += "    \"probeNsPerFile\": " + std::to_string( probeSeconds * 1e9 / fileRuns ) + "\n";
+    json += "  },\n";
+    json += "  \"codecs\": [";
+
+    for ( size_t n = 0; n < results.size(); n++ )
+    {
+        const benchCodecResult& result = results[ n ];
+
+        json += ( n == 0 ? "\n" : ",\n" );
+        json += "    {\n";
+        json += "      \"name\": \"" + jsonEscape( result.name ) + "\",\n";
+        json += "      \"compressMBps\": " + std::to_string( result.compressSeconds > 0 ? megabytes / result.compressSeconds : 0.0 ) + ",\n";
+        json += "      \"decompressMBps\": " + std::to_string( result.decompressSeconds > 0 ? megabytes / result.decompressSeconds : 0.0 ) + ",\n";
+        json += "      \"ratio\": " + std::to_string( corpusBytes > 0 ? (double)result.compressedBytes / corpusBytes : 0.0 ) + ",\n";
+        json += "      \"failures\": " + std::to_string( result.failureCount ) + "\n";
+        json += "    }";
+    }
+
+    json += ( results.empty() ? "]\n" : "\n  ]\n" );
+    json += "}\n";
+
+    return ( resultStream->Write( json.c_str(), json.size() ) == json.size() );
+}
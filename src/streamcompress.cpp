@@ -2,18 +2,43 @@
 
 #include <sdk/PluginHelpers.h>
 
-struct streamCompressionEnv
+#include "tools/tooltrace.h"
+
+#include "memfile.hxx"
+
+#include "guiserialization.hxx"
+
+#include <atomic>
+
+// Compressed streams that decompress up to this size are decoded into memory by default.
+// Most compressed files are small TXDs inside of mobile and console IMG archives,
+// for which a temporary file on disk costs more than the decompression itself.
+static const size_t defaultInMemoryDecompressionLimit = ( 16 * 1024 * 1024 );
+
+// Signatures have to lie inside of this many bytes at the start of a stream.
+// Managers with signatures beyond are asked about every stream.
+static const size_t maxSignatureHeaderSize = 64;
+
+struct streamCompressionEnv : public magicSerializationProvider
 {
     inline void Initialize( MainWindow *mainWnd )
     {
         // Only establish the temporary root on demand.
         this->tmpRoot = nullptr;
 
+        this->inMemoryLimit = defaultInMemoryDecompressionLimit;
+
+        this->signatureHeaderSize = 0;
+
         this->lockRootConsistency = rw::CreateReadWriteLock( mainWnd->GetEngine() );
+
+        RegisterMainWindowSerialization( mainWnd, MAGICSERIALIZE_STREAMCOMPRESS, this );
     }
 
     inline void Shutdown( MainWindow *mainWnd )
     {
+        UnregisterMainWindowSerialization( mainWnd, MAGICSERIALIZE_STREAMCOMPRESS );
+
         rw::CloseReadWriteLock( mainWnd->GetEngine(), this->lockRootConsistency );
 
         // If we have a temporary repository, destroy it.
@@ -23,6 +48,27 @@ struct streamCompressionEnv
         }
     }
 
+    struct streamcompress_cfg_struct
+    {
+        endian::little_endian <rw::uint64> inMemoryLimit;
+    };
+
+    void Load( MainWindow *mainWnd, rw::BlockProvider& configBlock ) override
+    {
+        streamcompress_cfg_struct cfgStruct;
+        configBlock.readStruct( cfgStruct );
+
+        this->inMemoryLimit = (size_t)std::min( (rw::uint64)cfgStruct.inMemoryLimit, (rw::uint64)std::numeric_limits <size_t>::max() );
+    }
+
+    void Save( const MainWindow *mainWnd, rw::BlockProvider& configBlock ) const override
+    {
+        streamcompress_cfg_struct cfgStruct;
+        cfgStruct.inMemoryLimit = (rw::uint64)this->inMemoryLimit.load();
+
+        configBlock.writeStruct( cfgStruct );
+    }
+
     inline CFileTranslator* GetRepository( MainWindow *mainWnd )
     {
         if ( !this->tmpRoot )
@@ -45,7 +91,68 @@ struct streamCompressionEnv
 
     compressors_t compressors;
 
+    // Detection table that is built from the signatures of the registered managers.
+    struct signatureEntry
+    {
+        compressionSignature signature;
+        compressionManager *manager;
+    };
+
+    std::vector <signatureEntry> signatures;
+    size_t signatureHeaderSize;
+
+    // Managers without signatures.
+    compressors_t probedCompressors;
+
+    inline void RebuildSignatureTable( void )
+    {
+        this->signatures.clear();
+        this->probedCompressors.clear();
+        this->signatureHeaderSize = 0;
+
+        for ( compressionManager *manager : this->compressors )
+        {
+            const compressionSignature *managerSignatures = nullptr;
+
+            size_t signatureCount = manager->GetSignatures( managerSignatures );
+
+            bool areSignaturesUsable = ( signatureCount != 0 );
+
+            for ( size_t n = 0; n < signatureCount; n++ )
+            {
+                const compressionSignature& signature = managerSignatures[ n ];
+
+                if ( signature.length == 0 || signature.offset + signature.length > maxSignatureHeaderSize )
+                {
+                    areSignaturesUsable = false;
+                    break;
+                }
+            }
+
+            if ( !areSignaturesUsable )
+            {
+                this->probedCompressors.push_back( manager );
+                continue;
+            }
+
+            for ( size_t n = 0; n < signatureCount; n++ )
+            {
+                const compressionSignature& signature = managerSignatures[ n ];
+
+                signatureEntry entry;
+                entry.signature = signature;
+                entry.manager = manager;
+
+                this->signatures.push_back( entry );
+
+                this->signatureHeaderSize = std::max( this->signatureHeaderSize, signature.offset + signature.length );
+            }
+        }
+    }
+
     CFileTranslator *volatile tmpRoot;
+
+    std::atomic <size_t> inMemoryLimit;
 };
 
 static PluginDependantStructRegister <streamCompressionEnv, mainWindowFactory_t> streamCompressionEnvRegister;
@@ -156,20 +263,61 @@ struct CTemporaryFile : public CFile
     CFile *actualFile;
 };
 
-CFile* CreateDecompressedStream( MainWindow *mainWnd, CFile *compressed )
+static bool matchesSignature( const compressionSignature& signature, const unsigned char *header, size_t headerSize )
 {
-    // We want to pipe the stream if we find out that it really is compressed.
-    // For those we will create a special stream that will point to the new stream.
+    if ( signature.offset + signature.length > headerSize )
+        return false;
 
-    CFile *resultFile = compressed;
+    const unsigned char *data = ( header + signature.offset );
 
-    if ( streamCompressionEnv *env = streamCompressionEnvRegister.GetPluginStruct( mainWnd ) )
+    for ( size_t n = 0; n < signature.length; n++ )
     {
-        bool needsStreamReset = false;
+        unsigned char mask = ( signature.mask ? signature.mask[ n ] : 0xFF );
+
+        if ( ( data[ n ] & mask ) != ( signature.magic[ n ] & mask ) )
+            return false;
+    }
+
+    return true;
+}
+
+// Finds the manager of a compressed stream; the stream is at its start again afterwards.
+static compressionManager* findCompressionManager( streamCompressionEnv *env, CFile *compressed )
+{
+    compressionManager *theManager = nullptr;
+
+    bool needsStreamReset = false;
+
+    // All signatures are checked on a single read of the header.
+    if ( size_t signatureHeaderSize = env->signatureHeaderSize )
+    {
+        unsigned char header[ maxSignatureHeaderSize ];
+
+        size_t headerSize = compressed->Read( header, signatureHeaderSize );
 
-        compressionManager *theManager = nullptr;
+        needsStreamReset = true;
+
+        for ( const streamCompressionEnv::signatureEntry& entry : env->signatures )
+        {
+            if ( !matchesSignature( entry.signature, header, headerSize ) )
+                continue;
+
+            // Signatures are short, so let the manager confirm.
+            compressed->Seek( 0, SEEK_SET );
+
+            bool isCorrectFormat = entry.manager->IsStreamCompressed( compressed );
+
+            if ( isCorrectFormat )
+            {
+                theManager = entry.manager;
+                break;
+            }
+        }
+    }
 
-        for ( compressionManager *manager : env->compressors )
+    if ( theManager == nullptr )
+    {
+        for ( compressionManager *manager : env->probedCompressors )
         {
             if ( needsStreamReset )
             {
@@ -188,80 +336,212 @@ CFile* CreateDecompressedStream( MainWindow *mainWnd, CFile *compressed )
                 break;
             }
         }
+    }
+
+    if ( needsStreamReset )
+    {
+        compressed->Seek( 0, SEEK_SET );
+    }
+
+    return theManager;
+}
 
-        if ( needsStreamReset )
+// Memory file that refuses to grow beyond a limit, so that payloads of unknown size
+// do not end up in memory in full.
+struct limitedMemoryFile final : public CMemoryFile
+{
+    inline limitedMemoryFile( filePath path, size_t maxSize )
+        : CMemoryFile( std::move( path ) )
+    {
+        this->maxSize = maxSize;
+        this->hasOverflown = false;
+    }
+
+    size_t Write( const void *buffer, size_t writeCount ) override
+    {
+        fsOffsetNumber_t curPos = this->TellNative();
+
+        if ( this->hasOverflown || writeCount > this->maxSize || (fsOffsetNumber_t)( this->maxSize - writeCount ) < curPos )
         {
-            compressed->Seek( 0, SEEK_SET );
+            this->hasOverflown = true;
+
+            return 0;
+        }
+
+        return CMemoryFile::Write( buffer, writeCount );
+    }
+
+    inline bool HasOverflown( void ) const
+    {
+        return this->hasOverflown;
+    }
+
+private:
+    size_t maxSize;
+    bool hasOverflown;
+};
+
+static bool decompressWithManager( compressionManager *theManager, CFile *compressed, CFile *decFile )
+{
+    bool couldDecompress = false;
+
+    // Create a compression provider we will use.
+    compressionProvider *compressor = theManager->CreateProvider();
 
-            needsStreamReset = false;
+    if ( compressor )
+    {
+        try
+        {
+            TOOL_TRACE_SCOPE( "CreateDecompressedStream", compressed->GetPath() );
+
+            // Decompress!
+            couldDecompress = compressor->Decompress( compressed, decFile );
         }
+        catch( ... )
+        {
+            theManager->DestroyProvider( compressor );
+
+            throw;
+        }
+
+        theManager->DestroyProvider( compressor );
+    }
+
+    return couldDecompress;
+}
+
+CFile* CreateDecompressedStream( MainWindow *mainWnd, CFile *compressed )
+{
+    // We want to pipe the stream if we find out that it really is compressed.
+    // For those we will create a special stream that will point to the new stream.
+
+    CFile *resultFile = compressed;
+
+    if ( streamCompressionEnv *env = streamCompressionEnvRegister.GetPluginStruct( mainWnd ) )
+    {
+        compressionManager *theManager = findCompressionManager( env, compressed );
 
         // If we found a compressed format...
         if ( theManager )
         {
-            // ... we want to create a random file and decompress into it.
-            CFileTranslator *repo = env->GetRepository( mainWnd );
+            // ... we want to decompress it into memory or into a random file.
+            // The limit is about the decompressed payload. If the format does not store its size
+            // then we try memory anyway and give up once the output grows past the limit.
+            size_t inMemoryLimit = env->inMemoryLimit.load();
+
+            bool decompressInMemory = false;
+
+            if ( inMemoryLimit != 0 )
+            {
+                fsOffsetNumber_t decompressedSize = 0;
 
-            if ( repo )
+                bool isSizeKnown = theManager->GetDecompressedSize( compressed, decompressedSize );
+
+                compressed->Seek( 0, SEEK_SET );
+
+                decompressInMemory = ( !isSizeKnown || (fsOffsetNumber_t)inMemoryLimit >= decompressedSize );
+            }
+
+            if ( decompressInMemory )
             {
-                CFile *decFile = mainWnd->fileSystem->GenerateRandomFile( repo );
+                limitedMemoryFile *memFile = new limitedMemoryFile( compressed->GetPath(), inMemoryLimit );
+
+                bool couldDecompress;
 
-                if ( decFile )
+                try
                 {
-                    try
-                    {
-                        // Create a compression provider we will use.
-                        compressionProvider *compressor = theManager->CreateProvider();
-
-                        if ( compressor )
-                        {
-                            try
-                            {
-                                // Decompress!
-                                bool couldDecompress = compressor->Decompress( compressed, decFile );
-
-                                if ( couldDecompress )
-                                {
-                                    // Simply return the decompressed file.
-                                    decFile->Seek( 0, SEEK_SET );
-
-                                    CTemporaryFile *tmpFile = new CTemporaryFile( repo, decFile );
-
-                                    resultFile = tmpFile;
-
-                                    // We can free the other handle.
-                                    delete compressed;
-
-                                    compressed = nullptr;
-                                }
-                                else
-                                {
-                                    // We kinda failed. Just return the original stream.
-                                    compressed->Seek( 0, SEEK_SET );
-                                }
-                            }
-                            catch( ... )
-                            {
-                                theManager->DestroyProvider( compressor );
-
-                                throw;
-                            }
-
-                            theManager->DestroyProvider( compressor );
-                        }
-                    }
-                    catch( ... )
+                    couldDecompress = decompressWithManager( theManager, compressed, memFile );
+                }
+                catch( ... )
+                {
+                    delete memFile;
+
+                    throw;
+                }
+
+                bool hasOverflown = memFile->HasOverflown();
+
+                if ( couldDecompress && !hasOverflown )
+                {
+                    // Simply return the decompressed file.
+                    memFile->Seek( 0, SEEK_SET );
+
+                    // We can free the other handle.
+                    delete compressed;
+
+                    return memFile;
+                }
+
+                delete memFile;
+
+                compressed->Seek( 0, SEEK_SET );
+
+                if ( !hasOverflown )
+                {
+                    // We kinda failed. Just return the original stream.
+                    return compressed;
+                }
+
+                // Too big after all, so go through the stream or the disk.
+            }
+
+            CFileTranslator *repo = nullptr;
+            CFile *decFile = nullptr;
+
+            if ( CFile *streamingFile = theManager->OpenDecompressionStream( compressed ) )
+            {
+                // Big payloads are decoded while they are read, if the format allows it.
+                resultFile = streamingFile;
+
+                compressed = nullptr;
+            }
+            else
+            {
+                compressed->Seek( 0, SEEK_SET );
+
+                repo = env->GetRepository( mainWnd );
+
+                if ( repo )
+                {
+                    decFile = mainWnd->fileSystem->GenerateRandomFile( repo );
+                }
+            }
+
+            if ( decFile )
+            {
+                try
+                {
+                    bool couldDecompress = decompressWithManager( theManager, compressed, decFile );
+
+                    if ( couldDecompress )
                     {
-                        delete decFile;
+                        // Simply return the decompressed file.
+                        decFile->Seek( 0, SEEK_SET );
 
-                        throw;
-                    }
+                        resultFile = new CTemporaryFile( repo, decFile );
+
+                        // We can free the other handle.
+                        delete compressed;
 
-                    if ( resultFile == compressed )
+                        compressed = nullptr;
+                    }
+                    else
                     {
-                        delete decFile;
+                        // We kinda failed. Just return the original stream.
+                        compressed->Seek( 0, SEEK_SET );
                     }
                 }
+                catch( ... )
+                {
+                    delete decFile;
+
+                    throw;
+                }
+
+                if ( resultFile == compressed )
+                {
+                    delete decFile;
+                }
             }
         }
     }
@@ -269,6 +549,26 @@ CFile* CreateDecompressedStream( MainWindow *mainWnd, CFile *compressed )
     return resultFile;
 }
 
+void SetInMemoryDecompressionLimit( MainWindow *mainWnd, size_t maxDecompressedSize )
+{
+    if ( streamCompressionEnv *env = streamCompressionEnvRegister.GetPluginStruct( mainWnd ) )
+    {
+        env->inMemoryLimit.store( maxDecompressedSize );
+    }
+}
+
+size_t GetInMemoryDecompressionLimit( MainWindow *mainWnd )
+{
+    size_t limit = 0;
+
+    if ( streamCompressionEnv *env = streamCompressionEnvRegister.GetPluginStruct( mainWnd ) )
+    {
+        limit = env->inMemoryLimit.load();
+    }
+
+    return limit;
+}
+
 bool RegisterStreamCompressionManager( MainWindow *mainWnd, compressionManager *manager )
 {
     bool success = false;
@@ -277,12 +577,26 @@ bool RegisterStreamCompressionManager( MainWindow *mainWnd, compressionManager *
     {
         env->compressors.push_back( manager );
 
+        env->RebuildSignatureTable();
+
         success = true;
     }
 
     return success;
 }
 
+std::vector <compressionManager*> GetStreamCompressionManagers( MainWindow *mainWnd )
+{
+    std::vector <compressionManager*> managers;
+
+    if ( streamCompressionEnv *env = streamCompressionEnvRegister.GetPluginStruct( mainWnd ) )
+    {
+        managers = env->compressors;
+    }
+
+    return managers;
+}
+
 bool UnregisterStreamCompressionManager( MainWindow *mainWnd, compressionManager *manager )
 {
     bool success = false;
@@ -296,6 +610,8 @@ bool UnregisterStreamCompressionManager( MainWindow *mainWnd, compressionManager
         {
             env->compressors.erase( iter );
 
+            env->RebuildSignatureTable();
+
             success = true;
         }
     }
@@ -16,6 +16,25 @@ struct lzoStreamCompressionManager final : public compressionManager
         UnregisterStreamCompressionManager( mainWnd, this );
     }
 
+    const char* GetName( void ) const override
+    {
+        return "LZO";
+    }
+
+    size_t GetSignatures( const compressionSignature*& signaturesOut ) const override
+    {
+        // LZO compressed IMG entries start with the checksum 0x67A3A1CE.
+        static const unsigned char magic[] = { 0xCE, 0xA1, 0xA3, 0x67 };
+
+        static const compressionSignature signatures[] =
+        {
+            { 0, sizeof( magic ), magic, nullptr }
+        };
+
+        signaturesOut = signatures;
+        return 1;
+    }
+
     bool IsStreamCompressed( CFile *stream ) const override
     {
         try
@@ -2,14 +2,553 @@
 
 #include <sdk/PluginHelpers.h>
 
+#include <QtZlib/zlib.h>
+
+#include "tools/workerpool.h"
+
+#include <vector>
+#include <algorithm>
+#include <thread>
+
 #define MAGIC_NUM       'MH2Z'
 
+// Decodes a zlib stream while it is being read.
+// Only a window of recently decoded data is kept, which serves small backward seeks.
+// A seek back beyond the window restarts the decoder and keeps all data from then on.
+struct CZLIBDecompressionStream final : public CFile
+{
+    static const size_t decodeChunkSize = 0x10000;
+    static const size_t maxHistorySize = 0x40000;
+
+    inline CZLIBDecompressionStream( CFile *compressed, fsOffsetNumber_t dataOffset, size_t decompressedSize )
+    {
+        this->compressed = compressed;
+        this->dataOffset = dataOffset;
+        this->decompressedSize = decompressedSize;
+        this->seekPos = 0;
+        this->windowStart = 0;
+        this->keepAllData = false;
+        this->hasStreamEnded = false;
+
+        memset( &this->zstream, 0, sizeof( this->zstream ) );
+
+        this->isInitialized = ( inflateInit( &this->zstream ) == Z_OK );
+    }
+
+    inline ~CZLIBDecompressionStream( void )
+    {
+        if ( this->isInitialized )
+        {
+            inflateEnd( &this->zstream );
+        }
+
+        if ( this->compressed )
+        {
+            delete this->compressed;
+        }
+    }
+
+    inline bool IsInitialized( void ) const
+    {
+        return this->isInitialized;
+    }
+
+    // Gives the compressed stream back to the caller.
+    inline void ReleaseCompressed( void )
+    {
+        this->compressed = nullptr;
+    }
+
+    size_t Read( void *buffer, size_t readCount ) override
+    {
+        char *outBuf = (char*)buffer;
+
+        size_t totalRead = 0;
+
+        while ( totalRead < readCount && this->seekPos < this->decompressedSize )
+        {
+            if ( this->seekPos < this->windowStart )
+            {
+                this->RestartDecoding();
+            }
+
+            size_t windowEnd = ( this->windowStart + this->window.size() );
+
+            if ( this->seekPos < windowEnd )
+            {
+                size_t canRead = std::min( readCount - totalRead, windowEnd - this->seekPos );
+
+                memcpy( outBuf + totalRead, this->window.data() + ( this->seekPos - this->windowStart ), canRead );
+
+                this->seekPos += canRead;
+                totalRead += canRead;
+                continue;
+            }
+
+            this->TrimWindow();
+
+            if ( !this->DecodeMore() )
+                break;
+        }
+
+        return totalRead;
+    }
+
+    size_t Write( const void *buffer, size_t writeCount ) override
+    {
+        return 0;
+    }
+
+    int Seek( long iOffset, int iType ) override
+    {
+        return this->SeekNative( iOffset, iType );
+    }
+
+    int SeekNative( fsOffsetNumber_t iOffset, int iType ) override
+    {
+        fsOffsetNumber_t basePos;
+
+        if ( iType == SEEK_SET )
+        {
+            basePos = 0;
+        }
+        else if ( iType == SEEK_CUR )
+        {
+            basePos = (fsOffsetNumber_t)this->seekPos;
+        }
+        else if ( iType == SEEK_END )
+        {
+            basePos = (fsOffsetNumber_t)this->decompressedSize;
+        }
+        else
+        {
+            return -1;
+        }
+
+        fsOffsetNumber_t newPos = ( basePos + iOffset );
+
+        if ( newPos < 0 )
+            return -1;
+
+        // The data is decoded lazily on the next read.
+        this->seekPos = (size_t)newPos;
+
+        return 0;
+    }
+
+    long Tell( void ) const noexcept override
+    {
+        return (long)this->seekPos;
+    }
+
+    fsOffsetNumber_t TellNative( void ) const noexcept override
+    {
+        return (fsOffsetNumber_t)this->seekPos;
+    }
+
+    bool IsEOF( void ) const noexcept override
+    {
+        return ( this->seekPos >= this->decompressedSize );
+    }
+
+    bool QueryStats( filesysStats& statsOut ) const noexcept override
+    {
+        return this->compressed->QueryStats( statsOut );
+    }
+
+    void SetFileTimes( time_t atime, time_t ctime, time_t mtime ) override
+    {
+        return;
+    }
+
+    void SetSeekEnd( void ) override
+    {
+        return;
+    }
+
+    size_t GetSize( void ) const noexcept override
+    {
+        return this->decompressedSize;
+    }
+
+    fsOffsetNumber_t GetSizeNative( void ) const noexcept override
+    {
+        return (fsOffsetNumber_t)this->decompressedSize;
+    }
+
+    void Flush( void ) override
+    {
+        return;
+    }
+
+    CFileMappingProvider* CreateMapping( void ) override
+    {
+        return nullptr;
+    }
+
+    filePath GetPath( void ) const override
+    {
+        return this->compressed->GetPath();
+    }
+
+    bool IsReadable( void ) const noexcept override
+    {
+        return true;
+    }
+
+    bool IsWriteable( void ) const noexcept override
+    {
+        return false;
+    }
+
+private:
+    // Appends the next chunk of decoded data to the window.
+    bool DecodeMore( void )
+    {
+        if ( this->hasStreamEnded )
+            return false;
+
+        size_t oldSize = this->window.size();
+
+        this->window.resize( oldSize + decodeChunkSize );
+
+        this->zstream.next_out = (Bytef*)( this->window.data() + oldSize );
+        this->zstream.avail_out = (uInt)decodeChunkSize;
+
+        while ( this->zstream.avail_out != 0 )
+        {
+            if ( this->zstream.avail_in == 0 )
+            {
+                size_t readCount = this->compressed->Read( this->inputBuffer, sizeof( this->inputBuffer ) );
+
+                if ( readCount == 0 )
+                {
+                    this->hasStreamEnded = true;
+                    break;
+                }
+
+                this->zstream.next_in = (Bytef*)this->inputBuffer;
+                this->zstream.avail_in = (uInt)readCount;
+            }
+
+            int result = inflate( &this->zstream, Z_NO_FLUSH );
+
+            if ( result != Z_OK )
+            {
+                // Either done or broken data; there is nothing more to get in both cases.
+                this->hasStreamEnded = true;
+                break;
+            }
+        }
+
+        size_t decodedCount = ( decodeChunkSize - this->zstream.avail_out );
+
+        this->window.resize( oldSize + decodedCount );
+
+        return ( decodedCount != 0 );
+    }
+
+    // Forgets data that is too far behind the read position.
+    void TrimWindow( void )
+    {
+        if ( this->keepAllData )
+            return;
+
+        size_t historySize = std::min( this->seekPos - this->windowStart, this->window.size() );
+
+        if ( historySize > maxHistorySize )
+        {
+            size_t dropCount = ( historySize - maxHistorySize );
+
+            this->window.erase( this->window.begin(), this->window.begin() + dropCount );
+
+            this->windowStart += dropCount;
+        }
+    }
+
+    void RestartDecoding( void )
+    {
+        this->compressed->SeekNative( this->dataOffset, SEEK_SET );
+
+        inflateReset( &this->zstream );
+
+        this->zstream.avail_in = 0;
+
+        this->window.clear();
+        this->windowStart = 0;
+        this->hasStreamEnded = false;
+
+        // We were asked for old data once, so expect it again.
+        this->keepAllData = true;
+    }
+
+    CFile *compressed;
+    fsOffsetNumber_t dataOffset;
+    size_t decompressedSize;
+
+    z_stream zstream;
+    bool isInitialized;
+    bool hasStreamEnded;
+
+    std::vector <char> window;
+    size_t windowStart;
+    bool keepAllData;
+
+    size_t seekPos;
+
+    char inputBuffer[ 0x4000 ];
+};
+
+// Compression into a zlib stream on all cores, like pigz does it.
+// The input is cut into blocks that are deflated independently, each primed with the end of
+// the block before it as dictionary. All blocks but the last end on a sync flush, so that
+// they concatenate into a single deflate stream that every zlib decoder understands.
+static const size_t deflateBlockSize = 0x20000;
+static const size_t deflateDictionarySize = 0x8000;
+
+struct deflateBlock
+{
+    const unsigned char *data;
+    size_t dataSize;
+    const unsigned char *dictionary;
+    size_t dictionarySize;
+    bool isLast;
+
+    std::vector <unsigned char> output;
+    uLong adler;
+    bool success;
+};
+
+static bool compressDeflateBlock( deflateBlock& block )
+{
+    z_stream zstream;
+
+    memset( &zstream, 0, sizeof( zstream ) );
+
+    // Raw deflate; the zlib header and checksum are written around all blocks.
+    if ( deflateInit2( &zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY ) != Z_OK )
+        return false;
+
+    bool success = false;
+
+    try
+    {
+        if ( block.dictionarySize != 0 )
+        {
+            deflateSetDictionary( &zstream, block.dictionary, (uInt)block.dictionarySize );
+        }
+
+        // Leave room for the sync flush marker.
+        block.output.resize( deflateBound( &zstream, (uLong)block.dataSize ) + 16 );
+
+        zstream.next_in = (Bytef*)block.data;
+        zstream.avail_in = (uInt)block.dataSize;
+        zstream.next_out = (Bytef*)block.output.data();
+        zstream.avail_out = (uInt)block.output.size();
+
+        int result = deflate( &zstream, ( block.isLast ? Z_FINISH : Z_SYNC_FLUSH ) );
+
+        if ( block.isLast )
+        {
+            success = ( result == Z_STREAM_END );
+        }
+        else
+        {
+            success = ( result == Z_OK && zstream.avail_in == 0 && zstream.avail_out != 0 );
+        }
+
+        block.output.resize( block.output.size() - zstream.avail_out );
+
+        block.adler = adler32( adler32( 0, nullptr, 0 ), block.data, (uInt)block.dataSize );
+    }
+    catch( ... )
+    {
+        deflateEnd( &zstream );
+
+        throw;
+    }
+
+    deflateEnd( &zstream );
+
+    return success;
+}
+
+static size_t readFully( CFile *input, unsigned char *buffer, size_t size )
+{
+    size_t totalRead = 0;
+
+    while ( totalRead < size )
+    {
+        size_t readCount = input->Read( buffer + totalRead, size - totalRead );
+
+        if ( readCount == 0 )
+            break;
+
+        totalRead += readCount;
+    }
+
+    return totalRead;
+}
+
+static void deflateBlockJob( rw::Interface *rwEngine, size_t jobIndex, void *ud )
+{
+    deflateBlock& block = ( (deflateBlock*)ud )[ jobIndex ];
+
+    try
+    {
+        block.success = compressDeflateBlock( block );
+    }
+    catch( ... )
+    {
+        block.success = false;
+    }
+}
+
+static bool compressZLIBParallel( rw::Interface *rwEngine, CFile *input, size_t inputSize, CFile *output )
+{
+    unsigned int threadCount = std::max( std::thread::hardware_concurrency(), 1u );
+
+    // Keep every thread busy while the results of a batch are written.
+    // Small inputs do not need the whole batch.
+    size_t batchCapacity = std::min( threadCount * 2 * deflateBlockSize, inputSize );
+
+    std::vector <unsigned char> batchData( batchCapacity );
+
+    size_t maxBlockCount = std::max( ( batchCapacity + deflateBlockSize - 1 ) / deflateBlockSize, (size_t)1 );
+
+    // The blocks keep their output buffers from batch to batch.
+    std::vector <deflateBlock> blocks( maxBlockCount );
+
+    // The same helpers serve all batches of the stream.
+    // Inputs that fit into a single block are compressed right here.
+    ToolJobPool *jobPool = nullptr;
+
+    if ( maxBlockCount > 1 )
+    {
+        jobPool = new ToolJobPool( rwEngine, (unsigned int)std::min( (size_t)threadCount, maxBlockCount ), nullptr, nullptr );
+    }
+
+    bool success = true;
+
+    try
+    {
+        // The end of the previous batch primes its first block.
+        std::vector <unsigned char> prevTail;
+
+        // Default compression level and a 32KB window.
+        static const unsigned char zlibHeader[] = { 0x78, 0x9C };
+
+        output->Write( zlibHeader, sizeof( zlibHeader ) );
+
+        uLong adler = adler32( 0, nullptr, 0 );
+
+        size_t totalRead = 0;
+
+        bool isDone = false;
+
+        while ( !isDone )
+        {
+            size_t batchSize = readFully( input, batchData.data(), batchData.size() );
+
+            totalRead += batchSize;
+
+            // The size of the input is known, so a full last batch is found as well.
+            // Should the input end early right at a batch boundary, the next batch is a single empty block.
+            isDone = ( batchSize < batchData.size() || totalRead >= inputSize );
+
+            size_t blockCount = std::max( ( batchSize + deflateBlockSize - 1 ) / deflateBlockSize, (size_t)1 );
+
+            for ( size_t n = 0; n < blockCount; n++ )
+            {
+                deflateBlock& block = blocks[ n ];
+
+                size_t blockOffset = ( n * deflateBlockSize );
+
+                block.data = ( batchData.data() + blockOffset );
+                block.dataSize = std::min( deflateBlockSize, batchSize - blockOffset );
+
+                if ( n == 0 )
+                {
+                    block.dictionary = prevTail.data();
+                    block.dictionarySize = prevTail.size();
+                }
+                else
+                {
+                    block.dictionary = ( block.data - deflateDictionarySize );
+                    block.dictionarySize = deflateDictionarySize;
+                }
+
+                block.isLast = ( isDone && n == blockCount - 1 );
+                block.adler = 0;
+                block.success = false;
+            }
+
+            if ( jobPool )
+            {
+                jobPool->RunJobs( blockCount, deflateBlockJob, blocks.data() );
+            }
+            else
+            {
+                deflateBlockJob( rwEngine, 0, blocks.data() );
+            }
+
+            for ( size_t n = 0; n < blockCount; n++ )
+            {
+                const deflateBlock& block = blocks[ n ];
+
+                if ( !block.success )
+                {
+                    success = false;
+                    break;
+                }
+
+                output->Write( block.output.data(), block.output.size() );
+
+                adler = adler32_combine( adler, block.adler, (z_off_t)block.dataSize );
+            }
+
+            if ( !success )
+                break;
+
+            size_t tailSize = std::min( batchSize, deflateDictionarySize );
+
+            prevTail.assign( batchData.data() + batchSize - tailSize, batchData.data() + batchSize );
+        }
+
+        if ( success )
+        {
+            // The checksum of the uncompressed data is stored big endian.
+            unsigned char zlibTrailer[] =
+            {
+                (unsigned char)( adler >> 24 ),
+                (unsigned char)( adler >> 16 ),
+                (unsigned char)( adler >> 8 ),
+                (unsigned char)( adler )
+            };
+
+            output->Write( zlibTrailer, sizeof( zlibTrailer ) );
+        }
+    }
+    catch( ... )
+    {
+        delete jobPool;
+
+        throw;
+    }
+
+    delete jobPool;
+
+    return success;
+}
+
 // Meh. I made this just for fun. Manhunt 2 does not use RW TXD formats anyway.
 
 struct mh2zCompressionEnv : public compressionManager
 {
     inline void Initialize( MainWindow *mainWnd )
     {
+        this->rwEngine = mainWnd->GetEngine();
+
         RegisterStreamCompressionManager( mainWnd, this );
     }
 
@@ -24,6 +563,24 @@ struct mh2zCompressionEnv : public compressionManager
         endian::little_endian <std::uint32_t> decomp_size;
     };
 
+    const char* GetName( void ) const override
+    {
+        return "MH2Z";
+    }
+
+    size_t GetSignatures( const compressionSignature*& signaturesOut ) const override
+    {
+        static const unsigned char magic[] = { 'Z', '2', 'H', 'M' };
+
+        static const compressionSignature signatures[] =
+        {
+            { 0, sizeof( magic ), magic, nullptr }
+        };
+
+        signaturesOut = signatures;
+        return 1;
+    }
+
     bool IsStreamCompressed( CFile *input ) const override
     {
         mh2zHeader header;
@@ -42,8 +599,55 @@ struct mh2zCompressionEnv : public compressionManager
         return true;
     }
 
+    CFile* OpenDecompressionStream( CFile *compressed ) override
+    {
+        mh2zHeader header;
+
+        if ( !compressed->ReadStruct( header ) )
+        {
+            return nullptr;
+        }
+
+        if ( header.magic[0] != 'Z' || header.magic[1] != '2' || header.magic[2] != 'H' || header.magic[3] != 'M' )
+        {
+            return nullptr;
+        }
+
+        CZLIBDecompressionStream *stream = new CZLIBDecompressionStream( compressed, compressed->TellNative(), (std::uint32_t)header.decomp_size );
+
+        if ( !stream->IsInitialized() )
+        {
+            // Do not take over the compressed stream.
+            stream->ReleaseCompressed();
+
+            delete stream;
+
+            return nullptr;
+        }
+
+        return stream;
+    }
+
+    bool GetDecompressedSize( CFile *compressed, fsOffsetNumber_t& sizeOut ) const override
+    {
+        mh2zHeader header;
+
+        if ( !compressed->ReadStruct( header ) )
+        {
+            return false;
+        }
+
+        sizeOut = (fsOffsetNumber_t)(std::uint32_t)header.decomp_size;
+        return true;
+    }
+
     struct mh2zCompressionProvider final : public compressionProvider
     {
+        inline mh2zCompressionProvider( rw::Interface *rwEngine )
+        {
+            this->rwEngine = rwEngine;
+        }
+
         bool Compress( CFile *input, CFile *output ) override
         {
             // Write the MH2Z header.
@@ -52,13 +656,15 @@ struct mh2zCompressionEnv : public compressionManager
             header.magic[1] = '2';
             header.magic[2] = 'H';
             header.magic[3] = 'M';
-            header.decomp_size = (size_t)( input->GetSizeNative() - input->TellNative() );
+            size_t inputSize = (size_t)( input->GetSizeNative() - input->TellNative() );
+
+            header.decomp_size = inputSize;
 
             output->WriteStruct( header );
 
             // Now the compression data.
-            fileSystem->CompressZLIBStream( input, output, true );
-            return true;
+            // Big files are compressed on all cores.
+            return compressZLIBParallel( this->rwEngine, input, inputSize, output );
         }
 
         bool Decompress( CFile *input, CFile *output ) override
@@ -81,11 +687,13 @@ struct mh2zCompressionEnv : public compressionManager
             fileSystem->DecompressZLIBStream( input, output, dataSize, true );
             return true;
         }
+
+        rw::Interface *rwEngine;
     };
 
     compressionProvider* CreateProvider( void ) override
     {
-        mh2zCompressionProvider *prov = new mh2zCompressionProvider();
+        mh2zCompressionProvider *prov = new mh2zCompressionProvider( this->rwEngine );
 
         return prov;
     }
@@ -96,6 +704,8 @@ struct mh2zCompressionEnv : public compressionManager
 
         delete dprov;
     }
+
+    rw::Interface *rwEngine;
 };
 
 static PluginDependantStructRegister <mh2zCompressionEnv, mainWindowFactory_t> mh2zComprRegister;
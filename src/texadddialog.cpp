@@ -1261,7 +1261,7 @@ void TexAddDialog::OnPlatformSelect(const QString& _)
         if (hasPreview)
         {
             this->previewInfoLabel->setVisible( true );
-            this->previewInfoLabel->setText( TexInfoWidget::getDefaultRasterInfoString( origRaster ) );
+            this->previewInfoLabel->setText( TexInfoItem::getDefaultRasterInfoString( origRaster ) );
         }
         else
         {
@@ -0,0 +1,674 @@
+#include "mainwindow.h"
+
+#include <QtGui/QPainter>
+#include <QtWidgets/QApplication>
+
+#include <algorithm>
+#include <atomic>
+
+#include "qtrwutils.hxx"
+
+// Thumbnails are square and fit into a list row.
+static const int texThumbnailSize = 44;
+
+// Rows that have been scrolled past long ago are not worth a thumbnail anymore.
+static const size_t maxPendingThumbnails = 64;
+
+// Memory that the images of the texture viewport may take, which is enough for a few big textures.
+static const size_t maxViewPixmapBytes = ( 128 * 1024 * 1024 );
+
+TexInfoItem::TexInfoItem( TexInfoModel *model, rw::TextureBase *texItem )
+{
+    this->model = model;
+    this->rwTextureHandle = texItem;
+    this->hasText = false;
+    this->hasThumbnail = false;
+    this->isThumbnailPending = false;
+}
+
+void TexInfoItem::updateInfo( void )
+{
+    this->hasText = false;
+
+    this->model->itemChanged( this );
+}
+
+void TexInfoItem::buildText( void )
+{
+    // Construct some information about our texture item.
+    if ( rw::TextureBase *texHandle = this->rwTextureHandle )
+    {
+        QString textureInfo;
+
+        if ( rw::Raster *rasterInfo = texHandle->GetRaster() )
+        {
+            textureInfo = getDefaultRasterInfoString( rasterInfo );
+        }
+
+        this->nameText = ansi_to_qt( texHandle->GetName() );
+        this->infoText = textureInfo;
+    }
+    else
+    {
+        this->nameText = getLanguageItemByKey( "Main.TexInfo.NoTex" );
+        this->infoText = getLanguageItemByKey( "Main.TexInfo.Invalid" );
+    }
+
+    this->hasText = true;
+}
+
+const QString& TexInfoItem::GetNameText( void )
+{
+    if ( !this->hasText )
+    {
+        this->buildText();
+    }
+
+    return this->nameText;
+}
+
+const QString& TexInfoItem::GetInfoText( void )
+{
+    if ( !this->hasText )
+    {
+        this->buildText();
+    }
+
+    return this->infoText;
+}
+
+void TexInfoItem::remove( void )
+{
+    this->model->removeItem( this );
+}
+
+TexInfoModel::TexInfoModel( MainWindow *mainWnd, QObject *parent ) : QAbstractListModel( parent )
+{
+    this->mainWnd = mainWnd;
+    this->runningThumbnail = nullptr;
+    this->isShutdown = false;
+    this->viewPixmapBytes = 0;
+
+    RegisterTextLocalizationItem( this );
+}
+
+TexInfoModel::~TexInfoModel( void )
+{
+    UnregisterTextLocalizationItem( this );
+
+    this->shutdownThumbnails();
+
+    this->deleteItems();
+}
+
+void TexInfoModel::deleteItems( void )
+{
+    for ( TexInfoItem *texInfo : this->items )
+    {
+        this->forgetThumbnail( texInfo );
+
+        delete texInfo;
+    }
+
+    this->items.clear();
+
+    this->viewPixmaps.clear();
+    this->viewPixmapBytes = 0;
+}
+
+int TexInfoModel::rowCount( const QModelIndex& parent ) const
+{
+    if ( parent.isValid() )
+        return 0;
+
+    return (int)this->items.size();
+}
+
+QVariant TexInfoModel::data( const QModelIndex& index, int role ) const
+{
+    TexInfoItem *texInfo = this->getItem( index );
+
+    if ( texInfo == nullptr )
+        return QVariant();
+
+    if ( role == Qt::DisplayRole )
+    {
+        return texInfo->GetNameText();
+    }
+    else if ( role == TexInfoRole )
+    {
+        return texInfo->GetInfoText();
+    }
+    else if ( role == Qt::DecorationRole )
+    {
+        if ( texInfo->hasThumbnail )
+        {
+            return texInfo->thumbnail;
+        }
+
+        // Only rows that are painted ask for it.
+        const_cast <TexInfoModel*> ( this )->requestThumbnail( texInfo );
+    }
+
+    return QVariant();
+}
+
+void TexInfoModel::setTextures( rw::TexDictionary *txdObj )
+{
+    this->beginResetModel();
+
+    this->deleteItems();
+
+    if ( txdObj )
+    {
+        this->items.reserve( txdObj->GetTextureCount() );
+
+        for ( rw::TexDictionary::texIter_t iter( txdObj->GetTextureIterator() ); iter.IsEnd() == false; iter.Increment() )
+        {
+            this->items.push_back( new TexInfoItem( this, iter.Resolve() ) );
+        }
+    }
+
+    this->endResetModel();
+}
+
+TexInfoItem* TexInfoModel::addTexture( rw::TextureBase *texHandle )
+{
+    int row = (int)this->items.size();
+
+    TexInfoItem *texInfo = new TexInfoItem( this, texHandle );
+
+    this->beginInsertRows( QModelIndex(), row, row );
+
+    this->items.push_back( texInfo );
+
+    this->endInsertRows();
+
+    return texInfo;
+}
+
+void TexInfoModel::removeItem( TexInfoItem *texInfo )
+{
+    QModelIndex index = this->getIndex( texInfo );
+
+    if ( !index.isValid() )
+        return;
+
+    int row = index.row();
+
+    this->beginRemoveRows( QModelIndex(), row, row );
+
+    this->items.erase( this->items.begin() + row );
+
+    this->endRemoveRows();
+
+    this->forgetThumbnail( texInfo );
+    this->forgetViewPixmaps( texInfo );
+
+    // The views are done with it now.
+    delete texInfo;
+}
+
+TexInfoItem* TexInfoModel::getItem( const QModelIndex& index ) const
+{
+    if ( !index.isValid() || index.model() != this )
+        return nullptr;
+
+    int row = index.row();
+
+    if ( row < 0 || row >= (int)this->items.size() )
+        return nullptr;
+
+    return this->items[ row ];
+}
+
+QModelIndex TexInfoModel::getIndex( const TexInfoItem *texInfo ) const
+{
+    auto iter = std::find( this->items.begin(), this->items.end(), texInfo );
+
+    if ( iter == this->items.end() )
+        return QModelIndex();
+
+    return this->index( (int)( iter - this->items.begin() ) );
+}
+
+void TexInfoModel::itemChanged( TexInfoItem *texInfo )
+{
+    this->forgetThumbnail( texInfo );
+    this->forgetViewPixmaps( texInfo );
+
+    texInfo->hasThumbnail = false;
+    texInfo->thumbnail = QPixmap();
+
+    QModelIndex index = this->getIndex( texInfo );
+
+    if ( index.isValid() )
+    {
+        emit dataChanged( index, index );
+    }
+}
+
+void TexInfoModel::allItemsChanged( void )
+{
+    for ( TexInfoItem *texInfo : this->items )
+    {
+        texInfo->hasText = false;
+    }
+
+    if ( this->items.empty() == false )
+    {
+        emit dataChanged( this->index( 0 ), this->index( (int)this->items.size() - 1 ) );
+    }
+}
+
+void TexInfoModel::allTexturesChanged( void )
+{
+    for ( TexInfoItem *texInfo : this->items )
+    {
+        this->forgetThumbnail( texInfo );
+
+        texInfo->hasThumbnail = false;
+        texInfo->thumbnail = QPixmap();
+    }
+
+    this->viewPixmaps.clear();
+    this->viewPixmapBytes = 0;
+
+    if ( this->items.empty() == false )
+    {
+        emit dataChanged( this->index( 0 ), this->index( (int)this->items.size() - 1 ), { Qt::DecorationRole } );
+    }
+}
+
+bool TexInfoModel::getViewPixmap( TexInfoItem *texInfo, bool drawMipmapLayers, QPixmap& pixmapOut )
+{
+    for ( auto iter = this->viewPixmaps.begin(); iter != this->viewPixmaps.end(); iter++ )
+    {
+        if ( iter->texInfo == texInfo && iter->drawMipmapLayers == drawMipmapLayers )
+        {
+            pixmapOut = iter->pixmap;
+
+            // Mark it as most recently used.
+            this->viewPixmaps.splice( this->viewPixmaps.begin(), this->viewPixmaps, iter );
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TexInfoModel::putViewPixmap( TexInfoItem *texInfo, bool drawMipmapLayers, const QPixmap& pixmap )
+{
+    size_t byteSize = ( (size_t)pixmap.width() * pixmap.height() * pixmap.depth() / 8 );
+
+    // Images that do not fit at all are not worth throwing the others out.
+    if ( byteSize > maxViewPixmapBytes )
+        return;
+
+    this->viewPixmaps.remove_if(
+        [&]( const viewPixmapEntry& entry )
+        {
+            if ( entry.texInfo != texInfo || entry.drawMipmapLayers != drawMipmapLayers )
+                return false;
+
+            this->viewPixmapBytes -= entry.byteSize;
+            return true;
+        }
+    );
+
+    while ( this->viewPixmaps.empty() == false && this->viewPixmapBytes + byteSize > maxViewPixmapBytes )
+    {
+        this->viewPixmapBytes -= this->viewPixmaps.back().byteSize;
+
+        this->viewPixmaps.pop_back();
+    }
+
+    viewPixmapEntry entry;
+    entry.texInfo = texInfo;
+    entry.drawMipmapLayers = drawMipmapLayers;
+    entry.pixmap = pixmap;
+    entry.byteSize = byteSize;
+
+    this->viewPixmaps.push_front( std::move( entry ) );
+
+    this->viewPixmapBytes += byteSize;
+}
+
+void TexInfoModel::forgetViewPixmaps( TexInfoItem *texInfo )
+{
+    this->viewPixmaps.remove_if(
+        [&]( const viewPixmapEntry& entry )
+        {
+            if ( entry.texInfo != texInfo )
+                return false;
+
+            this->viewPixmapBytes -= entry.byteSize;
+            return true;
+        }
+    );
+}
+
+void TexInfoModel::updateContent( MainWindow *mainWnd )
+{
+    // The raster info contains localized text.
+    this->allItemsChanged();
+}
+
+// Making of a thumbnail on the action thread of the editor.
+// It works on a copy of the raster, so that the editor can keep changing the texture meanwhile.
+struct texThumbnailAction
+{
+    inline texThumbnailAction( TexInfoModel *model, TexInfoItem *texInfo, rw::Interface *rwEngine, rw::Raster *texRaster ) : isCancelled( false )
+    {
+        this->model = model;
+        this->texInfo = texInfo;
+        this->rwEngine = rwEngine;
+        this->texRaster = texRaster;
+    }
+
+    TexInfoModel *model;
+    TexInfoItem *texInfo;   // nullptr if the result is not wanted anymore
+
+    rw::Interface *rwEngine;
+    rw::Raster *texRaster;
+
+    // Set by the GUI thread if the thumbnail has not been started yet but is not wanted anymore.
+    std::atomic <bool> isCancelled;
+
+    QImage thumbnailImage;
+};
+
+struct texThumbnailFinishEvent : public QEvent
+{
+    inline texThumbnailFinishEvent( texThumbnailAction *action ) : QEvent( QEvent::User )
+    {
+        this->action = action;
+    }
+
+    texThumbnailAction *action;
+};
+
+static void texThumbnailActionRuntime( MagicActionSystem *system, void *ud )
+{
+    texThumbnailAction *action = (texThumbnailAction*)ud;
+
+    rw::Interface *rwEngine = action->rwEngine;
+
+    if ( !action->isCancelled )
+    {
+        // Nobody wants to hear about warnings of thumbnails.
+        rw::AssignThreadedRuntimeConfig( rwEngine );
+
+        try
+        {
+            rwEngine->SetWarningManager( nullptr );
+
+            try
+            {
+                // magic-rw cannot give us a single mipmap level, so we scale down the base level.
+                rw::Bitmap rasterBitmap = action->texRaster->getBitmap();
+
+                QImage texImage = convertRWBitmapToQImage( rasterBitmap );
+
+                action->thumbnailImage = texImage.scaled( texThumbnailSize, texThumbnailSize, Qt::KeepAspectRatio, Qt::SmoothTransformation );
+            }
+            catch( rw::RwException& )
+            {
+                // Textures that cannot be decoded have no thumbnail.
+            }
+        }
+        catch( ... )
+        {
+            rw::ReleaseThreadedRuntimeConfig( rwEngine );
+
+            throw;
+        }
+
+        rw::ReleaseThreadedRuntimeConfig( rwEngine );
+    }
+
+    QCoreApplication::postEvent( action->model, new texThumbnailFinishEvent( action ) );
+}
+
+void TexInfoModel::requestThumbnail( TexInfoItem *texInfo )
+{
+    if ( texInfo->isThumbnailPending || this->isShutdown )
+        return;
+
+    texInfo->isThumbnailPending = true;
+
+    this->pendingThumbnails.push_front( texInfo );
+
+    while ( this->pendingThumbnails.size() > maxPendingThumbnails )
+    {
+        TexInfoItem *oldTexInfo = this->pendingThumbnails.back();
+
+        this->pendingThumbnails.pop_back();
+
+        // It is asked for again if its row is painted again.
+        oldTexInfo->isThumbnailPending = false;
+    }
+
+    this->launchNextThumbnail();
+}
+
+void TexInfoModel::forgetThumbnail( TexInfoItem *texInfo )
+{
+    if ( !texInfo->isThumbnailPending )
+        return;
+
+    texInfo->isThumbnailPending = false;
+
+    texThumbnailAction *action = this->runningThumbnail;
+
+    if ( action && action->texInfo == texInfo )
+    {
+        // It finishes on its own; the result is thrown away then.
+        action->texInfo = nullptr;
+        action->isCancelled = true;
+    }
+    else
+    {
+        this->pendingThumbnails.remove( texInfo );
+    }
+}
+
+void TexInfoModel::launchNextThumbnail( void )
+{
+    // We make one thumbnail at a time, so that loading of TXDs does not have to wait long.
+    if ( this->runningThumbnail != nullptr || this->isShutdown )
+        return;
+
+    MagicActionSystem *actionSystem = this->mainWnd->GetActionSystem();
+
+    if ( actionSystem == nullptr )
+        return;
+
+    rw::Interface *rwEngine = this->mainWnd->GetEngine();
+
+    while ( this->pendingThumbnails.empty() == false )
+    {
+        TexInfoItem *texInfo = this->pendingThumbnails.front();
+
+        this->pendingThumbnails.pop_front();
+
+        rw::Raster *texRaster = nullptr;
+
+        if ( rw::TextureBase *texHandle = texInfo->GetTextureHandle() )
+        {
+            if ( rw::Raster *origRaster = texHandle->GetRaster() )
+            {
+                try
+                {
+                    texRaster = rw::CloneRaster( origRaster );
+                }
+                catch( rw::RwException& )
+                {
+                    texRaster = nullptr;
+                }
+            }
+        }
+
+        if ( texRaster == nullptr )
+        {
+            // There is nothing to show.
+            texInfo->isThumbnailPending = false;
+            texInfo->hasThumbnail = true;
+            continue;
+        }
+
+        texThumbnailAction *action = new texThumbnailAction( this, texInfo, rwEngine, texRaster );
+
+        this->runningThumbnail = action;
+
+        actionSystem->LaunchAction( texThumbnailActionRuntime, action );
+        break;
+    }
+}
+
+void TexInfoModel::finishThumbnail( texThumbnailAction *action )
+{
+    this->runningThumbnail = nullptr;
+
+    if ( TexInfoItem *texInfo = action->texInfo )
+    {
+        texInfo->isThumbnailPending = false;
+        texInfo->hasThumbnail = true;
+        texInfo->thumbnail = QPixmap::fromImage( action->thumbnailImage );
+
+        QModelIndex index = this->getIndex( texInfo );
+
+        if ( index.isValid() )
+        {
+            emit dataChanged( index, index, { Qt::DecorationRole } );
+        }
+    }
+
+    rw::DeleteRaster( action->texRaster );
+
+    delete action;
+
+    this->launchNextThumbnail();
+}
+
+void TexInfoModel::shutdownThumbnails( void )
+{
+    if ( this->isShutdown )
+        return;
+
+    this->isShutdown = true;
+
+    for ( TexInfoItem *texInfo : this->pendingThumbnails )
+    {
+        texInfo->isThumbnailPending = false;
+    }
+
+    this->pendingThumbnails.clear();
+
+    // The action thread is gone, so nobody uses the running thumbnail anymore.
+    if ( texThumbnailAction *action = this->runningThumbnail )
+    {
+        if ( TexInfoItem *texInfo = action->texInfo )
+        {
+            texInfo->isThumbnailPending = false;
+        }
+
+        rw::DeleteRaster( action->texRaster );
+
+        delete action;
+
+        this->runningThumbnail = nullptr;
+    }
+}
+
+void TexInfoModel::customEvent( QEvent *evt )
+{
+    if ( texThumbnailFinishEvent *finishEvt = dynamic_cast <texThumbnailFinishEvent*> ( evt ) )
+    {
+        // After shutdown the action has been deleted already.
+        if ( !this->isShutdown )
+        {
+            this->finishThumbnail( finishEvt->action );
+        }
+
+        return;
+    }
+
+    QAbstractListModel::customEvent( evt );
+}
+
+// Same look as the QLabel#label19px and QLabel#texInfo styles.
+static const int texThumbnailMargin = 5;
+static const int texNamePixelSize = 19;
+static const int texInfoPixelSize = 16;
+static const int texNameHeight = 23;
+static const int texInfoItemHeight = 54;
+
+void TexInfoDelegate::paint( QPainter *painter, const QStyleOptionViewItem& option, const QModelIndex& index ) const
+{
+    QStyleOptionViewItem itemOption( option );
+
+    this->initStyleOption( &itemOption, index );
+
+    // Let the style draw the row background, we draw the rest ourselves.
+    itemOption.text.clear();
+    itemOption.icon = QIcon();
+    itemOption.features &= ~QStyleOptionViewItem::HasDecoration;
+
+    const QWidget *widget = itemOption.widget;
+
+    QStyle *style = ( widget ? widget->style() : QApplication::style() );
+
+    style->drawControl( QStyle::CE_ItemViewItem, &itemOption, painter, widget );
+
+    QString nameText = index.data( Qt::DisplayRole ).toString();
+    QString infoText = index.data( TexInfoModel::TexInfoRole ).toString();
+
+    QVariant thumbnailData = index.data( Qt::DecorationRole );
+
+    QRect thumbnailRect( itemOption.rect.left() + texThumbnailMargin, itemOption.rect.top() + ( itemOption.rect.height() - texThumbnailSize ) / 2, texThumbnailSize, texThumbnailSize );
+
+    QRect textRect = itemOption.rect.adjusted( thumbnailRect.right() + 1 - itemOption.rect.left() + texThumbnailMargin, 4, 0, -5 );
+
+    QRect nameRect( textRect.left(), textRect.top(), textRect.width(), texNameHeight );
+    QRect infoRect( textRect.left(), nameRect.bottom() + 1, textRect.width(), textRect.bottom() - nameRect.bottom() );
+
+    painter->save();
+
+    if ( thumbnailData.isValid() )
+    {
+        QPixmap thumbnail = thumbnailData.value <QPixmap> ();
+
+        // Center it, since the texture does not have to be square.
+        QSize thumbnailSize = thumbnail.size();
+
+        QPoint thumbnailPos(
+            thumbnailRect.left() + ( texThumbnailSize - thumbnailSize.width() ) / 2,
+            thumbnailRect.top() + ( texThumbnailSize - thumbnailSize.height() ) / 2
+        );
+
+        painter->drawPixmap( thumbnailPos, thumbnail );
+    }
+
+    QFont nameFont = itemOption.font;
+    nameFont.setPixelSize( texNamePixelSize );
+
+    painter->setFont( nameFont );
+    painter->setPen( itemOption.palette.color( QPalette::Text ) );
+    painter->drawText( nameRect, Qt::AlignLeft | Qt::AlignVCenter, QFontMetrics( nameFont ).elidedText( nameText, Qt::ElideRight, nameRect.width() ) );
+
+    QFont infoFont = itemOption.font;
+    infoFont.setPixelSize( texInfoPixelSize );
+
+    painter->setFont( infoFont );
+    painter->setPen( QColor( 0x66, 0x61, 0x78 ) );
+    painter->drawText( infoRect, Qt::AlignLeft | Qt::AlignVCenter, QFontMetrics( infoFont ).elidedText( infoText, Qt::ElideRight, infoRect.width() ) );
+
+    painter->restore();
+}
+
+QSize TexInfoDelegate::sizeHint( const QStyleOptionViewItem& option, const QModelIndex& index ) const
+{
+    // The text is cut to the width of the list, so the rows do not have to be measured.
+    return QSize( 0, texInfoItemHeight );
+}
@@ -3,7 +3,7 @@
 
 #include "texnameutils.hxx"
 
-TexNameWindow::TexNameWindow( MainWindow *mainWnd, TexInfoWidget *texInfo ) : QDialog( mainWnd )
+TexNameWindow::TexNameWindow( MainWindow *mainWnd, TexInfoItem *texInfo ) : QDialog( mainWnd )
 {
     this->setWindowFlags( this->windowFlags() & ~Qt::WindowContextHelpButtonHint );
     this->mainWnd = mainWnd;
@@ -79,7 +79,7 @@ void TexNameWindow::OnRequestSet( bool checked )
     std::string ansiTexName = qt_to_ansi( texName );
 
     // Set it.
-    if ( TexInfoWidget *texInfo = this->texInfo )
+    if ( TexInfoItem *texInfo = this->texInfo )
     {
         if ( rw::TextureBase *texHandle = texInfo->GetTextureHandle() )
         {
@@ -90,9 +90,6 @@ void TexNameWindow::OnRequestSet( bool checked )
 
             // Update the info item.
             texInfo->updateInfo();
-
-            // Update texture list width
-            texInfo->listItem->setSizeHint(QSize(mainWnd->textureListWidget->sizeHintForColumn(0), 54));
         }
     }
 
@@ -108,7 +105,7 @@ void TexNameWindow::UpdateAccessibility( void )
 
     if ( shouldAllowSet )
     {
-        if ( TexInfoWidget *texInfo = this->texInfo )
+        if ( TexInfoItem *texInfo = this->texInfo )
         {
             if ( rw::TextureBase *texHandle = texInfo->GetTextureHandle() )
             {
@@ -0,0 +1,267 @@
+#include "mainwindow.h"
+
+#include "buildmanifest.h"
+#include "tooltrace.h"
+
+#include <vector>
+
+static const char *const manifestHeaderTag = "MTXD-MANIFEST 1";
+
+BuildManifest::BuildManifest( rw::uint64 configHash )
+{
+    this->configHash = configHash;
+}
+
+static bool parseHex64( const char *str, size_t len, rw::uint64& valueOut )
+{
+    if ( len == 0 || len > 16 )
+        return false;
+
+    rw::uint64 value = 0;
+
+    for ( size_t n = 0; n < len; n++ )
+    {
+        char c = str[ n ];
+
+        rw::uint64 digit;
+
+        if ( c >= '0' && c <= '9' )
+        {
+            digit = ( c - '0' );
+        }
+        else if ( c >= 'a' && c <= 'f' )
+        {
+            digit = ( c - 'a' + 10 );
+        }
+        else if ( c >= 'A' && c <= 'F' )
+        {
+            digit = ( c - 'A' + 10 );
+        }
+        else
+        {
+            return false;
+        }
+
+        value = ( value << 4 ) | digit;
+    }
+
+    valueOut = value;
+    return true;
+}
+
+static std::string toHex64( rw::uint64 value )
+{
+    static const char hexDigits[] = "0123456789abcdef";
+
+    char buf[ 16 ];
+
+    for ( int n = 15; n >= 0; n-- )
+    {
+        buf[ n ] = hexDigits[ value & 0xF ];
+
+        value >>= 4;
+    }
+
+    return std::string( buf, 16 );
+}
+
+void BuildManifest::Load( CFileTranslator *root, const filePath& path )
+{
+    CFile *manifestStream = root->Open( path, L"rb" );
+
+    if ( manifestStream == nullptr )
+        return;
+
+    std::string content;
+
+    try
+    {
+        size_t fileSize = manifestStream->GetSize();
+
+        content.resize( fileSize );
+
+        size_t readCount = manifestStream->Read( &content[ 0 ], fileSize );
+
+        content.resize( readCount );
+    }
+    catch( ... )
+    {
+        delete manifestStream;
+
+        throw;
+    }
+
+    delete manifestStream;
+
+    // Go through all the lines.
+    size_t lineStart = 0;
+    bool isHeaderLine = true;
+
+    while ( lineStart < content.size() )
+    {
+        size_t lineEnd = content.find( '\n', lineStart );
+
+        if ( lineEnd == std::string::npos )
+        {
+            lineEnd = content.size();
+        }
+
+        const char *line = content.c_str() + lineStart;
+        size_t lineLen = ( lineEnd - lineStart );
+
+        lineStart = ( lineEnd + 1 );
+
+        if ( lineLen > 0 && line[ lineLen - 1 ] == '\r' )
+        {
+            lineLen--;
+        }
+
+        // Each line has the form "<hash> <text>".
+        size_t spacePos = std::string( line, lineLen ).rfind( ' ', 16 );
+
+        if ( spacePos == std::string::npos )
+        {
+            if ( isHeaderLine )
+                return;
+
+            continue;
+        }
+
+        if ( isHeaderLine )
+        {
+            // The header is "<tag> <config hash>".
+            // If the configuration changed, everything has to be built again.
+            size_t tagLen = strlen( manifestHeaderTag );
+
+            rw::uint64 previousConfigHash;
+
+            if ( lineLen <= tagLen + 1 || strncmp( line, manifestHeaderTag, tagLen ) != 0 ||
+                 !parseHex64( line + tagLen + 1, lineLen - tagLen - 1, previousConfigHash ) ||
+                 previousConfigHash != this->configHash )
+            {
+                return;
+            }
+
+            isHeaderLine = false;
+            continue;
+        }
+
+        rw::uint64 contentHash;
+
+        if ( parseHex64( line, spacePos, contentHash ) )
+        {
+            this->previousEntries[ std::string( line + spacePos + 1, lineLen - spacePos - 1 ) ] = contentHash;
+        }
+    }
+}
+
+bool BuildManifest::Save( CFileTranslator *root, const filePath& path ) const
+{
+    CFile *manifestStream = root->Open( path, L"wb" );
+
+    if ( manifestStream == nullptr )
+        return false;
+
+    try
+    {
+        std::string content = manifestHeaderTag;
+        content += ' ';
+        content += toHex64( this->configHash );
+        content += '\n';
+
+        for ( const auto& entry : this->currentEntries )
+        {
+            content += toHex64( entry.second );
+            content += ' ';
+            content += entry.first;
+            content += '\n';
+        }
+
+        manifestStream->Write( content.c_str(), content.size() );
+    }
+    catch( ... )
+    {
+        delete manifestStream;
+
+        throw;
+    }
+
+    delete manifestStream;
+
+    return true;
+}
+
+rw::uint64 BuildManifest::HashStream( CFile *stream )
+{
+    manifestHasher hasher;
+
+    stream->Seek( 0, SEEK_SET );
+
+    std::vector <char> buffer( 0x10000 );
+
+    while ( true )
+    {
+        size_t readCount = stream->Read( buffer.data(), buffer.size() );
+
+        if ( readCount == 0 )
+            break;
+
+        hasher.Feed( buffer.data(), readCount );
+    }
+
+    // Also take the size into account.
+    hasher.FeedValue( stream->GetSizeNative() );
+
+    stream->Seek( 0, SEEK_SET );
+
+    return hasher.GetHash();
+}
+
+bool BuildManifest::HashFile( CFileTranslator *root, const filePath& path, rw::uint64& hashOut )
+{
+    CFile *hashStream = root->Open( path, L"rb" );
+
+    if ( hashStream == nullptr )
+        return false;
+
+    TOOL_TRACE_SCOPE( "HashSourceFile", path );
+
+    try
+    {
+        hashOut = HashStream( hashStream );
+    }
+    catch( ... )
+    {
+        delete hashStream;
+
+        throw;
+    }
+
+    delete hashStream;
+
+    return true;
+}
+
+bool BuildManifest::IsUnchanged( const filePath& relPath, rw::uint64 contentHash ) const
+{
+    auto findIter = this->previousEntries.find( GetPathKey( relPath ) );
+
+    if ( findIter == this->previousEntries.end() )
+        return false;
+
+    return ( findIter->second == contentHash );
+}
+
+void BuildManifest::Record( const filePath& relPath, rw::uint64 contentHash )
+{
+    this->currentEntries[ GetPathKey( relPath ) ] = contentHash;
+}
+
+std::string BuildManifest::GetPathKey( const filePath& relPath )
+{
+    auto widePath = relPath.convert_unicode <FileSysCommonAllocator> ();
+
+    auto utf8Path = CharacterUtil::ConvertStrings <wchar_t, char8_t, FileSysCommonAllocator> ( widePath.GetConstString() );
+
+    return std::string( (const char*)utf8Path.GetConstString(), utf8Path.GetLength() );
+}
@@ -0,0 +1,116 @@
+// Manifest of the files that a mass tool has produced during its last run.
+// Each source file is remembered by a hash of its contents, so that unchanged files
+// can be skipped on the next run with the same configuration.
+
+#pragma once
+
+#include <map>
+#include <string>
+
+// 64bit FNV-1a hash; good enough to detect changed files.
+struct manifestHasher
+{
+    inline manifestHasher( void )
+    {
+        this->hash = 0xCBF29CE484222325ULL;
+    }
+
+    inline void Feed( const void *data, size_t dataSize )
+    {
+        const unsigned char *bytes = (const unsigned char*)data;
+
+        rw::uint64 hash = this->hash;
+
+        for ( size_t n = 0; n < dataSize; n++ )
+        {
+            hash ^= bytes[ n ];
+            hash *= 0x100000001B3ULL;
+        }
+
+        this->hash = hash;
+    }
+
+    template <typename valueType>
+    inline void FeedValue( const valueType& value )
+    {
+        this->Feed( &value, sizeof( value ) );
+    }
+
+    inline rw::uint64 GetHash( void ) const
+    {
+        return this->hash;
+    }
+
+private:
+    rw::uint64 hash;
+};
+
+struct BuildManifest
+{
+    BuildManifest( rw::uint64 configHash );
+
+    // Reads the manifest of the previous run.
+    // Entries are only taken over if the previous run used the same configuration.
+    void Load( CFileTranslator *root, const filePath& path );
+    bool Save( CFileTranslator *root, const filePath& path ) const;
+
+    // Hashes the entire contents of a stream, starting from its beginning.
+    static rw::uint64 HashStream( CFile *stream );
+
+    // Same for a file; returns false if it cannot be opened.
+    static bool HashFile( CFileTranslator *root, const filePath& path, rw::uint64& hashOut );
+
+    // Returns true if the file was built from the same contents last time.
+    bool IsUnchanged( const filePath& relPath, rw::uint64 contentHash ) const;
+
+    // Remembers the file for the next run.
+    void Record( const filePath& relPath, rw::uint64 contentHash );
+
+private:
+    static std::string GetPathKey( const filePath& relPath );
+
+    rw::uint64 configHash;
+
+    std::map <std::string, rw::uint64> previousEntries;
+    std::map <std::string, rw::uint64> currentEntries;
+};
+
+// A source file of the game root that is remembered once its output is complete.
+// Whoever builds the output records it, and only if the build succeeded, so that a
+// fallback copy of a failed file is built again on the next run.
+struct BuildManifestEntry
+{
+    inline BuildManifestEntry( void )
+    {
+        this->manifest = nullptr;
+        this->sourceRoot = nullptr;
+        this->hasContentHash = false;
+        this->contentHash = 0;
+    }
+
+    inline void Record( void )
+    {
+        BuildManifest *manifest = this->manifest;
+
+        if ( manifest == nullptr )
+            return;
+
+        if ( !this->hasContentHash )
+        {
+            this->hasContentHash = BuildManifest::HashFile( this->sourceRoot, this->sourcePath, this->contentHash );
+        }
+
+        if ( this->hasContentHash )
+        {
+            manifest->Record( this->relPath, this->contentHash );
+        }
+    }
+
+    BuildManifest *manifest;
+    CFileTranslator *sourceRoot;
+    filePath sourcePath;
+    filePath relPath;
+
+    bool hasContentHash;
+    rw::uint64 contentHash;
+};
@@ -0,0 +1,444 @@
+#include "mainwindow.h"
+
+#include "costestimate.h"
+
+// RenderWare chunk ids that we care about.
+static const rw::uint32 rwchunkStruct = 0x01;
+static const rw::uint32 rwchunkTextureNative = 0x15;
+static const rw::uint32 rwchunkTexDictionary = 0x16;
+
+struct rwChunkHeader
+{
+    rw::uint32 type;
+    rw::uint32 size;
+    rw::uint32 version;
+};
+
+static bool readChunkHeader( CFile *stream, rwChunkHeader& headerOut )
+{
+    return ( stream->Read( &headerOut, sizeof( headerOut ) ) == sizeof( headerOut ) );
+}
+
+template <typename numberType>
+static inline numberType readLE( const unsigned char *data )
+{
+    numberType value = 0;
+
+    for ( size_t n = 0; n < sizeof( numberType ); n++ )
+    {
+        value |= (numberType)data[ n ] << ( n * 8 );
+    }
+
+    return value;
+}
+
+rw::uint64 txdTextureHeaderInfo::GetPixelCount( void ) const
+{
+    if ( !this->hasDimensions )
+    {
+        // Assume about one byte per pixel.
+        return this->dataSize;
+    }
+
+    rw::uint64 pixelCount = 0;
+
+    rw::uint32 width = this->width;
+    rw::uint32 height = this->height;
+
+    for ( rw::uint32 n = 0; n < std::max( this->mipmapCount, 1u ); n++ )
+    {
+        pixelCount += (rw::uint64)width * height;
+
+        width = std::max( width / 2, 1u );
+        height = std::max( height / 2, 1u );
+    }
+
+    return pixelCount;
+}
+
+// Filter modes as RenderWare stores them in files.
+static rw::eRasterStageFilterMode getFilterModeFromFileValue( rw::uint8 value )
+{
+    switch( value )
+    {
+    case 2:     return rw::RWFILTER_LINEAR;
+    case 3:     return rw::RWFILTER_POINT_POINT;
+    case 4:     return rw::RWFILTER_POINT_LINEAR;
+    case 5:     return rw::RWFILTER_LINEAR_POINT;
+    case 6:     return rw::RWFILTER_LINEAR_LINEAR;
+    default:    break;
+    }
+
+    return rw::RWFILTER_POINT;
+}
+
+static void parseTextureNativeStruct( const unsigned char *data, size_t dataSize, txdTextureHeaderInfo& infoOut )
+{
+    if ( dataSize < 4 )
+        return;
+
+    rw::uint32 platformId = readLE <rw::uint32> ( data );
+
+    infoOut.platformId = platformId;
+
+    // We only understand the Direct3D layout, which is what most files are.
+    // Everything else is estimated by its size.
+    if ( platformId == rwplatformD3D8 || platformId == rwplatformD3D9 )
+    {
+        // platform, filtering, name[32], maskName[32], rasterFormat, d3dFormat/hasAlpha,
+        // width, height, depth, mipmapCount, rasterType, flags/compression.
+        if ( dataSize < 88 )
+            return;
+
+        rw::uint32 formatField = readLE <rw::uint32> ( data + 76 );
+
+        infoOut.filterMode = getFilterModeFromFileValue( data[ 4 ] );
+
+        infoOut.width = readLE <rw::uint16> ( data + 80 );
+        infoOut.height = readLE <rw::uint16> ( data + 82 );
+        infoOut.mipmapCount = data[ 85 ];
+        infoOut.hasDimensions = ( infoOut.width != 0 && infoOut.height != 0 );
+
+        if ( platformId == rwplatformD3D9 )
+        {
+            // The D3DFORMAT is a FOURCC code "DXT1" to "DXT5" for compressed rasters.
+            rw::uint32 dxtType = ( formatField >> 24 );
+
+            infoOut.isCompressed = ( ( formatField & 0x00FFFFFF ) == 0x545844 && dxtType >= '1' && dxtType <= '5' );
+            infoOut.hasAlpha = ( ( data[ 87 ] & 0x01 ) != 0 );
+        }
+        else
+        {
+            infoOut.hasAlpha = ( formatField != 0 );
+            infoOut.isCompressed = ( data[ 87 ] != 0 );
+        }
+    }
+}
+
+bool ReadTXDTextureHeaders( CFile *stream, std::vector <txdTextureHeaderInfo>& texturesOut )
+{
+    rwChunkHeader txdHeader;
+
+    if ( !readChunkHeader( stream, txdHeader ) || txdHeader.type != rwchunkTexDictionary )
+        return false;
+
+    fsOffsetNumber_t txdEnd = stream->TellNative() + txdHeader.size;
+
+    // Skip the texture dictionary struct.
+    rwChunkHeader structHeader;
+
+    if ( !readChunkHeader( stream, structHeader ) || structHeader.type != rwchunkStruct )
+        return false;
+
+    stream->SeekNative( structHeader.size, SEEK_CUR );
+
+    while ( stream->TellNative() < txdEnd )
+    {
+        rwChunkHeader chunkHeader;
+
+        if ( !readChunkHeader( stream, chunkHeader ) )
+            break;
+
+        fsOffsetNumber_t chunkEnd = stream->TellNative() + chunkHeader.size;
+
+        if ( chunkHeader.type == rwchunkTextureNative )
+        {
+            txdTextureHeaderInfo info;
+            info.dataSize = chunkHeader.size;
+
+            rwChunkHeader nativeStructHeader;
+
+            if ( readChunkHeader( stream, nativeStructHeader ) && nativeStructHeader.type == rwchunkStruct )
+            {
+                unsigned char structData[ 88 ];
+
+                size_t readCount = stream->Read( structData, std::min( (size_t)nativeStructHeader.size, sizeof( structData ) ) );
+
+                parseTextureNativeStruct( structData, readCount, info );
+            }
+
+            texturesOut.push_back( info );
+        }
+
+        if ( stream->SeekNative( chunkEnd, SEEK_SET ) != 0 )
+            break;
+    }
+
+    return true;
+}
+
+rw::uint64 EstimateTXDDecodedSize( CFile *stream )
+{
+    fsOffsetNumber_t startPos = stream->TellNative();
+
+    std::vector <txdTextureHeaderInfo> textures;
+
+    bool isTXD = ReadTXDTextureHeaders( stream, textures );
+
+    stream->SeekNative( startPos, SEEK_SET );
+
+    if ( !isTXD )
+    {
+        // Maybe compressed; assume about four bytes per byte of the file.
+        return (rw::uint64)( stream->GetSizeNative() - startPos ) * 4;
+    }
+
+    rw::uint64 decodedSize = 0;
+
+    for ( const txdTextureHeaderInfo& info : textures )
+    {
+        decodedSize += info.GetDecodedSize();
+    }
+
+    return decodedSize;
+}
+
+template <typename numberType>
+static inline numberType readBE( const unsigned char *data )
+{
+    numberType value = 0;
+
+    for ( size_t n = 0; n < sizeof( numberType ); n++ )
+    {
+        value = (numberType)( ( value << 8 ) | data[ n ] );
+    }
+
+    return value;
+}
+
+// Looks for the frame header of a JPEG, which follows the tables at the start of the file.
+static bool readJPEGDimensions( CFile *stream, rw::uint32& widthOut, rw::uint32& heightOut )
+{
+    unsigned char marker[ 4 ];
+
+    if ( stream->Read( marker, 2 ) != 2 || marker[0] != 0xFF || marker[1] != 0xD8 )
+        return false;
+
+    // Do not walk through big files for nothing.
+    for ( unsigned int n = 0; n < 64; n++ )
+    {
+        if ( stream->Read( marker, 4 ) != 4 || marker[0] != 0xFF )
+            return false;
+
+        unsigned char type = marker[1];
+        rw::uint16 segmentSize = readBE <rw::uint16> ( marker + 2 );
+
+        if ( segmentSize < 2 )
+            return false;
+
+        // Start of frame, except for the huffman, arithmetic and their coding tables.
+        if ( type >= 0xC0 && type <= 0xCF && type != 0xC4 && type != 0xC8 && type != 0xCC )
+        {
+            unsigned char frame[ 5 ];
+
+            if ( stream->Read( frame, sizeof( frame ) ) != sizeof( frame ) )
+                return false;
+
+            heightOut = readBE <rw::uint16> ( frame + 1 );
+            widthOut = readBE <rw::uint16> ( frame + 3 );
+            return true;
+        }
+
+        stream->SeekNative( segmentSize - 2, SEEK_CUR );
+    }
+
+    return false;
+}
+
+static bool readImageDimensions( CFile *stream, const filePath& extention, rw::uint32& widthOut, rw::uint32& heightOut, rw::uint32& mipmapCountOut )
+{
+    unsigned char header[ 32 ];
+
+    mipmapCountOut = 1;
+
+    if ( stream->Read( header, sizeof( header ) ) != sizeof( header ) )
+        return false;
+
+    if ( header[0] == 0x89 && header[1] == 'P' && header[2] == 'N' && header[3] == 'G' )
+    {
+        // The IHDR chunk always comes first.
+        widthOut = readBE <rw::uint32> ( header + 16 );
+        heightOut = readBE <rw::uint32> ( header + 20 );
+        return true;
+    }
+
+    if ( header[0] == 'D' && header[1] == 'D' && header[2] == 'S' && header[3] == ' ' )
+    {
+        heightOut = readLE <rw::uint32> ( header + 12 );
+        widthOut = readLE <rw::uint32> ( header + 16 );
+        mipmapCountOut = std::max( readLE <rw::uint32> ( header + 28 ), 1u );
+        return true;
+    }
+
+    if ( header[0] == 'B' && header[1] == 'M' )
+    {
+        rw::int32 height = (rw::int32)readLE <rw::uint32> ( header + 22 );
+
+        // Top-down bitmaps have a negative height.
+        widthOut = readLE <rw::uint32> ( header + 18 );
+        heightOut = (rw::uint32)( height < 0 ? -height : height );
+        return true;
+    }
+
+    if ( header[0] == 0xFF && header[1] == 0xD8 )
+    {
+        stream->SeekNative( -(fsOffsetNumber_t)sizeof( header ), SEEK_CUR );
+
+        return readJPEGDimensions( stream, widthOut, heightOut );
+    }
+
+    // TGA has no signature.
+    if ( extention.equals( "TGA", false ) )
+    {
+        widthOut = readLE <rw::uint16> ( header + 12 );
+        heightOut = readLE <rw::uint16> ( header + 14 );
+        return true;
+    }
+
+    return false;
+}
+
+rw::uint64 EstimateImageDecodedSize( CFile *stream, const filePath& extention )
+{
+    fsOffsetNumber_t startPos = stream->TellNative();
+
+    txdTextureHeaderInfo info;
+
+    bool hasDimensions = readImageDimensions( stream, extention, info.width, info.height, info.mipmapCount );
+
+    stream->SeekNative( startPos, SEEK_SET );
+
+    // Broken headers do not get to block the budget.
+    if ( !hasDimensions || info.width == 0 || info.height == 0 || info.width > 0x8000 || info.height > 0x8000 )
+    {
+        // Maybe compressed; assume about four bytes per byte of the file.
+        return (rw::uint64)( stream->GetSizeNative() - startPos ) * 4;
+    }
+
+    info.hasDimensions = true;
+
+    return info.GetDecodedSize();
+}
+
+rw::uint64 toolFileEstimate::GetWorkUnits( void ) const
+{
+    // Pixels have to be decoded and encoded, bytes only have to be copied.
+    rw::uint64 workUnits = ( this->fileSize / 16 );
+
+    for ( const txdTextureHeaderInfo& info : this->textures )
+    {
+        workUnits += info.GetPixelCount();
+    }
+
+    return workUnits;
+}
+
+static void estimateTXDStream( CFile *stream, toolFileEstimate& estimateOut )
+{
+    size_t prevTextureCount = estimateOut.textures.size();
+
+    if ( ReadTXDTextureHeaders( stream, estimateOut.textures ) )
+    {
+        estimateOut.txdCount++;
+    }
+    else
+    {
+        // Maybe compressed; we cannot look inside, so assume a single texture of this size.
+        estimateOut.textures.resize( prevTextureCount );
+
+        txdTextureHeaderInfo info;
+        info.dataSize = stream->GetSizeNative();
+
+        estimateOut.textures.push_back( info );
+        estimateOut.txdCount++;
+    }
+}
+
+void EstimateGameFile( CFileTranslator *root, const filePath& path, bool useCompressedIMG, toolFileEstimate& estimateOut )
+{
+    estimateOut.fileSize = (rw::uint64)root->Size( path );
+
+    filePath extention;
+
+    FileSystem::GetFileNameItem <FileSysCommonAllocator> ( path, false, nullptr, &extention );
+
+    if ( extention.equals( "TXD", false ) )
+    {
+        CFile *stream = root->Open( path, L"rb" );
+
+        if ( stream )
+        {
+            try
+            {
+                estimateTXDStream( stream, estimateOut );
+            }
+            catch( ... )
+            {
+                delete stream;
+
+                throw;
+            }
+
+            delete stream;
+        }
+    }
+    else if ( extention.equals( "IMG", false ) )
+    {
+        CIMGArchiveTranslatorHandle *imgRoot = nullptr;
+
+        if ( useCompressedIMG )
+        {
+            imgRoot = fileSystem->OpenCompressedIMGArchive( root, path, false );
+        }
+        else
+        {
+            imgRoot = fileSystem->OpenIMGArchive( root, path, false );
+        }
+
+        if ( imgRoot )
+        {
+            estimateOut.isIMG = true;
+
+            try
+            {
+                auto per_entry_cb = [&]( const filePath& entryPath )
+                {
+                    filePath entryExt;
+
+                    FileSystem::GetFileNameItem <FileSysCommonAllocator> ( entryPath, false, nullptr, &entryExt );
+
+                    if ( entryExt.equals( "TXD", false ) == false )
+                        return;
+
+                    CFile *entryStream = imgRoot->Open( entryPath, L"rb" );
+
+                    if ( entryStream )
+                    {
+                        try
+                        {
+                            estimateTXDStream( entryStream, estimateOut );
+                        }
+                        catch( ... )
+                        {
+                            delete entryStream;
+
+                            throw;
+                        }
+
+                        delete entryStream;
+                    }
+                };
+
+                imgRoot->ScanDirectory( "//", "*", true, nullptr, std::move( per_entry_cb ), nullptr );
+            }
+            catch( ... )
+            {
+                delete imgRoot;
+
+                throw;
+            }
+
+            delete imgRoot;
+        }
+    }
+}
@@ -0,0 +1,64 @@
+// Cheap estimation of the work that a mass tool has with the files of a game root.
+// Only the headers of TXDs are read; no pixels are decoded.
+// Used to process the biggest files first and for dry runs.
+
+#pragma once
+
+#include <vector>
+
+// Native texture platform ids, as stored at the start of a texture native.
+static const rw::uint32 rwplatformXBOX = 5;
+static const rw::uint32 rwplatformD3D8 = 8;
+static const rw::uint32 rwplatformD3D9 = 9;
+static const rw::uint32 rwplatformPS2 = 0x00325350;     // "PS2"
+
+struct txdTextureHeaderInfo
+{
+    rw::uint32 platformId = 0;
+    rw::uint32 width = 0;
+    rw::uint32 height = 0;
+    rw::uint32 mipmapCount = 0;
+    rw::eRasterStageFilterMode filterMode = rw::RWFILTER_POINT;
+    bool hasDimensions = false;     // false if we did not understand the native texture
+    bool isCompressed = false;
+    bool hasAlpha = false;
+    rw::uint64 dataSize = 0;        // size of the texture native chunk
+
+    // Pixels of all mipmap levels; estimated from the data size if the dimensions are unknown.
+    rw::uint64 GetPixelCount( void ) const;
+
+    // Memory of all mipmap levels decoded to RGBA.
+    inline rw::uint64 GetDecodedSize( void ) const
+    {
+        return this->GetPixelCount() * 4;
+    }
+};
+
+// Reads the texture headers of a TXD stream, starting from the current position.
+// Returns false if the stream is not a TXD.
+bool ReadTXDTextureHeaders( CFile *stream, std::vector <txdTextureHeaderInfo>& texturesOut );
+
+// Decoded size of all textures of a TXD stream, for reservations in the memory budget.
+// The stream position is kept; unknown streams are estimated by their size.
+rw::uint64 EstimateTXDDecodedSize( CFile *stream );
+
+// Decoded size of an image file that a mass tool turns into a texture.
+// Only the header is read and the stream position is kept; unknown formats are estimated by their size.
+rw::uint64 EstimateImageDecodedSize( CFile *stream, const filePath& extention );
+
+struct toolFileEstimate
+{
+    rw::uint64 fileSize = 0;
+    bool isIMG = false;
+    rw::uint32 txdCount = 0;
+
+    // Textures of the TXD or of all TXDs inside of an IMG archive.
+    std::vector <txdTextureHeaderInfo> textures;
+
+    // Relative amount of work, only meaningful in comparison to other files.
+    rw::uint64 GetWorkUnits( void ) const;
+};
+
+// Looks at a file of the game root.
+// IMG archives are opened so that their TXDs count, too.
+void EstimateGameFile( CFileTranslator *root, const filePath& path, bool useCompressedIMG, toolFileEstimate& estimateOut );
@@ -1,4 +1,10 @@
 #include "shared.h"
+#include "buildmanifest.h"
+#include "tooltrace.h"
+#include "costestimate.h"
+#include "scanindex.h"
+
+#include <algorithm>
 
 template <typename sentryType>
 struct gtaFileProcessor
@@ -9,6 +15,9 @@ struct gtaFileProcessor
     {
         this->reconstruct_archives = true;
         this->use_compressed_img_archives = true;
+        this->largest_first = false;
+        this->manifest = nullptr;
+        this->scan_index = nullptr;
         this->module = module;
     }
 
@@ -27,8 +36,77 @@ struct gtaFileProcessor
         traverse.sentry = theSentry;
         traverse.reconstruct_archives = this->reconstruct_archives;
         traverse.use_compressed_img_archives = this->use_compressed_img_archives;
+        traverse.manifest = this->manifest;
+
+        if ( ToolScanIndex *scanIndex = this->scan_index )
+        {
+            // Unchanged directories are taken from the index of the previous run.
+            std::vector <ToolScanIndex::indexedFile> files;
+            {
+                TOOL_TRACE_SCOPE( "EnumerateScanIndex" );
+
+                scanIndex->Enumerate( theSentry->module->GetEngine(), discHandle, this->use_compressed_img_archives, this->largest_first, files );
+            }
+
+            if ( this->largest_first )
+            {
+                std::stable_sort( files.begin(), files.end(),
+                    []( const ToolScanIndex::indexedFile& left, const ToolScanIndex::indexedFile& right )
+                    {
+                        return ( left.workUnits > right.workUnits );
+                    }
+                );
+            }
+
+            for ( const ToolScanIndex::indexedFile& file : files )
+            {
+                _discFileCallback( file.pathAbs, &traverse );
+            }
+        }
+        else if ( this->largest_first )
+        {
+            // Look at all files first, so that the most expensive ones can be started first.
+            // Otherwise a big file that comes last keeps one thread busy while the others are idle.
+            std::vector <scheduledFile> files;
+            {
+                TOOL_TRACE_SCOPE( "EstimateFiles" );
+
+                auto per_file_cb = [&]( const filePath& discFilePathAbs )
+                {
+                    toolFileEstimate estimate;
+
+                    EstimateGameFile( discHandle, discFilePathAbs, this->use_compressed_img_archives, estimate );
 
-        discHandle->ScanDirectory( "//", "*", true, nullptr, _discFileCallback, &traverse );
+                    scheduledFile file;
+                    file.discFilePathAbs = discFilePathAbs;
+                    file.workUnits = estimate.GetWorkUnits();
+
+                    files.push_back( std::move( file ) );
+
+                    // Allow termination during the estimation.
+                    rw::CheckThreadHazards( theSentry->module->GetEngine() );
+                };
+
+                discHandle->ScanDirectory( "//", "*", true, nullptr, std::move( per_file_cb ), nullptr );
+            }
+
+            // Files of the same cost stay in scanning order.
+            std::stable_sort( files.begin(), files.end(),
+                []( const scheduledFile& left, const scheduledFile& right )
+                {
+                    return ( left.workUnits > right.workUnits );
+                }
+            );
+
+            for ( const scheduledFile& file : files )
+            {
+                _discFileCallback( file.discFilePathAbs, &traverse );
+            }
+        }
+        else
+        {
+            discHandle->ScanDirectory( "//", "*", true, nullptr, _discFileCallback, &traverse );
+        }
     }
 
     inline void setArchiveReconstruction( bool doReconstruct )
@@ -41,15 +119,44 @@ struct gtaFileProcessor
         this->use_compressed_img_archives = doUse;
     }
 
+    // Process the files of the game root in the order of their estimated cost, biggest first.
+    inline void setLargestFirst( bool largestFirst )
+    {
+        this->largest_first = largestFirst;
+    }
+
+    // Files of the game root that have not changed since the last run are skipped
+    // if their output still exists.
+    inline void setManifest( BuildManifest *manifest )
+    {
+        this->manifest = manifest;
+    }
+
+    // Lists the game root through a persistent index instead of scanning all of it.
+    inline void setScanIndex( ToolScanIndex *scanIndex )
+    {
+        this->scan_index = scanIndex;
+    }
+
 private:
     bool reconstruct_archives;
     bool use_compressed_img_archives;
+    bool largest_first;
+    BuildManifest *manifest;
+    ToolScanIndex *scan_index;
+
+    struct scheduledFile
+    {
+        filePath discFilePathAbs;
+        rw::uint64 workUnits;
+    };
 
     struct _discFileTraverse
     {
         inline _discFileTraverse( void )
         {
             this->anyWork = false;
+            this->manifest = nullptr;
         }
 
         MessageReceiver *module;
@@ -63,6 +170,8 @@ private:
         bool reconstruct_archives;
         bool use_compressed_img_archives;
 
+        BuildManifest *manifest;
+
         sentryType *sentry;
     };
 
@@ -103,6 +212,39 @@ private:
 
         if ( hasTargetRelativePath )
         {
+            TOOL_TRACE_SCOPE( "ProcessFile", relPathFromRoot );
+
+            // Only files directly inside of the game root are listed in the manifest.
+            BuildManifest *manifest = nullptr;
+
+            if ( info->manifest != nullptr && fileSystem->GetArchiveTranslator( info->discHandle ) == nullptr )
+            {
+                manifest = info->manifest;
+            }
+
+            BuildManifestEntry manifestEntry;
+
+            if ( manifest )
+            {
+                manifestEntry.manifest = manifest;
+                manifestEntry.sourceRoot = info->discHandle;
+                manifestEntry.sourcePath = discFilePathAbs;
+                manifestEntry.relPath = relPathFromRoot;
+
+                if ( buildRoot->Exists( relPathFromRoot ) )
+                {
+                    manifestEntry.hasContentHash = BuildManifest::HashFile( info->discHandle, discFilePathAbs, manifestEntry.contentHash );
+
+                    if ( manifestEntry.hasContentHash && manifest->IsUnchanged( relPathFromRoot, manifestEntry.contentHash ) )
+                    {
+                        module->OnMessage( L"skipping " + relPathFromRoot.convert_unicode <FileSysCommonAllocator> () + L" (unchanged)\n" );
+
+                        manifestEntry.Record();
+                        return;
+                    }
+                }
+            }
+
             bool hasPreprocessedFile = false;
 
             filePath extention;
@@ -200,8 +342,15 @@ private:
                                     traverse.reconstruct_archives = info->reconstruct_archives;
                                     traverse.use_compressed_img_archives = info->use_compressed_img_archives;
 
+                                    // Members of archives are not listed in the manifest.
+                                    traverse.manifest = nullptr;
+
                                     srcIMGRoot->ScanDirectory( "//", "*", true, nullptr, _discFileCallback, &traverse );
 
+                                    // The sentry may still process members in the background.
+                                    // They have to be in the output before it is saved or closed.
+                                    info->sentry->OnArchiveContentsDone();
+
                                     if ( outputRoot_archive != nullptr )
                                     {
                                         module->OnMessage( "writing " );
@@ -213,7 +362,11 @@ private:
 
                                         module->OnMessage( "... " );
 
-                                        outputRoot_archive->Save();
+                                        {
+                                            TOOL_TRACE_SCOPE( "IMG Save", relPathFromRoot );
+
+                                            outputRoot_archive->Save();
+                                        }
 
                                         module->OnMessage( "done.\n\n" );
 
@@ -269,10 +422,16 @@ private:
                     sourceStream = info->discHandle->Open( discFilePathAbs, L"rb" );
                 }
 
-                if ( sourceStream )
+                // Files that the sentry only copies are passed on as they are, so that
+                // members of archives keep their compression and nothing is decompressed for nothing.
+                bool needsContents = info->sentry->NeedsFileContents( extention );
+
+                if ( sourceStream && needsContents )
                 {
                     try
                     {
+                        TOOL_TRACE_SCOPE( "WrapStreamCodec" );
+
                         sourceStream = module->WrapStreamCodec( sourceStream );
                     }
                     catch( ... )
@@ -288,7 +447,9 @@ private:
                     try
                     {
                         // Execute the sentry.
-                        bool hasDoneAnyWork = info->sentry->OnSingletonFile( info->discHandle, buildRoot, relPathFromRoot, fileName, extention, sourceStream, info->isInArchive );
+                        // The sentry may take over the source stream, in which case it is reset to nullptr.
+                        // It records the manifest entry once the output is complete.
+                        bool hasDoneAnyWork = info->sentry->OnSingletonFile( info->discHandle, buildRoot, relPathFromRoot, fileName, extention, sourceStream, info->isInArchive, ( manifest ? &manifestEntry : nullptr ) );
 
                         if ( hasDoneAnyWork )
                         {
@@ -297,14 +458,26 @@ private:
                     }
                     catch( ... )
                     {
-                        delete sourceStream;
+                        if ( sourceStream )
+                        {
+                            delete sourceStream;
+                        }
 
                         throw;
                     }
 
-                    delete sourceStream;
+                    if ( sourceStream )
+                    {
+                        delete sourceStream;
+                    }
                 }
             }
+
+            // Archives are complete once they are saved.
+            if ( hasPreprocessedFile && manifest && buildRoot->Exists( relPathFromRoot ) )
+            {
+                manifestEntry.Record();
+            }
         }
 
         if ( anyWork )
@@ -0,0 +1,193 @@
+#include "mainwindow.h"
+
+#include "memorybudget.h"
+#include "tooltrace.h"
+#include "shared.h"
+
+#include <sdk/PluginHelpers.h>
+
+#include <algorithm>
+
+// The budget is shared by all tool runs of the editor, so its lock lives with the main window.
+static NativeExecutive::CReadWriteLock *budgetLock = nullptr;
+static NativeExecutive::CCondVar *budgetReleased = nullptr;
+
+static rw::uint64 budgetLimit = 0;
+static rw::uint64 budgetUsage = 0;
+static rw::uint64 budgetPeakUsage = 0;
+static unsigned int budgetSessionCount = 0;
+
+struct toolMemoryBudgetEnv
+{
+    inline void Initialize( MainWindow *mainWnd )
+    {
+        NativeExecutive::CExecutiveManager *nativeExec = (NativeExecutive::CExecutiveManager*)rw::GetThreadingNativeManager( mainWnd->GetEngine() );
+
+        budgetLock = nativeExec->CreateReadWriteLock();
+        budgetReleased = nativeExec->CreateConditionVariable();
+    }
+
+    inline void Shutdown( MainWindow *mainWnd )
+    {
+        NativeExecutive::CExecutiveManager *nativeExec = (NativeExecutive::CExecutiveManager*)rw::GetThreadingNativeManager( mainWnd->GetEngine() );
+
+        nativeExec->CloseConditionVariable( budgetReleased );
+        nativeExec->CloseReadWriteLock( budgetLock );
+
+        budgetReleased = nullptr;
+        budgetLock = nullptr;
+    }
+};
+
+static PluginDependantStructRegister <toolMemoryBudgetEnv, mainWindowFactory_t> toolMemoryBudgetEnvRegister;
+
+void ToolMemoryBudget::BeginSession( rw::uint64 limitBytes )
+{
+    NativeExecutive::CReadWriteWriteContext <> ctxBudget( budgetLock );
+
+    // Another tool may hold reservations under the current limit.
+    if ( budgetSessionCount == 0 )
+    {
+        budgetLimit = limitBytes;
+        budgetPeakUsage = budgetUsage;
+    }
+
+    budgetSessionCount++;
+}
+
+void ToolMemoryBudget::EndSession( void )
+{
+    NativeExecutive::CReadWriteWriteContext <> ctxBudget( budgetLock );
+
+    if ( budgetSessionCount > 0 )
+    {
+        budgetSessionCount--;
+    }
+}
+
+rw::uint64 ToolMemoryBudget::GetLimit( void )
+{
+    NativeExecutive::CReadWriteWriteContext <> ctxBudget( budgetLock );
+
+    return budgetLimit;
+}
+
+static inline void addUsage( rw::uint64 bytes )
+{
+    budgetUsage += bytes;
+
+    if ( budgetUsage > budgetPeakUsage )
+    {
+        budgetPeakUsage = budgetUsage;
+    }
+}
+
+void ToolMemoryBudget::Reserve( rw::uint64 bytes )
+{
+    NativeExecutive::CReadWriteWriteContextSafe <> ctxBudget( budgetLock );
+
+    // Terminating the thread interrupts the wait, so the tools stay cancellable.
+    while ( budgetLimit != 0 && budgetUsage != 0 && budgetUsage + bytes > budgetLimit )
+    {
+        budgetReleased->Wait( ctxBudget );
+    }
+
+    addUsage( bytes );
+}
+
+void ToolMemoryBudget::Grow( rw::uint64 bytes )
+{
+    NativeExecutive::CReadWriteWriteContext <> ctxBudget( budgetLock );
+
+    addUsage( bytes );
+}
+
+void ToolMemoryBudget::Release( rw::uint64 bytes )
+{
+    if ( bytes == 0 )
+        return;
+
+    NativeExecutive::CReadWriteWriteContext <> ctxBudget( budgetLock );
+
+    budgetUsage -= std::min( bytes, budgetUsage );
+
+    // Signal wakes every waiting thread, so that all reservations that fit now can go on.
+    budgetReleased->Signal();
+}
+
+rw::uint64 ToolMemoryBudget::GetUsage( void )
+{
+    NativeExecutive::CReadWriteWriteContext <> ctxBudget( budgetLock );
+
+    return budgetUsage;
+}
+
+rw::uint64 ToolMemoryBudget::GetPeakUsage( void )
+{
+    NativeExecutive::CReadWriteWriteContext <> ctxBudget( budgetLock );
+
+    return budgetPeakUsage;
+}
+
+ToolRunSession::ToolRunSession( MessageReceiver *module, rw::uint32 memoryBudget, bool traceRequested, CFileTranslator *traceRoot, const filePath& traceFileName )
+    : traceFileName( traceFileName )
+{
+    this->module = module;
+    this->traceRoot = traceRoot;
+    this->isTracing = false;
+    this->hasEnded = false;
+
+    if ( traceRequested || ToolTrace::IsRequestedByEnvironment() )
+    {
+        this->isTracing = ToolTrace::BeginRecording();
+    }
+
+    ToolMemoryBudget::BeginSession( (rw::uint64)memoryBudget * 1024 * 1024 );
+}
+
+ToolRunSession::~ToolRunSession( void )
+{
+    if ( !this->hasEnded )
+    {
+        // The run was aborted; the trace is still written, since it shows where.
+        this->Finish( false );
+    }
+}
+
+void ToolRunSession::End( void )
+{
+    if ( !this->hasEnded )
+    {
+        this->Finish( true );
+    }
+}
+
+void ToolRunSession::Finish( bool isComplete )
+{
+    this->hasEnded = true;
+
+    if ( isComplete )
+    {
+        this->module->OnMessage(
+            "peak decoded texture memory: " + eir::to_string <char, rw::RwStaticMemAllocator> ( ToolMemoryBudget::GetPeakUsage() / ( 1024 * 1024 ) ) + "MB\n"
+        );
+    }
+
+    ToolMemoryBudget::EndSession();
+
+    if ( this->isTracing )
+    {
+        bool couldWrite = ToolTrace::EndRecording( this->traceRoot, this->traceFileName );
+
+        // Messages are not safe while an exception is on its way.
+        if ( !couldWrite && isComplete )
+        {
+            this->module->OnMessage( "failed to write the trace\n" );
+        }
+    }
+}
+
+void InitializeToolMemoryBudgetEnv( void )
+{
+    toolMemoryBudgetEnvRegister.RegisterPlugin( mainWindowFactory );
+}
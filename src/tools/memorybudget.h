@@ -0,0 +1,59 @@
+// Process-wide budget for the decoded pixel data of the mass tools.
+// Before a tool decodes a TXD it reserves the estimated amount of memory; if the budget
+// is exhausted, the thread waits until other conversions have released theirs.
+// The peak usage is kept, so that tools can report it at the end of a run.
+// Tools that run at the same time share the budget.
+
+#pragma once
+
+namespace ToolMemoryBudget
+{
+    // Every run of a tool is a session. The limit and the peak usage are only set by the
+    // first session; later ones that overlap with it use the limit that is in place.
+    // Zero means no limit.
+    void BeginSession( rw::uint64 limitBytes );
+    void EndSession( void );
+
+    rw::uint64 GetLimit( void );
+
+    // Blocks while the amount does not fit into the budget.
+    // A reservation bigger than the whole budget is granted once nothing else is reserved.
+    // The wait can be interrupted by terminating the thread.
+    void Reserve( rw::uint64 bytes );
+
+    // Adds to a reservation that the caller holds already, without waiting.
+    // Waiting would deadlock if the caller itself holds the budget.
+    void Grow( rw::uint64 bytes );
+
+    void Release( rw::uint64 bytes );
+
+    rw::uint64 GetUsage( void );
+
+    // Peak usage since the first of the current sessions began.
+    rw::uint64 GetPeakUsage( void );
+};
+
+struct MessageReceiver;
+
+// A run of a mass tool: a budget session plus a trace recording if one is wanted.
+// Both are ended when the run goes out of scope, also if it is left by an exception.
+struct ToolRunSession
+{
+    // The budget is in megabytes. The trace is wanted if traceRequested is set or if the
+    // environment asks for it, and is written into traceRoot.
+    ToolRunSession( MessageReceiver *module, rw::uint32 memoryBudget, bool traceRequested, CFileTranslator *traceRoot, const filePath& traceFileName );
+    ~ToolRunSession( void );
+
+    // Called after a complete run; reports the peak memory usage and writes the trace.
+    void End( void );
+
+private:
+    void Finish( bool isComplete );
+
+    MessageReceiver *module;
+    CFileTranslator *traceRoot;
+    filePath traceFileName;
+
+    bool isTracing;
+    bool hasEnded;
+};
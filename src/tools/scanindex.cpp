@@ -0,0 +1,339 @@
+#include "mainwindow.h"
+
+#include "scanindex.h"
+#include "costestimate.h"
+
+#include <algorithm>
+
+static const char *const scanIndexHeaderTag = "MTXD-SCANINDEX 2";
+
+static std::string getPathKey( const filePath& relPath )
+{
+    auto widePath = relPath.convert_unicode <FileSysCommonAllocator> ();
+
+    auto utf8Path = CharacterUtil::ConvertStrings <wchar_t, char8_t, FileSysCommonAllocator> ( widePath.GetConstString() );
+
+    return std::string( (const char*)utf8Path.GetConstString(), utf8Path.GetLength() );
+}
+
+static filePath getPathFromKey( const std::string& key )
+{
+    auto widePath = CharacterUtil::ConvertStrings <char8_t, wchar_t, FileSysCommonAllocator> ( (const char8_t*)key.c_str() );
+
+    return filePath( widePath.GetConstString() );
+}
+
+// Returns the remainder of a line after the given amount of space-separated numbers.
+static bool parseNumbers( const char *line, size_t lineLen, rw::uint64 *numbersOut, size_t numberCount, std::string& restOut )
+{
+    size_t pos = 0;
+
+    for ( size_t n = 0; n < numberCount; n++ )
+    {
+        if ( pos >= lineLen || line[ pos ] < '0' || line[ pos ] > '9' )
+            return false;
+
+        rw::uint64 value = 0;
+
+        while ( pos < lineLen && line[ pos ] >= '0' && line[ pos ] <= '9' )
+        {
+            value = ( value * 10 ) + ( line[ pos ] - '0' );
+
+            pos++;
+        }
+
+        numbersOut[ n ] = value;
+
+        if ( pos >= lineLen || line[ pos ] != ' ' )
+            return false;
+
+        pos++;
+    }
+
+    restOut.assign( line + pos, lineLen - pos );
+
+    return true;
+}
+
+void ToolScanIndex::Load( CFileTranslator *root, const filePath& path )
+{
+    this->previousDirs.clear();
+
+    CFile *indexStream = root->Open( path, L"rb" );
+
+    if ( indexStream == nullptr )
+        return;
+
+    std::string content;
+
+    try
+    {
+        size_t fileSize = indexStream->GetSize();
+
+        content.resize( fileSize );
+
+        size_t readCount = indexStream->Read( &content[ 0 ], fileSize );
+
+        content.resize( readCount );
+    }
+    catch( ... )
+    {
+        delete indexStream;
+
+        throw;
+    }
+
+    delete indexStream;
+
+    // Each line starts with a letter for its kind:
+    // "D <mtime> <dir>", followed by its "S <subdir>" and "F <estimated> <work> <file>" lines.
+    std::map <std::string, dirInfo> loadedDirs;
+
+    dirInfo *curDir = nullptr;
+
+    size_t lineStart = 0;
+    bool isHeaderLine = true;
+
+    while ( lineStart < content.size() )
+    {
+        size_t lineEnd = content.find( '\n', lineStart );
+
+        if ( lineEnd == std::string::npos )
+        {
+            lineEnd = content.size();
+        }
+
+        const char *line = content.c_str() + lineStart;
+        size_t lineLen = ( lineEnd - lineStart );
+
+        lineStart = ( lineEnd + 1 );
+
+        if ( lineLen > 0 && line[ lineLen - 1 ] == '\r' )
+        {
+            lineLen--;
+        }
+
+        if ( isHeaderLine )
+        {
+            if ( std::string( line, lineLen ) != scanIndexHeaderTag )
+                return;
+
+            isHeaderLine = false;
+            continue;
+        }
+
+        if ( lineLen < 2 || line[ 1 ] != ' ' )
+            return;
+
+        char kind = line[ 0 ];
+
+        line += 2;
+        lineLen -= 2;
+
+        std::string rest;
+
+        if ( kind == 'D' )
+        {
+            rw::uint64 mtime;
+
+            if ( !parseNumbers( line, lineLen, &mtime, 1, rest ) )
+                return;
+
+            curDir = &loadedDirs[ rest ];
+            curDir->mtime = mtime;
+        }
+        else if ( kind == 'S' )
+        {
+            if ( curDir == nullptr )
+                return;
+
+            curDir->subDirs.push_back( std::string( line, lineLen ) );
+        }
+        else if ( kind == 'F' )
+        {
+            rw::uint64 numbers[ 2 ];
+
+            if ( curDir == nullptr || !parseNumbers( line, lineLen, numbers, 2, rest ) )
+                return;
+
+            fileInfo info;
+            info.relPath = std::move( rest );
+            info.hasEstimate = ( numbers[ 0 ] != 0 );
+            info.workUnits = numbers[ 1 ];
+
+            curDir->files.push_back( std::move( info ) );
+        }
+        else
+        {
+            return;
+        }
+    }
+
+    // Only take over complete indices.
+    this->previousDirs = std::move( loadedDirs );
+}
+
+bool ToolScanIndex::Save( CFileTranslator *root, const filePath& path ) const
+{
+    CFile *indexStream = root->Open( path, L"wb" );
+
+    if ( indexStream == nullptr )
+        return false;
+
+    try
+    {
+        std::string content = scanIndexHeaderTag;
+        content += '\n';
+
+        for ( const auto& dirPair : this->currentDirs )
+        {
+            const dirInfo& dir = dirPair.second;
+
+            content += "D " + std::to_string( dir.mtime ) + ' ' + dirPair.first + '\n';
+
+            for ( const std::string& subDir : dir.subDirs )
+            {
+                content += "S " + subDir + '\n';
+            }
+
+            for ( const fileInfo& info : dir.files )
+            {
+                content +=
+                    "F " + std::string( info.hasEstimate ? "1" : "0" ) + ' ' +
+                    std::to_string( info.workUnits ) + ' ' + info.relPath + '\n';
+            }
+        }
+
+        indexStream->Write( content.c_str(), content.size() );
+    }
+    catch( ... )
+    {
+        delete indexStream;
+
+        throw;
+    }
+
+    delete indexStream;
+
+    return true;
+}
+
+void ToolScanIndex::Enumerate( rw::Interface *rwEngine, CFileTranslator *discHandle, bool useCompressedIMG, bool estimateFiles, std::vector <indexedFile>& filesOut )
+{
+    this->currentDirs.clear();
+    this->numReusedDirs = 0;
+    this->numScannedDirs = 0;
+
+    filePath rootPathAbs;
+
+    discHandle->GetFullPathFromRoot( L"", false, rootPathAbs );
+
+    this->EnumerateDirectory( rwEngine, discHandle, useCompressedIMG, estimateFiles, std::string(), rootPathAbs, filesOut );
+}
+
+void ToolScanIndex::EnumerateDirectory(
+    rw::Interface *rwEngine, CFileTranslator *discHandle, bool useCompressedIMG, bool estimateFiles,
+    const std::string& dirKey, const filePath& dirPathAbs, std::vector <indexedFile>& filesOut
+)
+{
+    // Allow termination during the scan.
+    rw::CheckThreadHazards( rwEngine );
+
+    filesysStats dirStats;
+
+    bool hasDirTime = discHandle->QueryStats( dirPathAbs, dirStats );
+
+    rw::uint64 dirTime = ( hasDirTime ? (rw::uint64)dirStats.mtime : 0 );
+
+    dirInfo dir;
+
+    auto prevIter = this->previousDirs.find( dirKey );
+
+    if ( hasDirTime && prevIter != this->previousDirs.end() && prevIter->second.mtime == dirTime )
+    {
+        // Nothing was added, removed or renamed in here.
+        dir = prevIter->second;
+
+        this->numReusedDirs++;
+    }
+    else
+    {
+        dir.mtime = dirTime;
+
+        auto per_dir_cb = [&]( const filePath& subDirPathAbs )
+        {
+            filePath relPath;
+
+            if ( discHandle->GetRelativePathFromRoot( subDirPathAbs, false, relPath ) )
+            {
+                dir.subDirs.push_back( getPathKey( relPath ) );
+            }
+        };
+
+        auto per_file_cb = [&]( const filePath& filePathAbs )
+        {
+            filePath relPath;
+
+            if ( discHandle->GetRelativePathFromRoot( filePathAbs, true, relPath ) )
+            {
+                fileInfo info;
+                info.relPath = getPathKey( relPath );
+
+                dir.files.push_back( std::move( info ) );
+            }
+        };
+
+        discHandle->ScanDirectory( dirPathAbs, "*", false, std::move( per_dir_cb ), std::move( per_file_cb ), nullptr );
+
+        // The order of a directory listing is up to the system; make it the same on every run.
+        std::sort( dir.subDirs.begin(), dir.subDirs.end() );
+        std::sort( dir.files.begin(), dir.files.end(),
+            []( const fileInfo& left, const fileInfo& right )
+            {
+                return ( left.relPath < right.relPath );
+            }
+        );
+
+        this->numScannedDirs++;
+    }
+
+    for ( fileInfo& info : dir.files )
+    {
+        indexedFile file;
+
+        if ( discHandle->GetFullPathFromRoot( getPathFromKey( info.relPath ), true, file.pathAbs ) )
+        {
+            // Files are only looked into if they are scheduled by their cost.
+            // The estimate is kept for the next runs, even by runs that do not need it.
+            if ( estimateFiles && !info.hasEstimate )
+            {
+                toolFileEstimate estimate;
+
+                EstimateGameFile( discHandle, file.pathAbs, useCompressedIMG, estimate );
+
+                info.hasEstimate = true;
+                info.workUnits = estimate.GetWorkUnits();
+
+                rw::CheckThreadHazards( rwEngine );
+            }
+
+            file.workUnits = info.workUnits;
+
+            filesOut.push_back( std::move( file ) );
+        }
+    }
+
+    std::vector <std::string> subDirs = dir.subDirs;
+
+    this->currentDirs[ dirKey ] = std::move( dir );
+
+    for ( const std::string& subDirKey : subDirs )
+    {
+        filePath subDirPathAbs;
+
+        if ( discHandle->GetFullPathFromRoot( getPathFromKey( subDirKey ), false, subDirPathAbs ) )
+        {
+            this->EnumerateDirectory( rwEngine, discHandle, useCompressedIMG, estimateFiles, subDirKey, subDirPathAbs, filesOut );
+        }
+    }
+}
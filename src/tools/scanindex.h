@@ -0,0 +1,71 @@
+// Persistent index of the files of a game root, so that big roots do not have to be
+// listed and estimated again on every run.
+// A directory is only listed again if its modification time has changed; the file list of
+// unchanged directories is taken from the index.
+// The index only replaces the listing and the cost estimation. The tools still open every
+// file to process it, so a file that was modified in place is handled correctly.
+// The cost of a file is only used for scheduling, so it does not matter if it is out of
+// date. It is only estimated if it is asked for.
+// Used by the tools that go through gtaFileProcessor (txdgen and txdexport). txdbuild lists
+// the directories of its TXDs itself and does not use it.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+struct ToolScanIndex
+{
+    struct fileInfo
+    {
+        std::string relPath;        // relative to the root, UTF-8
+        bool hasEstimate = false;
+        rw::uint64 workUnits = 0;   // see toolFileEstimate
+    };
+
+    struct indexedFile
+    {
+        filePath pathAbs;
+        rw::uint64 workUnits;
+    };
+
+    // Reads the index of the previous run; a broken or missing index is ignored.
+    void Load( CFileTranslator *root, const filePath& path );
+    bool Save( CFileTranslator *root, const filePath& path ) const;
+
+    // Lists all files below the root of the translator and updates the index.
+    // The work units of the files are only filled in if estimateFiles is set.
+    void Enumerate( rw::Interface *rwEngine, CFileTranslator *discHandle, bool useCompressedIMG, bool estimateFiles, std::vector <indexedFile>& filesOut );
+
+    // Statistics of the last enumeration.
+    inline size_t GetReusedDirectoryCount( void ) const
+    {
+        return this->numReusedDirs;
+    }
+
+    inline size_t GetScannedDirectoryCount( void ) const
+    {
+        return this->numScannedDirs;
+    }
+
+private:
+    struct dirInfo
+    {
+        rw::uint64 mtime = 0;
+
+        std::vector <std::string> subDirs;
+        std::vector <fileInfo> files;
+    };
+
+    void EnumerateDirectory(
+        rw::Interface *rwEngine, CFileTranslator *discHandle, bool useCompressedIMG, bool estimateFiles,
+        const std::string& dirKey, const filePath& dirPathAbs, std::vector <indexedFile>& filesOut
+    );
+
+    std::map <std::string, dirInfo> previousDirs;
+    std::map <std::string, dirInfo> currentDirs;
+
+    size_t numReusedDirs = 0;
+    size_t numScannedDirs = 0;
+};
@@ -0,0 +1,290 @@
+#include "mainwindow.h"
+
+#include "tooltrace.h"
+
+#include <sdk/PluginHelpers.h>
+
+#include <chrono>
+#include <vector>
+
+std::atomic <bool> ToolTrace::isRecording( false );
+
+struct traceSpan
+{
+    const char *name;
+    std::string detail;
+    rw::uint64 startTime;
+    rw::uint64 endTime;
+};
+
+// Buffers are never freed; once their thread has quit they are handed to new threads.
+struct threadTraceBuffer
+{
+    unsigned int threadIndex;
+    bool isInUse;
+
+    NativeExecutive::CReadWriteLock *lock;
+    std::vector <traceSpan> spans;
+};
+
+// Set up by the main window, since spans can come from any thread of the editor.
+static NativeExecutive::CExecutiveManager *traceNativeExec = nullptr;
+static NativeExecutive::CReadWriteLock *traceBuffersLock = nullptr;
+static std::vector <threadTraceBuffer*> traceBuffers;
+static bool hasActiveRecording = false;
+static rw::uint64 recordingStartTime = 0;
+
+struct threadTraceBufferRef
+{
+    inline threadTraceBufferRef( void )
+    {
+        this->buffer = nullptr;
+    }
+
+    inline ~threadTraceBufferRef( void )
+    {
+        // After shutdown the buffer is gone already.
+        if ( traceBuffersLock == nullptr )
+            return;
+
+        if ( threadTraceBuffer *buffer = this->buffer )
+        {
+            NativeExecutive::CReadWriteWriteContext <> ctxBuffers( traceBuffersLock );
+
+            buffer->isInUse = false;
+        }
+    }
+
+    threadTraceBuffer *buffer;
+};
+
+static thread_local threadTraceBufferRef currentThreadBuffer;
+
+static threadTraceBuffer* getThreadTraceBuffer( void )
+{
+    threadTraceBuffer *buffer = currentThreadBuffer.buffer;
+
+    if ( buffer == nullptr )
+    {
+        NativeExecutive::CReadWriteWriteContext <> ctxBuffers( traceBuffersLock );
+
+        for ( threadTraceBuffer *freeBuffer : traceBuffers )
+        {
+            if ( freeBuffer->isInUse == false )
+            {
+                buffer = freeBuffer;
+                break;
+            }
+        }
+
+        if ( buffer == nullptr )
+        {
+            buffer = new threadTraceBuffer();
+            buffer->threadIndex = (unsigned int)traceBuffers.size() + 1;
+            buffer->lock = traceNativeExec->CreateReadWriteLock();
+
+            traceBuffers.push_back( buffer );
+        }
+
+        buffer->isInUse = true;
+
+        currentThreadBuffer.buffer = buffer;
+    }
+
+    return buffer;
+}
+
+rw::uint64 ToolTrace::GetTimestamp( void )
+{
+    using namespace std::chrono;
+
+    return (rw::uint64)duration_cast <microseconds> ( steady_clock::now().time_since_epoch() ).count();
+}
+
+void ToolTrace::AddSpan( const char *name, std::string&& detail, rw::uint64 startTime, rw::uint64 endTime )
+{
+    if ( traceBuffersLock == nullptr )
+        return;
+
+    threadTraceBuffer *buffer = getThreadTraceBuffer();
+
+    traceSpan span;
+    span.name = name;
+    span.detail = std::move( detail );
+    span.startTime = startTime;
+    span.endTime = endTime;
+
+    NativeExecutive::CReadWriteWriteContext <> ctxSpans( buffer->lock );
+
+    buffer->spans.push_back( std::move( span ) );
+}
+
+bool ToolTrace::IsRequestedByEnvironment( void )
+{
+    const char *envValue = getenv( "MAGICTXD_TRACE" );
+
+    return ( envValue != nullptr && *envValue != '\0' && strcmp( envValue, "0" ) != 0 );
+}
+
+bool ToolTrace::BeginRecording( void )
+{
+    NativeExecutive::CReadWriteWriteContext <> ctxBuffers( traceBuffersLock );
+
+    if ( hasActiveRecording )
+        return false;
+
+    for ( threadTraceBuffer *buffer : traceBuffers )
+    {
+        NativeExecutive::CReadWriteWriteContext <> ctxSpans( buffer->lock );
+
+        buffer->spans.clear();
+    }
+
+    hasActiveRecording = true;
+    recordingStartTime = GetTimestamp();
+
+    isRecording.store( true );
+
+    return true;
+}
+
+static void appendJSONString( std::string& out, const char *str )
+{
+    out += '\"';
+
+    while ( char c = *str++ )
+    {
+        if ( c == '\"' || c == '\\' )
+        {
+            out += '\\';
+            out += c;
+        }
+        else if ( (unsigned char)c < 0x20 )
+        {
+            char escaped[ 8 ];
+
+            snprintf( escaped, sizeof( escaped ), "\\u%04x", (unsigned int)c );
+
+            out += escaped;
+        }
+        else
+        {
+            out += c;
+        }
+    }
+
+    out += '\"';
+}
+
+bool ToolTrace::EndRecording( CFileTranslator *root, const filePath& path )
+{
+    isRecording.store( false );
+
+    std::string content = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    {
+        NativeExecutive::CReadWriteWriteContext <> ctxBuffers( traceBuffersLock );
+
+        bool isFirstEvent = true;
+
+        for ( threadTraceBuffer *buffer : traceBuffers )
+        {
+            NativeExecutive::CReadWriteWriteContext <> ctxSpans( buffer->lock );
+
+            for ( const traceSpan& span : buffer->spans )
+            {
+                // Spans that were begun by an earlier recording end up here if they finish late.
+                if ( span.startTime < recordingStartTime )
+                    continue;
+
+                if ( !isFirstEvent )
+                {
+                    content += ",\n";
+                }
+
+                isFirstEvent = false;
+
+                content += "{\"name\":";
+                appendJSONString( content, span.name );
+                content += ",\"cat\":\"magictxd\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+                content += std::to_string( buffer->threadIndex );
+                content += ",\"ts\":";
+                content += std::to_string( span.startTime - recordingStartTime );
+                content += ",\"dur\":";
+                content += std::to_string( span.endTime - span.startTime );
+
+                if ( span.detail.empty() == false )
+                {
+                    content += ",\"args\":{\"file\":";
+                    appendJSONString( content, span.detail.c_str() );
+                    content += "}";
+                }
+
+                content += "}";
+            }
+
+            buffer->spans.clear();
+        }
+
+        hasActiveRecording = false;
+    }
+    content += "]}\n";
+
+    CFile *traceStream = root->Open( path, L"wb" );
+
+    if ( traceStream == nullptr )
+        return false;
+
+    try
+    {
+        traceStream->Write( content.c_str(), content.size() );
+    }
+    catch( ... )
+    {
+        delete traceStream;
+
+        throw;
+    }
+
+    delete traceStream;
+
+    return true;
+}
+
+struct toolTraceEnv
+{
+    inline void Initialize( MainWindow *mainWnd )
+    {
+        NativeExecutive::CExecutiveManager *nativeExec = (NativeExecutive::CExecutiveManager*)rw::GetThreadingNativeManager( mainWnd->GetEngine() );
+
+        traceNativeExec = nativeExec;
+        traceBuffersLock = nativeExec->CreateReadWriteLock();
+    }
+
+    inline void Shutdown( MainWindow *mainWnd )
+    {
+        NativeExecutive::CExecutiveManager *nativeExec = traceNativeExec;
+
+        ToolTrace::isRecording.store( false );
+
+        for ( threadTraceBuffer *buffer : traceBuffers )
+        {
+            nativeExec->CloseReadWriteLock( buffer->lock );
+
+            delete buffer;
+        }
+
+        traceBuffers.clear();
+
+        nativeExec->CloseReadWriteLock( traceBuffersLock );
+
+        traceBuffersLock = nullptr;
+        traceNativeExec = nullptr;
+    }
+};
+
+static PluginDependantStructRegister <toolTraceEnv, mainWindowFactory_t> toolTraceEnvRegister;
+
+void InitializeToolTraceEnv( void )
+{
+    toolTraceEnvRegister.RegisterPlugin( mainWindowFactory );
+}
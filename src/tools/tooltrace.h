@@ -0,0 +1,85 @@
+// Tracing of the hot paths of the mass tools.
+// Spans are collected into per-thread buffers while a recording is active and can be
+// written as a Chrome trace (chrome://tracing or ui.perfetto.dev).
+// If no recording is active, a span only costs a flag check.
+
+#pragma once
+
+#include <atomic>
+#include <string>
+
+namespace ToolTrace
+{
+    extern std::atomic <bool> isRecording;
+
+    inline bool IsRecording( void )
+    {
+        return isRecording.load( std::memory_order_relaxed );
+    }
+
+    // Microseconds since an arbitrary point in time.
+    rw::uint64 GetTimestamp( void );
+
+    void AddSpan( const char *name, std::string&& detail, rw::uint64 startTime, rw::uint64 endTime );
+
+    // Tracing can also be requested by setting the MAGICTXD_TRACE environment variable,
+    // so that runs started from the GUI can be traced.
+    bool IsRequestedByEnvironment( void );
+
+    // Only one recording can be active at a time; returns false if there is one already.
+    bool BeginRecording( void );
+
+    // Stops the recording and writes all spans into the given file.
+    bool EndRecording( CFileTranslator *root, const filePath& path );
+};
+
+struct ToolTraceScope
+{
+    // The name has to be a string literal.
+    inline ToolTraceScope( const char *name )
+    {
+        if ( ToolTrace::IsRecording() )
+        {
+            this->name = name;
+            this->startTime = ToolTrace::GetTimestamp();
+        }
+        else
+        {
+            this->name = nullptr;
+        }
+    }
+
+    // Attaches a file path to the span, which is only converted if we are recording.
+    inline ToolTraceScope( const char *name, const filePath& detail )
+    {
+        if ( ToolTrace::IsRecording() )
+        {
+            this->name = name;
+            this->detail = detail.convert_ansi <FileSysCommonAllocator> ().GetConstString();
+            this->startTime = ToolTrace::GetTimestamp();
+        }
+        else
+        {
+            this->name = nullptr;
+        }
+    }
+
+    inline ~ToolTraceScope( void )
+    {
+        if ( const char *name = this->name )
+        {
+            ToolTrace::AddSpan( name, std::move( this->detail ), this->startTime, ToolTrace::GetTimestamp() );
+        }
+    }
+
+private:
+    const char *name;
+    std::string detail;
+    rw::uint64 startTime;
+};
+
+#define TOOL_TRACE_CONCAT_HELPER( a, b ) a##b
+#define TOOL_TRACE_CONCAT( a, b ) TOOL_TRACE_CONCAT_HELPER( a, b )
+
+// Traces the remainder of the current scope.
+#define TOOL_TRACE_SCOPE( ... ) ToolTraceScope TOOL_TRACE_CONCAT( _toolTraceScope, __LINE__ ) ( __VA_ARGS__ )
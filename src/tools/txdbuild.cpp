@@ -1,6 +1,8 @@
 #include "mainwindow.h"
 
 #include "dirtools.h"
+#include "tooltrace.h"
+#include "memorybudget.h"
 
 #include "txdbuild.h"
 
@@ -10,8 +12,15 @@
 
 #include <regex>
 
+#include <sdk/NumericFormat.h>
+
 #include "imagepipe.hxx"
 
+static const wchar_t *const txdbuildTraceFileName = L"txdbuild.trace.json";
+
+// Resizing and mipmap generation work on a decoded copy of the image.
+static const rw::uint64 txdbuildDecodedCopies = 2;
+
 static const std::regex gameVer_regex( "(\\w+),(\\w+)" );
 static const std::regex game_regex( "(\\w+),(\\w+)" );
 
@@ -89,6 +98,8 @@ static rw::TextureBase* BuilderMakeTextureFromStream(
     const ConfigNode& cfgNode
 )
 {
+    TOOL_TRACE_SCOPE( "ReadImage" );
+
     txdBuildImageImportMethods imgImporter( rwEngine, module );
 
     // Set things up.
@@ -279,15 +290,35 @@ void BuildSingleTexture(
     rw::Interface *rwEngine, rw::TexDictionary *texDict,
     const filePath& texturePath, rw::Stream *imgStream,
     TxdBuildModule *module, const TxdBuildModule::run_config& config, const filePath& extention,
-    const ConfigNode& cfgParent
+    const ConfigNode& cfgParent, rw::uint64& budgetReservation, rw::uint64& decodedTotal
 )
 {
+    TOOL_TRACE_SCOPE( "BuildTexture", texturePath );
+
     rw::TextureBase *imgTex = BuilderMakeTextureFromStream( rwEngine, imgStream, extention, module, config.targetGame, config.targetPlatform, cfgParent );
 
     if ( imgTex )
     {
         try
         {
+            // The budget was reserved from the image headers before decoding.
+            // If the images turn out bigger, the reservation grows; the TXD must not wait for itself.
+            if ( rw::Raster *texRaster = imgTex->GetRaster() )
+            {
+                rw::uint32 width, height;
+
+                texRaster->getSize( width, height );
+
+                decodedTotal += ( (rw::uint64)width * height * 4 * txdbuildDecodedCopies );
+
+                if ( decodedTotal > budgetReservation )
+                {
+                    ToolMemoryBudget::Grow( decodedTotal - budgetReservation );
+
+                    budgetReservation = decodedTotal;
+                }
+            }
+
             // Put the texture into a correct version.
             PutVersionOnObject( imgTex, config.targetPlatform, config.targetGame, cfgParent );
 
@@ -333,6 +364,8 @@ void BuildSingleTexture(
 
                         if ( texRaster )
                         {
+                            TOOL_TRACE_SCOPE( "resize" );
+
                             texRaster->resize( width, height );
                         }
                     }
@@ -348,6 +381,8 @@ void BuildSingleTexture(
                 {
                     int genMipMaxLevel = GetConfigNodeInt( cfgParent, "genMipMaxLevel", 32 );
 
+                    TOOL_TRACE_SCOPE( "generateMipmaps" );
+
                     texRaster->generateMipmaps( genMipMaxLevel );
                 }
             }
@@ -367,6 +402,8 @@ void BuildSingleTexture(
                         getPaletteTypeFromString( palName.c_str(), paletteType );
                     }
 
+                    TOOL_TRACE_SCOPE( "convertToPalette" );
+
                     texRaster->convertToPalette( paletteType, rw::RASTER_8888 );    // maximum palette quality.
                 }
             }
@@ -381,6 +418,8 @@ void BuildSingleTexture(
                 {
                     float comprQuality = (float)GetConfigNodeFloat( cfgParent, "comprQuality", 1.0 );
 
+                    TOOL_TRACE_SCOPE( "compress" );
+
                     texRaster->compress( comprQuality );
                 }
             }
@@ -714,6 +753,13 @@ void BuildTXDArchives(
                     throw rw::RwException( "failed to allocate texture dictionary object" );
                 }
 
+                // Decoded memory of the textures of this TXD.
+                rw::uint64 budgetReservation = 0;
+                rw::uint64 decodedTotal = 0;
+
+                // The TXD usually ends up about as big as its images.
+                rw::uint64 imageDataSize = 0;
+
                 try
                 {
                     // Load configuration for this TXD.
@@ -730,6 +776,48 @@ void BuildTXDArchives(
                         );
                     }
 
+                    // Wait for the memory budget before any image is decoded.
+                    {
+                        rw::uint64 estimatedSize = 0;
+
+                        auto per_dir_estimate_cb = [&]( const filePath& texturePath )
+                        {
+                            filePath extOut;
+
+                            FileSystem::GetFileNameItem <FileSysCommonAllocator> ( texturePath, false, nullptr, &extOut );
+
+                            if ( extOut == L"ini" )
+                                return;
+
+                            CFile *fsImgStream = gameRoot->Open( texturePath, L"rb" );
+
+                            if ( fsImgStream == nullptr )
+                                return;
+
+                            try
+                            {
+                                estimatedSize += ( EstimateImageDecodedSize( fsImgStream, extOut ) * txdbuildDecodedCopies );
+                            }
+                            catch( ... )
+                            {
+                                delete fsImgStream;
+
+                                throw;
+                            }
+
+                            delete fsImgStream;
+                        };
+
+                        gameRoot->ScanDirectory( dirPath, "*", false, nullptr, std::move( per_dir_estimate_cb ), nullptr );
+
+                        if ( estimatedSize != 0 )
+                        {
+                            ToolMemoryBudget::Reserve( estimatedSize );
+
+                            budgetReservation = estimatedSize;
+                        }
+                    }
+
                     // Add all textures to this TXD.
                     {
                         auto per_dir_file_cb = [&]( const filePath& texturePath )
@@ -754,6 +842,8 @@ void BuildTXDArchives(
 
                             if ( fsImgStream )
                             {
+                                imageDataSize += (rw::uint64)fsImgStream->GetSizeNative();
+
                                 try
                                 {
                                     // Try to turn this file into a texture.
@@ -803,7 +893,7 @@ void BuildTXDArchives(
                                                             rwEngine, texDict,
                                                             texturePath, imgStream,
                                                             module, config, extOut,
-                                                            textureCfgNode
+                                                            textureCfgNode, budgetReservation, decodedTotal
                                                         );
                                                     }
                                                 }
@@ -870,12 +960,16 @@ void BuildTXDArchives(
                         {
                             try
                             {
-                                rw::Stream *txdStream = RwStreamCreateTranslated( rwEngine, fsTXDStream );
+                                bool writeFailed;
+
+                                rw::Stream *txdStream = RwStreamCreateOutput( rwEngine, fsTXDStream, imageDataSize, true, writeFailed );
 
                                 if ( txdStream )
                                 {
                                     try
                                     {
+                                        TOOL_TRACE_SCOPE( "Serialize", txdWritePath );
+
                                         // Finally, get to write this thing.
                                         rwEngine->Serialize( texDict, txdStream );
                                     }
@@ -887,6 +981,11 @@ void BuildTXDArchives(
                                     }
 
                                     rwEngine->DeleteStream( txdStream );
+
+                                    if ( writeFailed )
+                                    {
+                                        module->OnMessage( L"failed to write TXD\n" );
+                                    }
                                 }
                             }
                             catch( ... )
@@ -908,10 +1007,14 @@ void BuildTXDArchives(
                 {
                     rwEngine->DeleteRwObject( texDict );
 
+                    ToolMemoryBudget::Release( budgetReservation );
+
                     throw;
                 }
 
                 rwEngine->DeleteRwObject( texDict );
+
+                ToolMemoryBudget::Release( budgetReservation );
             }
 
             // Allow termination per TXD archive.
@@ -998,7 +1101,11 @@ bool TxdBuildModule::RunApplication( const run_config& config )
                         {
                             if ( hasGameRoot && hasOutputRoot )
                             {
+                                ToolRunSession runSession( this, config.memoryBudget, config.writeTrace, outputRootTranslator, txdbuildTraceFileName );
+
                                 BuildTXDArchives( this->rwEngine, this, gameRootTranslator, outputRootTranslator, config, rootNode );
+
+                                runSession.End();
                             }
                         }
                         catch( ... )
@@ -24,6 +24,13 @@ struct TxdBuildModule abstract : public MessageReceiver, public rw::WarningManag
         float compressionQuality = 1.0f;
         bool doPalettize = false;
         rw::ePaletteType paletteType = rw::PALETTE_NONE;
+
+        // Upper limit of decoded texture data in megabytes, shared with the other mass tools.
+        // Zero means no limit.
+        rw::uint32 memoryBudget = 4096;
+
+        // Write a Chrome trace of the run into the output root.
+        bool writeTrace = false;
     };
 
     bool RunApplication( const run_config& cfg );
@@ -2,6 +2,14 @@
 #include "txdexport.h"
 
 #include "dirtools.h"
+#include "tooltrace.h"
+#include "costestimate.h"
+#include "memorybudget.h"
+
+#include <sdk/NumericFormat.h>
+
+static const wchar_t *const txdexportTraceFileName = L"txdexport.trace.json";
+static const wchar_t *const txdexportScanIndexFileName = L"txdexport.scanindex";
 
 static rw::TexDictionary* RwTexDictionaryStreamRead( rw::Interface *rwEngine, CFile *stream )
 {
@@ -13,6 +21,8 @@ static rw::TexDictionary* RwTexDictionaryStreamRead( rw::Interface *rwEngine, CF
     {
         try
         {
+            TOOL_TRACE_SCOPE( "Deserialize" );
+
             rw::RwObject *rwObj = rwEngine->Deserialize( rwStream );
 
             if ( rwObj )
@@ -97,7 +107,18 @@ static void ExportImagesFromDictionary(
             {
                 try
                 {
-                    rw::Stream *rwStream = RwStreamCreateTranslated( rwEngine, targetStream );
+                    // Decoded to RGBA, which is about the most that an image format takes.
+                    // Since it is only a limit, we do not grow the file to it.
+                    rw::uint32 width, height;
+
+                    texRaster->getSize( width, height );
+
+                    rw::uint64 expectedSize = ( (rw::uint64)width * height * 4 );
+
+                    // If we failed to write it, we live with it like with any other error.
+                    bool writeFailed;
+
+                    rw::Stream *rwStream = RwStreamCreateOutput( rwEngine, targetStream, expectedSize, false, writeFailed );
 
                     if ( rwStream )
                     {
@@ -106,6 +127,8 @@ static void ExportImagesFromDictionary(
                             // Write it!
                             try
                             {
+                                TOOL_TRACE_SCOPE( "WriteImage", targetFileName );
+
                                 if ( strieq( imgFormat.GetConstString(), "RWTEX" ) )
                                 {
                                     rwEngine->Serialize( texHandle, rwStream );
@@ -151,7 +174,7 @@ struct _discFileSentry_txdexport
     inline bool OnSingletonFile(
         CFileTranslator *sourceRoot, CFileTranslator *buildRoot, const filePath& relPathFromRoot,
         const filePath& fileName, const filePath& extention, CFile *sourceStream,
-        bool isInArchive
+        bool isInArchive, BuildManifestEntry *manifestEntry
     )
     {
         rw::Interface *rwEngine = module->GetEngine();
@@ -187,30 +210,46 @@ struct _discFileSentry_txdexport
 
                 buildRoot->GetRelativePathFromRoot( relPathFromRoot, false, relPathFromRootWithoutFile );
 
-                // For each texture that we find, export it as raw image.
-                rw::TexDictionary *texDict = RwTexDictionaryStreamRead( rwEngine, sourceStream );
+                // The textures are decoded for writing them as images.
+                rw::uint64 budgetReservation = EstimateTXDDecodedSize( sourceStream );
 
-                if ( texDict )
+                ToolMemoryBudget::Reserve( budgetReservation );
+
+                try
                 {
-                    try
-                    {
-                        // Export everything inside of this.
-                        ExportImagesFromDictionary(
-                            texDict, buildRoot, fileName, relPathFromRootWithoutFile, config->outputType,
-                            config->recImgFormat
-                        );
+                    // For each texture that we find, export it as raw image.
+                    rw::TexDictionary *texDict = RwTexDictionaryStreamRead( rwEngine, sourceStream );
 
-                        anyWork = true;
-                    }
-                    catch( ... )
+                    if ( texDict )
                     {
-                        rwEngine->DeleteRwObject( texDict );
+                        try
+                        {
+                            // Export everything inside of this.
+                            ExportImagesFromDictionary(
+                                texDict, buildRoot, fileName, relPathFromRootWithoutFile, config->outputType,
+                                config->recImgFormat
+                            );
 
-                        throw;
+                            anyWork = true;
+                        }
+                        catch( ... )
+                        {
+                            rwEngine->DeleteRwObject( texDict );
+
+                            throw;
+                        }
+
+                        rwEngine->DeleteRwObject( texDict );
                     }
+                }
+                catch( ... )
+                {
+                    ToolMemoryBudget::Release( budgetReservation );
 
-                    rwEngine->DeleteRwObject( texDict );
+                    throw;
                 }
+
+                ToolMemoryBudget::Release( budgetReservation );
             }
         }
         catch( rw::RwException& except )
@@ -226,6 +265,16 @@ struct _discFileSentry_txdexport
     {
         return;
     }
+
+    inline bool NeedsFileContents( const filePath& extention ) const
+    {
+        return extention.equals( "TXD", false );
+    }
+
+    inline void OnArchiveContentsDone( void )
+    {
+        return;
+    }
 };
 
 bool MassExportModule::ApplicationMain( const run_config& cfg )
@@ -262,7 +311,45 @@ bool MassExportModule::ApplicationMain( const run_config& cfg )
                 sentry.module = this;
                 sentry.config = &cfg;
 
-                fileProc.process( &sentry, gameRootTranslator, outputRootTranslator );
+                ToolScanIndex *scanIndex = nullptr;
+
+                if ( cfg.useScanIndex )
+                {
+                    scanIndex = new ToolScanIndex();
+
+                    scanIndex->Load( outputRootTranslator, txdexportScanIndexFileName );
+
+                    fileProc.setScanIndex( scanIndex );
+                }
+
+                ToolRunSession runSession( this, cfg.memoryBudget, cfg.writeTrace, outputRootTranslator, txdexportTraceFileName );
+
+                try
+                {
+                    fileProc.process( &sentry, gameRootTranslator, outputRootTranslator );
+                }
+                catch( ... )
+                {
+                    if ( scanIndex )
+                    {
+                        delete scanIndex;
+                    }
+
+                    throw;
+                }
+
+                // Only a complete run may leave an index behind.
+                if ( scanIndex )
+                {
+                    if ( !scanIndex->Save( outputRootTranslator, txdexportScanIndexFileName ) )
+                    {
+                        this->OnMessage( "failed to write the scan index\n" );
+                    }
+
+                    delete scanIndex;
+                }
+
+                runSession.End();
             }
         }
         catch( ... )
@@ -17,6 +17,17 @@ struct MassExportModule abstract : public MessageReceiver
         rw::rwStaticString <wchar_t> outputRoot = L"export_out/";
         rw::rwStaticString <char> recImgFormat = "PNG";
         eOutputType outputType = OUTPUT_TXDNAME;
+
+        // Upper limit of decoded texture data in megabytes, shared with the other mass tools.
+        // Zero means no limit.
+        rw::uint32 memoryBudget = 4096;
+
+        // Remember the directory listing of the game root in the output root, so that the
+        // next run only has to list the directories that have changed.
+        bool useScanIndex = false;
+
+        // Write a Chrome trace of the run into the output root.
+        bool writeTrace = false;
     };
 
     inline MassExportModule( rw::Interface *rwEngine )
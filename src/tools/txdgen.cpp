@@ -7,14 +7,29 @@
 #include <gtaconfig/include.h>
 
 #include "dirtools.h"
+#include "workerpool.h"
+#include "tooltrace.h"
+#include "costestimate.h"
+#include "memorybudget.h"
+
+#include "memfile.hxx"
 
 #include <sdk/NumericFormat.h>
 
 using namespace rwkind;
 
+static const wchar_t *const txdgenManifestFileName = L"txdgen.manifest";
+static const wchar_t *const txdgenScanIndexFileName = L"txdgen.scanindex";
+static const wchar_t *const txdgenTraceFileName = L"txdgen.trace.json";
+
+// While a TXD is converted, its textures exist decoded and as the converted copy.
+static const rw::uint64 txdgenDecodedCopies = 2;
+
 
 static inline void ConvertRasterToPlatformEx( rw::TextureBase *theTexture, rw::Raster *texRaster, rwkind::eTargetPlatform targetPlatform, rwkind::eTargetGame targetGame )
 {
+    TOOL_TRACE_SCOPE( "ConvertRasterToPlatform" );
+
     bool hasConversionSucceeded = rwkind::ConvertRasterToPlatform( texRaster, targetPlatform, targetGame );
 
     if ( hasConversionSucceeded == false )
@@ -23,14 +38,691 @@ static inline void ConvertRasterToPlatformEx( rw::TextureBase *theTexture, rw::R
     }
 }
 
+rw::TexDictionary* TxdGenModule::ReadTXDArchive( CFile *srcStream, rw::rwStaticString <char>& errMsg ) const
+{
+    rw::Interface *rwEngine = this->rwEngine;
+
+    rw::TexDictionary *txd = nullptr;
+
+    rw::Stream *txd_stream = RwStreamCreateTranslated( rwEngine, srcStream );
+
+    if ( txd_stream != nullptr )
+    {
+        try
+        {
+            TOOL_TRACE_SCOPE( "Deserialize" );
+
+            rw::RwObject *rwObj = rwEngine->Deserialize( txd_stream );
+
+            if ( rwObj )
+            {
+                txd = rw::ToTexDictionary( rwEngine, rwObj );
+
+                if ( txd == nullptr )
+                {
+                    errMsg = "not a texture dictionary (";
+                    errMsg += rwEngine->GetObjectTypeName( rwObj );
+                    errMsg += ")";
+
+                    rwEngine->DeleteRwObject( rwObj );
+                }
+            }
+            else
+            {
+                errMsg = "unknown RenderWare stream (maybe compressed)";
+            }
+        }
+        catch( rw::RwException& except )
+        {
+            errMsg = "error reading txd: " + except.message;
+        }
+        catch( ... )
+        {
+            rwEngine->DeleteStream( txd_stream );
+
+            throw;
+        }
+
+        rwEngine->DeleteStream( txd_stream );
+    }
+
+    return txd;
+}
+
+// Everything that is needed to transform the textures of a TXD.
+struct _txdgenTransformParams
+{
+    rw::Interface *rwEngine;
+    CFileTranslator *srcRoot;
+    filePath srcPathAbs;
+    eTargetPlatform targetPlatform;
+    eTargetGame targetGame;
+    bool clearMipmaps;
+    bool generateMipmaps;
+    rw::eMipmapGenerationMode mipGenMode;
+    rw::uint32 mipGenMaxLevel;
+    bool improveFiltering;
+    bool doCompress;
+    float compressionQuality;
+    const TxdGenModule::DebugImageOutput *debugOutput;
+    rw::LibraryVersion gameVersion;
+};
+
+static inline bool isSameEngineVersion( const rw::LibraryVersion& left, const rw::LibraryVersion& right )
+{
+    return ( left.rwLibMajor == right.rwLibMajor && left.rwLibMinor == right.rwLibMinor &&
+             left.rwRevMajor == right.rwRevMajor && left.rwRevMinor == right.rwRevMinor &&
+             left.buildNumber == right.buildNumber );
+}
+
+// Only every Nth texture gets a debug image.
+// The choice depends on the names only, so that it does not change with the thread timing.
+static bool isDebugImageWanted( const _txdgenTransformParams& params, rw::TextureBase *theTexture )
+{
+    const TxdGenModule::DebugImageOutput *debugOutput = params.debugOutput;
+
+    if ( debugOutput == nullptr || debugOutput->root == nullptr )
+        return false;
+
+    rw::uint32 sampleRate = debugOutput->sampleRate;
+
+    if ( sampleRate <= 1 )
+        return true;
+
+    auto srcPath = params.srcPathAbs.convert_unicode <rw::RwStaticMemAllocator> ();
+
+    const rw::rwStaticString <char>& texName = theTexture->GetName();
+
+    manifestHasher hasher;
+
+    hasher.Feed( srcPath.GetConstString(), srcPath.GetLength() * sizeof( wchar_t ) );
+    hasher.Feed( texName.GetConstString(), texName.GetLength() );
+
+    return ( hasher.GetHash() % sampleRate ) == 0;
+}
+
+// Debug image of the mipmaps of a texture.
+// Rendering and encoding the image is slow, so it is done on a copy of the raster,
+// usually by a background writer.
+struct _txdgenDebugImageJob : public ToolBackgroundJob
+{
+    inline _txdgenDebugImageJob( void )
+    {
+        this->raster = nullptr;
+        this->debugRoot = nullptr;
+        this->imageFormat = nullptr;
+    }
+
+    ~_txdgenDebugImageJob( void )
+    {
+        if ( rw::Raster *raster = this->raster )
+        {
+            rw::DeleteRaster( raster );
+        }
+    }
+
+    void Run( rw::Interface *rwEngine ) override
+    {
+        TOOL_TRACE_SCOPE( "WriteDebugImage", this->targetPath );
+
+        CFile *debugOutputStream = this->debugRoot->Open( this->targetPath, "wb" );
+
+        if ( debugOutputStream == nullptr )
+            return;
+
+        try
+        {
+            // Create a debug raster.
+            rw::Raster *newRaster = rw::CreateRaster( rwEngine );
+
+            if ( newRaster )
+            {
+                try
+                {
+                    newRaster->newNativeData( "Direct3D9" );
+
+                    // Put the debug content into it.
+                    {
+                        rw::Bitmap debugTexContent( rwEngine );
+
+                        debugTexContent.setBgColor( 1, 1, 1 );
+
+                        bool gotDebugContent = rw::DebugDrawMipmaps( rwEngine, this->raster, debugTexContent );
+
+                        if ( gotDebugContent )
+                        {
+                            newRaster->setImageData( debugTexContent );
+                        }
+                    }
+
+                    if ( newRaster->getMipmapCount() > 0 )
+                    {
+                        // Write the debug texture to it.
+                        rw::Stream *outputStream = RwStreamCreateTranslated( rwEngine, debugOutputStream );
+
+                        if ( outputStream )
+                        {
+                            try
+                            {
+                                newRaster->writeImage( outputStream, this->imageFormat );
+                            }
+                            catch( ... )
+                            {
+                                rwEngine->DeleteStream( outputStream );
+
+                                throw;
+                            }
+
+                            rwEngine->DeleteStream( outputStream );
+                        }
+                    }
+                }
+                catch( ... )
+                {
+                    rw::DeleteRaster( newRaster );
+
+                    throw;
+                }
+
+                rw::DeleteRaster( newRaster );
+            }
+        }
+        catch( ... )
+        {
+            delete debugOutputStream;
+
+            throw;
+        }
+
+        // Free the stream handle.
+        delete debugOutputStream;
+    }
+
+    rw::Raster *raster;
+    CFileTranslator *debugRoot;
+    filePath targetPath;
+    const char *imageFormat;
+};
+
+static void outputDebugImage( const _txdgenTransformParams& params, rw::TextureBase *theTexture, rw::Raster *texRaster )
+{
+    TOOL_TRACE_SCOPE( "DebugOutput" );
+
+    const TxdGenModule::DebugImageOutput *debugOutput = params.debugOutput;
+
+    auto srcPath = params.srcPathAbs.convert_unicode <rw::RwStaticMemAllocator> ();
+
+    filePath relSrcPath;
+
+    bool hasRelSrcPath = params.srcRoot->GetRelativePathFromRoot( srcPath.GetConstString(), true, relSrcPath );
+
+    if ( !hasRelSrcPath )
+        return;
+
+    // Create a unique filename for this texture.
+    filePath directoryPart;
+
+    filePath fileNamePart = FileSystem::GetFileNameItem <FileSysCommonAllocator> ( relSrcPath.c_str(), false, &directoryPart, nullptr );
+
+    if ( fileNamePart.size() == 0 )
+        return;
+
+    const char *imageFormat = debugOutput->imageFormat;
+
+    const char *imageExtention = ( strcmp( imageFormat, "PNG" ) == 0 ? ".png" : ".tga" );
+
+    _txdgenDebugImageJob *job = new _txdgenDebugImageJob();
+
+    try
+    {
+        job->debugRoot = debugOutput->root;
+        job->targetPath = directoryPart + fileNamePart + "_" + filePath( theTexture->GetName() ) + imageExtention;
+        job->imageFormat = imageFormat;
+
+        // The texture goes on to be compressed, so the image is made from a copy.
+        job->raster = rw::CloneRaster( texRaster );
+    }
+    catch( ... )
+    {
+        delete job;
+
+        throw;
+    }
+
+    if ( ToolBackgroundWriter *writer = debugOutput->writer )
+    {
+        writer->SubmitJob( job );
+    }
+    else
+    {
+        try
+        {
+            job->Run( params.rwEngine );
+        }
+        catch( ... )
+        {
+            delete job;
+
+            throw;
+        }
+
+        delete job;
+    }
+}
+
+// Properties of a texture that decide whether the transformation would change it.
+// Filled from a loaded texture or from the header of a texture native in dry runs.
+struct _txdgenTextureState
+{
+    bool isNativeOnTarget;
+    rw::uint32 width, height;
+    rw::uint32 mipCount;
+    rw::eRasterStageFilterMode filterMode;
+    bool isCompressed;
+};
+
+static bool isTextureStateOnTarget(
+    eTargetPlatform targetPlatform,
+    bool clearMipmaps, bool generateMipmaps, rw::uint32 mipGenMaxLevel,
+    bool doCompress, bool improveFiltering,
+    const _txdgenTextureState& state )
+{
+    if ( !state.isNativeOnTarget )
+        return false;
+
+    rw::uint32 mipCount = state.mipCount;
+
+    rw::eRasterStageFilterMode filterMode = state.filterMode;
+
+    bool hasMipmapFilter = ( filterMode != rw::RWFILTER_POINT && filterMode != rw::RWFILTER_LINEAR );
+
+    if ( clearMipmaps )
+    {
+        // Clearing also fixes the filtering, so the filter has to fit already.
+        if ( mipCount > 1 || hasMipmapFilter )
+            return false;
+    }
+
+    if ( generateMipmaps )
+    {
+        // Mipmaps are generated up to the maximum level or down to the smallest size.
+        rw::uint32 width = state.width;
+        rw::uint32 height = state.height;
+
+        rw::uint32 fullMipCount = 1;
+
+        while ( width > 1 || height > 1 )
+        {
+            width = std::max( width / 2, 1u );
+            height = std::max( height / 2, 1u );
+
+            fullMipCount++;
+        }
+
+        if ( mipCount < std::min( mipGenMaxLevel + 1, fullMipCount ) )
+            return false;
+
+        // The filtering is fixed afterwards, also if there is only one level.
+        if ( ( mipCount > 1 ) != hasMipmapFilter )
+            return false;
+    }
+
+    if ( doCompress )
+    {
+        // Palettization always quantizes again.
+        if ( targetPlatform == PLATFORM_PS2 )
+            return false;
+
+        if ( targetPlatform == PLATFORM_XBOX || targetPlatform == PLATFORM_PC )
+        {
+            if ( state.isCompressed == false )
+                return false;
+        }
+    }
+
+    if ( improveFiltering )
+    {
+        if ( filterMode != rw::RWFILTER_LINEAR && filterMode != rw::RWFILTER_LINEAR_LINEAR )
+            return false;
+    }
+
+    return true;
+}
+
+// Returns true if transforming the texture would not change it.
+// Decoding and encoding is expensive, so we leave such textures alone.
+// If in doubt, we say no.
+static bool isTextureOnTarget( const _txdgenTransformParams& params, rw::TextureBase *theTexture )
+{
+    // The debug image is made during the transformation.
+    if ( isDebugImageWanted( params, theTexture ) )
+        return false;
+
+    if ( !isSameEngineVersion( theTexture->GetEngineVersion(), params.gameVersion ) )
+        return false;
+
+    rw::Raster *texRaster = theTexture->GetRaster();
+
+    if ( texRaster == nullptr )
+        return true;
+
+    const char *targetNativeName = GetTargetNativeFormatName( params.targetPlatform, params.targetGame );
+
+    _txdgenTextureState state;
+    state.isNativeOnTarget = ( targetNativeName != nullptr && strcmp( texRaster->getNativeDataTypeName(), targetNativeName ) == 0 );
+    texRaster->getSize( state.width, state.height );
+    state.mipCount = texRaster->getMipmapCount();
+    state.filterMode = theTexture->GetFilterMode();
+    state.isCompressed = texRaster->isCompressed();
+
+    return isTextureStateOnTarget(
+        params.targetPlatform,
+        params.clearMipmaps, params.generateMipmaps, params.mipGenMaxLevel,
+        params.doCompress, params.improveFiltering,
+        state
+    );
+}
+
+// Transforms a single texture of a TXD.
+// Textures do not depend on each other, so this may run for multiple textures of the same TXD at once.
+static void transformTXDTexture( const _txdgenTransformParams& params, rw::TextureBase *theTexture )
+{
+    rw::Interface *rwEngine = params.rwEngine;
+
+    // Update the version of this texture.
+    theTexture->SetEngineVersion( params.gameVersion );
+
+    // We need to modify the raster.
+    rw::Raster *texRaster = theTexture->GetRaster();
+
+    if ( texRaster )
+    {
+        // Decide whether to convert to target architecture beforehand or afterward.
+        bool shouldConvertBeforehand = ShouldRasterConvertBeforehand( texRaster, params.targetPlatform );
+
+        bool hasConvertedToTargetArchitecture = false;
+
+        if ( shouldConvertBeforehand == true )
+        {
+            ConvertRasterToPlatformEx( theTexture, texRaster, params.targetPlatform, params.targetGame );
+
+            hasConvertedToTargetArchitecture = true;
+        }
+
+        // Clear mipmaps if requested.
+        if ( params.clearMipmaps )
+        {
+            texRaster->clearMipmaps();
+
+            theTexture->fixFiltering();
+        }
+
+        // Generate mipmaps on demand.
+        if ( params.generateMipmaps )
+        {
+            TOOL_TRACE_SCOPE( "generateMipmaps" );
+
+            // We generate as many mipmaps as we can.
+            texRaster->generateMipmaps( params.mipGenMaxLevel + 1, params.mipGenMode );
+
+            theTexture->fixFiltering();
+        }
+
+        // Output debug stuff.
+        if ( isDebugImageWanted( params, theTexture ) )
+        {
+            outputDebugImage( params, theTexture, texRaster );
+        }
+
+        // Palettize the texture to save space.
+        if ( params.doCompress )
+        {
+            // If we are not target architecture already, make sure we are.
+            if ( hasConvertedToTargetArchitecture == false )
+            {
+                ConvertRasterToPlatformEx( theTexture, texRaster, params.targetPlatform, params.targetGame );
+
+                hasConvertedToTargetArchitecture = true;
+            }
+
+            if ( params.targetPlatform == PLATFORM_PS2 )
+            {
+                TOOL_TRACE_SCOPE( "optimizeForLowEnd" );
+
+                texRaster->optimizeForLowEnd( params.compressionQuality );
+            }
+            else if ( params.targetPlatform == PLATFORM_XBOX || params.targetPlatform == PLATFORM_PC )
+            {
+                TOOL_TRACE_SCOPE( "compress" );
+
+                // Compress if we are not already compressed.
+                texRaster->compress( params.compressionQuality );
+            }
+        }
+
+        // Improve the filtering mode if the user wants us to.
+        if ( params.improveFiltering )
+        {
+            theTexture->improveFiltering();
+        }
+
+        // Convert it into the target platform.
+        if ( shouldConvertBeforehand == false )
+        {
+            if ( hasConvertedToTargetArchitecture == false )
+            {
+                ConvertRasterToPlatformEx( theTexture, texRaster, params.targetPlatform, params.targetGame );
+
+                hasConvertedToTargetArchitecture = true;
+            }
+        }
+    }
+}
+
+// Fan-out of the textures of a TXD to a ToolJobPool.
+struct _txdgenTextureBatch
+{
+    const _txdgenTransformParams *params;
+
+    std::vector <rw::TextureBase*> textures;
+
+    // Each texture collects its warnings on its own, so that we can output them in texture order.
+    std::vector <TxdGenModule::RwWarningBuffer> warnings;
+
+    static void transformJob( rw::Interface *rwEngine, size_t jobIndex, void *ud )
+    {
+        _txdgenTextureBatch *batch = (_txdgenTextureBatch*)ud;
+
+        rwEngine->SetWarningManager( &batch->warnings[ jobIndex ] );
+
+        try
+        {
+            transformTXDTexture( *batch->params, batch->textures[ jobIndex ] );
+        }
+        catch( ... )
+        {
+            rwEngine->SetWarningManager( nullptr );
+
+            throw;
+        }
+
+        rwEngine->SetWarningManager( nullptr );
+    }
+
+    inline void FlushWarnings( TxdGenModule::RwWarningBuffer *warningsOut )
+    {
+        for ( TxdGenModule::RwWarningBuffer& textureWarnings : this->warnings )
+        {
+            if ( textureWarnings.buffer.GetLength() > 0 )
+            {
+                warningsOut->OnWarning( std::move( textureWarnings.buffer ) );
+
+                textureWarnings.buffer.Clear();
+            }
+        }
+    }
+};
+
+bool TxdGenModule::TransformTXDArchive(
+    rw::TexDictionary *txd, CFileTranslator *srcRoot, const filePath& srcPathAbs,
+    eTargetPlatform targetPlatform, eTargetGame targetGame,
+    bool clearMipmaps,
+    bool generateMipmaps, rw::eMipmapGenerationMode mipGenMode, rw::uint32 mipGenMaxLevel,
+    bool improveFiltering,
+    bool doCompress, float compressionQuality,
+    const DebugImageOutput *debugOutput,
+    const rw::LibraryVersion& gameVersion,
+    bool skipUnchangedTextures, bool& isUnchangedOut,
+    ToolJobPool *texturePool, RwWarningBuffer *warningsOut,
+    rw::rwStaticString <char>& errMsg
+) const
+{
+    _txdgenTransformParams params;
+    params.rwEngine = this->rwEngine;
+    params.srcRoot = srcRoot;
+    params.srcPathAbs = srcPathAbs;
+    params.targetPlatform = targetPlatform;
+    params.targetGame = targetGame;
+    params.clearMipmaps = clearMipmaps;
+    params.generateMipmaps = generateMipmaps;
+    params.mipGenMode = mipGenMode;
+    params.mipGenMaxLevel = mipGenMaxLevel;
+    params.improveFiltering = improveFiltering;
+    params.doCompress = doCompress;
+    params.compressionQuality = compressionQuality;
+    params.debugOutput = debugOutput;
+    params.gameVersion = gameVersion;
+
+    isUnchangedOut = false;
+
+    try
+    {
+        // Find the textures that actually need work.
+        std::vector <rw::TextureBase*> affectedTextures;
+
+        for ( rw::TexDictionary::texIter_t iter = txd->GetTextureIterator(); !iter.IsEnd(); iter.Increment() )
+        {
+            rw::TextureBase *theTexture = iter.Resolve();
+
+            if ( !skipUnchangedTextures || !isTextureOnTarget( params, theTexture ) )
+            {
+                affectedTextures.push_back( theTexture );
+            }
+        }
+
+        // If nothing would change, the caller can take over the original file.
+        if ( affectedTextures.empty() && skipUnchangedTextures && isSameEngineVersion( txd->GetEngineVersion(), gameVersion ) )
+        {
+            isUnchangedOut = true;
+
+            return true;
+        }
+
+        // Update the version of this texture dictionary.
+        txd->SetEngineVersion( gameVersion );
+
+        if ( texturePool != nullptr && warningsOut != nullptr && affectedTextures.size() > 1 )
+        {
+            // Big TXDs would keep a single thread busy for a long time, so spread their textures.
+            _txdgenTextureBatch batch;
+            batch.params = &params;
+            batch.textures = std::move( affectedTextures );
+
+            batch.warnings.resize( batch.textures.size() );
+
+            for ( TxdGenModule::RwWarningBuffer& textureWarnings : batch.warnings )
+            {
+                textureWarnings.module = warningsOut->module;
+            }
+
+            try
+            {
+                texturePool->RunJobs( batch.textures.size(), _txdgenTextureBatch::transformJob, &batch );
+            }
+            catch( ... )
+            {
+                // Keep the warnings of the textures that went through.
+                batch.FlushWarnings( warningsOut );
+
+                throw;
+            }
+
+            batch.FlushWarnings( warningsOut );
+        }
+        else
+        {
+            for ( rw::TextureBase *theTexture : affectedTextures )
+            {
+                transformTXDTexture( params, theTexture );
+            }
+        }
+    }
+    catch( rw::RwException& except )
+    {
+        errMsg = "error processing textures: " + except.message;
+
+        return false;
+    }
+
+    return true;
+}
+
+bool TxdGenModule::WriteTXDArchive( rw::TexDictionary *txd, CFile *targetStream, rw::uint64 expectedSize, rw::rwStaticString <char>& errMsg ) const
+{
+    rw::Interface *rwEngine = this->rwEngine;
+
+    bool hasWritten = false;
+
+    // Write the TXD into the target stream.
+    // Serialization does many small writes, so collect them into big blocks.
+    bool writeFailed;
+
+    rw::Stream *rwTargetStream = RwStreamCreateOutput( rwEngine, targetStream, expectedSize, true, writeFailed );
+
+    if ( rwTargetStream )
+    {
+        try
+        {
+            TOOL_TRACE_SCOPE( "Serialize" );
+
+            rwEngine->Serialize( txd, rwTargetStream );
+
+            hasWritten = true;
+        }
+        catch( rw::RwException& except )
+        {
+            errMsg = "error writing txd: " + except.message;
+        }
+        catch( ... )
+        {
+            rwEngine->DeleteStream( rwTargetStream );
+
+            throw;
+        }
+
+        rwEngine->DeleteStream( rwTargetStream );
+
+        if ( hasWritten && writeFailed )
+        {
+            errMsg = "error writing txd: could not write to the target";
+
+            hasWritten = false;
+        }
+    }
+
+    return hasWritten;
+}
+
 bool TxdGenModule::ProcessTXDArchive(
     CFileTranslator *srcRoot, CFile *srcStream, CFile *targetStream, eTargetPlatform targetPlatform, eTargetGame targetGame,
     bool clearMipmaps,
     bool generateMipmaps, rw::eMipmapGenerationMode mipGenMode, rw::uint32 mipGenMaxLevel,
     bool improveFiltering,
     bool doCompress, float compressionQuality,
-    bool outputDebug, CFileTranslator *debugRoot,
+    const DebugImageOutput *debugOutput,
     const rw::LibraryVersion& gameVersion,
+    bool skipUnchangedTextures,
+    ToolJobPool *texturePool, RwWarningBuffer *warningsOut,
     rw::rwStaticString <char>& errMsg
 ) const
 {
@@ -39,432 +731,656 @@ bool TxdGenModule::ProcessTXDArchive(
     bool hasProcessed = false;
 
     // Optimize the texture archive.
-    rw::Stream *txd_stream = RwStreamCreateTranslated( rwEngine, srcStream );
+    rw::TexDictionary *txd = this->ReadTXDArchive( srcStream, errMsg );
 
-    try
+    if ( txd )
     {
-        rw::TexDictionary *txd = nullptr;
+        try
+        {
+            bool isUnchanged;
+
+            bool couldTransform = this->TransformTXDArchive(
+                txd, srcRoot, srcStream->GetPath(), targetPlatform, targetGame,
+                clearMipmaps,
+                generateMipmaps, mipGenMode, mipGenMaxLevel,
+                improveFiltering,
+                doCompress, compressionQuality,
+                debugOutput,
+                gameVersion,
+                skipUnchangedTextures, isUnchanged,
+                texturePool, warningsOut,
+                errMsg
+            );
+
+            if ( couldTransform )
+            {
+                if ( isUnchanged )
+                {
+                    // Take over the original file.
+                    srcStream->Seek( 0, SEEK_SET );
+
+                    FileSystem::StreamCopy( *srcStream, *targetStream );
 
-        if ( txd_stream != nullptr )
+                    hasProcessed = true;
+                }
+                else
+                {
+                    hasProcessed = this->WriteTXDArchive( txd, targetStream, srcStream->GetSizeNative(), errMsg );
+                }
+            }
+        }
+        catch( ... )
         {
-            try
+            rwEngine->DeleteRwObject( txd );
+
+            throw;
+        }
+
+        // Delete the TXD.
+        rwEngine->DeleteRwObject( txd );
+    }
+
+    return hasProcessed;
+}
+
+struct _discFileSentry_txdgen
+{
+    TxdGenModule *module;
+    rwkind::eTargetPlatform targetPlatform;
+    rwkind::eTargetGame targetGame;
+    bool clearMipmaps;
+    bool generateMipmaps;
+    rw::eMipmapGenerationMode mipGenMode;
+    rw::uint32 mipGenMaxLevel;
+    bool improveFiltering;
+    bool doCompress;
+    float compressionQuality;
+    rw::LibraryVersion gameVersion;
+    bool skipUnchangedTextures;
+    const TxdGenModule::DebugImageOutput *debugOutput;
+    ToolWorkerPool *workerPool;
+    ToolJobPool *texturePool;
+
+    // Amount of source data that is kept in memory by the conversion pipeline.
+    size_t maxPipelineMemory;
+    size_t pipelineMemoryUsage;
+
+    inline bool TransformTXD( rw::TexDictionary *txd, CFileTranslator *sourceRoot, const filePath& sourcePath, bool& isUnchangedOut, TxdGenModule::RwWarningBuffer *warnings, rw::rwStaticString <char>& errorMessage ) const
+    {
+        return this->module->TransformTXDArchive(
+            txd, sourceRoot, sourcePath, this->targetPlatform, this->targetGame,
+            this->clearMipmaps,
+            this->generateMipmaps, this->mipGenMode, this->mipGenMaxLevel,
+            this->improveFiltering,
+            this->doCompress, this->compressionQuality,
+            this->debugOutput,
+            this->gameVersion,
+            this->skipUnchangedTextures, isUnchangedOut,
+            this->texturePool, warnings,
+            errorMessage
+        );
+    }
+
+    inline bool ConvertTXD( CFileTranslator *sourceRoot, CFile *sourceStream, CFile *targetStream, rw::rwStaticString <char>& errorMessage ) const
+    {
+        rw::uint64 budgetReservation = ( EstimateTXDDecodedSize( sourceStream ) * txdgenDecodedCopies );
+
+        ToolMemoryBudget::Reserve( budgetReservation );
+
+        bool couldConvert;
+
+        try
+        {
+            couldConvert = this->module->ProcessTXDArchive(
+                sourceRoot, sourceStream, targetStream, this->targetPlatform, this->targetGame,
+                this->clearMipmaps,
+                this->generateMipmaps, this->mipGenMode, this->mipGenMaxLevel,
+                this->improveFiltering,
+                this->doCompress, this->compressionQuality,
+                this->debugOutput,
+                this->gameVersion,
+                this->skipUnchangedTextures,
+                this->texturePool, &this->module->_warningMan,
+                errorMessage
+            );
+        }
+        catch( ... )
+        {
+            ToolMemoryBudget::Release( budgetReservation );
+
+            throw;
+        }
+
+        ToolMemoryBudget::Release( budgetReservation );
+
+        return couldConvert;
+    }
+
+    inline bool OnSingletonFile(
+        CFileTranslator *sourceRoot, CFileTranslator *buildRoot, const filePath& relPathFromRoot,
+        const filePath& fileName, const filePath& extention, CFile*& sourceStream,
+        bool isInArchive, BuildManifestEntry *manifestEntry
+    );
+
+    inline void OnArchiveFail( const filePath& fileName, const filePath& extention )
+    {
+        module->OnMessage( "failed to create new IMG archive for processing; defaulting to file-copy ...\n" );
+    }
+
+    // Only TXDs are converted; everything else is copied byte by byte.
+    inline bool NeedsFileContents( const filePath& extention ) const
+    {
+        return extention.equals( "TXD", false );
+    }
+
+    // Members of the archive are committed into it in their original order.
+    inline void OnArchiveContentsDone( void )
+    {
+        if ( ToolWorkerPool *workerPool = this->workerPool )
+        {
+            workerPool->Flush();
+        }
+    }
+};
+
+// Conversion of a single TXD file as a pipeline of three stages:
+// the source is read and decoded on the scanning thread, the textures are transformed
+// on a worker thread and the result is written by the writer thread.
+// The log and the warnings are kept until the task is committed so that they appear in file order.
+// Members of IMG archives are serialized into memory by the worker instead and written
+// into the archive when they are committed, so that the entry order stays the same.
+// Other files of an archive go through the same queue, only to keep their position,
+// unless nothing is queued in front of them.
+// The memory budget is reserved on the scanning thread, in file order, so that the tasks
+// that hold the budget are always ahead of the one that waits for it.
+struct _txdgenConversionTask : public ToolWorkerTask
+{
+    inline _txdgenConversionTask( _discFileSentry_txdgen *sentry, CFileTranslator *sourceRoot, const filePath& relPathFromRoot, CFile *targetStream )
+        : relPathFromRoot( relPathFromRoot )
+    {
+        this->sentry = sentry;
+        this->sourceRoot = sourceRoot;
+        this->sourceData = nullptr;
+        this->resultData = nullptr;
+        this->targetStream = targetStream;
+        this->archiveRoot = nullptr;
+        this->isTXD = true;
+        this->txd = nullptr;
+        this->couldProcessTXD = false;
+        this->isTXDUnchanged = false;
+        this->memoryUsage = 0;
+        this->budgetReservation = 0;
+        this->warnings.module = sentry->module;
+    }
+
+    inline ~_txdgenConversionTask( void )
+    {
+        this->ReleaseResources();
+    }
+
+    // Members of archives are done with the TXD once it is serialized.
+    inline void ReleaseDecodedTXD( void )
+    {
+        if ( rw::TexDictionary *txd = this->txd )
+        {
+            sentry->module->GetEngine()->DeleteRwObject( txd );
+
+            this->txd = nullptr;
+        }
+
+        ToolMemoryBudget::Release( this->budgetReservation );
+
+        this->budgetReservation = 0;
+    }
+
+    inline void ReleaseResources( void )
+    {
+        this->ReleaseDecodedTXD();
+
+        if ( CFile *targetStream = this->targetStream )
+        {
+            delete targetStream;
+
+            this->targetStream = nullptr;
+        }
+
+        if ( CMemoryFile *sourceData = this->sourceData )
+        {
+            delete sourceData;
+
+            this->sourceData = nullptr;
+        }
+
+        if ( CMemoryFile *resultData = this->resultData )
+        {
+            delete resultData;
+
+            this->resultData = nullptr;
+        }
+    }
+
+    // Stage one, on the scanning thread.
+    inline void Prefetch( CFile *sourceStream )
+    {
+        TOOL_TRACE_SCOPE( "PrefetchTXD", this->relPathFromRoot );
+
+        TxdGenModule *module = sentry->module;
+
+        rw::Interface *rwEngine = module->GetEngine();
+
+        this->sourcePath = sourceStream->GetPath();
+
+        // Read the entire file at once so that the disk does not have to wait for the workers.
+        CMemoryFile *sourceData = new CMemoryFile( this->sourcePath );
+
+        this->sourceData = sourceData;
+
+        sourceData->Reserve( sourceStream->GetSize() );
+        sourceData->ReadFromStream( sourceStream );
+
+        this->memoryUsage = sourceData->GetDataSize();
+
+        if ( !this->isTXD )
+            return;
+
+        // Wait until the decoded textures fit into memory.
+        rw::uint64 budgetReservation = ( EstimateTXDDecodedSize( sourceData ) * txdgenDecodedCopies );
+
+        ToolMemoryBudget::Reserve( budgetReservation );
+
+        this->budgetReservation = budgetReservation;
+
+        rwEngine->SetWarningManager( &this->warnings );
+
+        try
+        {
+            this->txd = module->ReadTXDArchive( sourceData, this->errorMessage );
+        }
+        catch( ... )
+        {
+            rwEngine->SetWarningManager( &module->_warningMan );
+
+            this->ReleaseDecodedTXD();
+
+            throw;
+        }
+
+        rwEngine->SetWarningManager( &module->_warningMan );
+
+        // Nothing was decoded, so the budget is free for the next files.
+        if ( this->txd == nullptr )
+        {
+            this->ReleaseDecodedTXD();
+        }
+    }
+
+    inline size_t GetMemoryUsage( void ) const
+    {
+        return this->memoryUsage;
+    }
+
+    // Stage two, on a worker thread.
+    void Execute( rw::Interface *rwEngine ) override
+    {
+        // The scanning thread may be waiting for our budget, so it is given back
+        // as soon as we know that the TXD will not be written.
+        try
+        {
+            // If we are asked to terminate, just do it.
+            rw::CheckThreadHazards( rwEngine );
+        }
+        catch( ... )
+        {
+            this->ReleaseDecodedTXD();
+
+            throw;
+        }
+
+        if ( this->txd == nullptr )
+        {
+            this->ReleaseDecodedTXD();
+            return;
+        }
+
+        TOOL_TRACE_SCOPE( "TransformTXD", this->relPathFromRoot );
+
+        // Warnings of this TXD go into our own buffer.
+        rwEngine->SetWarningManager( &this->warnings );
+
+        try
+        {
+            this->couldProcessTXD = sentry->TransformTXD( this->txd, this->sourceRoot, this->sourcePath, this->isTXDUnchanged, &this->warnings, this->errorMessage );
+
+            if ( this->archiveRoot != nullptr && this->couldProcessTXD && !this->isTXDUnchanged )
             {
-                rw::RwObject *rwObj = rwEngine->Deserialize( txd_stream );
+                CMemoryFile *resultData = new CMemoryFile( this->relPathFromRoot );
+
+                this->resultData = resultData;
+
+                this->couldProcessTXD = sentry->module->WriteTXDArchive( this->txd, resultData, this->sourceData->GetSizeNative(), this->errorMessage );
+            }
+        }
+        catch( ... )
+        {
+            rwEngine->SetWarningManager( nullptr );
+
+            this->ReleaseDecodedTXD();
+
+            throw;
+        }
+
+        rwEngine->SetWarningManager( nullptr );
+
+        if ( this->archiveRoot != nullptr )
+        {
+            this->ReleaseDecodedTXD();
+        }
+    }
+
+    // Stage three, on the writer thread.
+    void Write( rw::Interface *rwEngine ) override
+    {
+        // Archive members are written when they are committed.
+        if ( this->archiveRoot != nullptr )
+            return;
 
-                if ( rwObj )
-                {
-                    txd = rw::ToTexDictionary( rwEngine, rwObj );
+        TOOL_TRACE_SCOPE( "WriteTXD", this->relPathFromRoot );
 
-                    if ( txd == nullptr )
-                    {
-                        errMsg = "not a texture dictionary (";
-                        errMsg += rwEngine->GetObjectTypeName( rwObj );
-                        errMsg += ")";
+        rwEngine->SetWarningManager( &this->warnings );
 
-                        rwEngine->DeleteRwObject( rwObj );
-                    }
-                }
-                else
-                {
-                    errMsg = "unknown RenderWare stream (maybe compressed)";
-                }
+        try
+        {
+            if ( this->couldProcessTXD && !this->isTXDUnchanged )
+            {
+                this->couldProcessTXD = sentry->module->WriteTXDArchive( this->txd, this->targetStream, this->sourceData->GetSizeNative(), this->errorMessage );
             }
-            catch( rw::RwException& except )
+
+            if ( !this->couldProcessTXD || this->isTXDUnchanged )
             {
-                errMsg = "error reading txd: " + except.message;
+                // Take over the original file if nothing changed.
+                // Otherwise default to simple stream copy, like the serial path does.
+                this->sourceData->Seek( 0, SEEK_SET );
 
-                throw;
+                FileSystem::StreamCopy( *this->sourceData, *this->targetStream );
             }
         }
-
-        if ( txd )
+        catch( ... )
         {
-            // Update the version of this texture dictionary.
-            txd->SetEngineVersion( gameVersion );
+            rwEngine->SetWarningManager( nullptr );
 
-            try
-            {
-                // Process all textures.
-                bool processSuccessful = true;
+            this->ReleaseDecodedTXD();
 
-                try
-                {
-                    for ( rw::TexDictionary::texIter_t iter = txd->GetTextureIterator(); !iter.IsEnd(); iter.Increment() )
-                    {
-                        rw::TextureBase *theTexture = iter.Resolve();
+            throw;
+        }
 
-                        // Update the version of this texture.
-                        theTexture->SetEngineVersion( gameVersion );
+        rwEngine->SetWarningManager( nullptr );
 
-                        // We need to modify the raster.
-                        rw::Raster *texRaster = theTexture->GetRaster();
+        // Release the file handle and the memory as soon as possible.
+        this->ReleaseResources();
+    }
 
-                        if ( texRaster )
-                        {
-                            // Decide whether to convert to target architecture beforehand or afterward.
-                            bool shouldConvertBeforehand = ShouldRasterConvertBeforehand( texRaster, targetPlatform );
+    // Puts the result into the archive, on the scanning thread.
+    inline void WriteArchiveMember( void )
+    {
+        TOOL_TRACE_SCOPE( "WriteArchiveMember", this->relPathFromRoot );
 
-                            bool hasConvertedToTargetArchitecture = false;
+        CFile *targetStream = this->archiveRoot->Open( this->relPathFromRoot, L"wb" );
 
-                            if ( shouldConvertBeforehand == true )
-                            {
-                                ConvertRasterToPlatformEx( theTexture, texRaster, targetPlatform, targetGame );
+        if ( targetStream == nullptr )
+            return;
 
-                                hasConvertedToTargetArchitecture = true;
-                            }
+        try
+        {
+            CMemoryFile *data = this->sourceData;
 
-                            // Clear mipmaps if requested.
-                            if ( clearMipmaps )
-                            {
-                                texRaster->clearMipmaps();
+            if ( this->couldProcessTXD && !this->isTXDUnchanged )
+            {
+                data = this->resultData;
+            }
 
-                                theTexture->fixFiltering();
-                            }
+            data->Seek( 0, SEEK_SET );
 
-                            // Generate mipmaps on demand.
-                            if ( generateMipmaps )
-                            {
-                                // We generate as many mipmaps as we can.
-                                texRaster->generateMipmaps( mipGenMaxLevel + 1, mipGenMode );
+            FileSystem::StreamCopy( *data, *targetStream );
+        }
+        catch( ... )
+        {
+            delete targetStream;
 
-                                theTexture->fixFiltering();
-                            }
+            throw;
+        }
 
-                            // Output debug stuff.
-                            if ( outputDebug && debugRoot != nullptr )
-                            {
-                                // We want to debug mipmap generation, so output debug textures only using mipmaps.
-                                //if ( _meetsDebugCriteria( tex ) )
-                                {
-                                    auto srcPath = srcStream->GetPath().convert_unicode <rw::RwStaticMemAllocator> ();
-
-                                    filePath relSrcPath;
-
-                                    bool hasRelSrcPath = srcRoot->GetRelativePathFromRoot( srcPath.GetConstString(), true, relSrcPath );
-
-                                    if ( hasRelSrcPath )
-                                    {
-                                        // Create a unique filename for this texture.
-                                        filePath directoryPart;
-
-                                        filePath fileNamePart = FileSystem::GetFileNameItem <FileSysCommonAllocator> ( relSrcPath.c_str(), false, &directoryPart, nullptr );
-
-                                        if ( fileNamePart.size() != 0 )
-                                        {
-                                            filePath uniqueTextureNameTGA = directoryPart + fileNamePart + "_" + filePath( theTexture->GetName() ) + ".tga";
-
-                                            CFile *debugOutputStream = debugRoot->Open( uniqueTextureNameTGA, "wb" );
-
-                                            if ( debugOutputStream )
-                                            {
-                                                // Create a debug raster.
-                                                rw::Raster *newRaster = rw::CreateRaster( rwEngine );
-
-                                                if ( newRaster )
-                                                {
-                                                    try
-                                                    {
-                                                        newRaster->newNativeData( "Direct3D9" );
-
-                                                        // Put the debug content into it.
-                                                        {
-                                                            rw::Bitmap debugTexContent( rwEngine );
-
-                                                            debugTexContent.setBgColor( 1, 1, 1 );
-
-                                                            bool gotDebugContent = rw::DebugDrawMipmaps( rwEngine, texRaster, debugTexContent );
-
-                                                            if ( gotDebugContent )
-                                                            {
-                                                                newRaster->setImageData( debugTexContent );
-                                                            }
-                                                        }
-
-                                                        if ( newRaster->getMipmapCount() > 0 )
-                                                        {
-                                                            // Write the debug texture to it.
-                                                            rw::Stream *outputStream = RwStreamCreateTranslated( rwEngine, debugOutputStream );
-
-                                                            if ( outputStream )
-                                                            {
-                                                                try
-                                                                {
-                                                                    newRaster->writeImage( outputStream, "TGA" );
-                                                                }
-                                                                catch( ... )
-                                                                {
-                                                                    rwEngine->DeleteStream( outputStream );
-
-                                                                    throw;
-                                                                }
-
-                                                                rwEngine->DeleteStream( outputStream );
-                                                            }
-                                                        }
-                                                    }
-                                                    catch( ... )
-                                                    {
-                                                        rw::DeleteRaster( newRaster );
-
-                                                        throw;
-                                                    }
-
-                                                    rw::DeleteRaster( newRaster );
-                                                }
-
-                                                // Free the stream handle.
-                                                delete debugOutputStream;
-                                            }
-                                        }
-                                    }
-                                }
-                            }
+        delete targetStream;
+    }
 
-                            // Palettize the texture to save space.
-                            if ( doCompress )
-                            {
-                                // If we are not target architecture already, make sure we are.
-                                if ( hasConvertedToTargetArchitecture == false )
-                                {
-                                    ConvertRasterToPlatformEx( theTexture, texRaster, targetPlatform, targetGame );
-
-                                    hasConvertedToTargetArchitecture = true;
-                                }
-
-                                if ( targetPlatform == PLATFORM_PS2 )
-                                {
-                                    texRaster->optimizeForLowEnd( compressionQuality );
-                                }
-                                else if ( targetPlatform == PLATFORM_XBOX || targetPlatform == PLATFORM_PC )
-                                {
-                                    // Compress if we are not already compressed.
-                                    texRaster->compress( compressionQuality );
-                                }
-                            }
+    void Commit( void ) override
+    {
+        TxdGenModule *module = sentry->module;
 
-                            // Improve the filtering mode if the user wants us to.
-                            if ( improveFiltering )
-                            {
-                                theTexture->improveFiltering();
-                            }
+        if ( this->archiveRoot != nullptr )
+        {
+            this->WriteArchiveMember();
 
-                            // Convert it into the target platform.
-                            if ( shouldConvertBeforehand == false )
-                            {
-                                if ( hasConvertedToTargetArchitecture == false )
-                                {
-                                    ConvertRasterToPlatformEx( theTexture, texRaster, targetPlatform, targetGame );
+            this->ReleaseResources();
+        }
 
-                                    hasConvertedToTargetArchitecture = true;
-                                }
-                            }
-                        }
-                    }
-                }
-                catch( rw::RwException& except )
-                {
-                    errMsg = "error processing textures: " + except.message;
+        sentry->pipelineMemoryUsage -= this->memoryUsage;
 
-                    throw;
-                }
+        this->memoryUsage = 0;
 
-#if 0
-                // Introduce this stub when dealing with memory leaks.
-                static int ok_num = 0;
+        if ( !this->isTXD )
+            return;
 
-                if ( ok_num++ > 100 )
-                {
-                    throw termination_request();
-                }
-#endif
+        // A file that could not be converted has to be built again next time.
+        if ( this->couldProcessTXD )
+        {
+            this->manifestEntry.Record();
+        }
 
-                // We do not perform any error checking for now.
-                if ( processSuccessful )
-                {
-                    // Write the TXD into the target stream.
-                    rw::Stream *rwTargetStream = RwStreamCreateTranslated( rwEngine, targetStream );
+        module->OnMessage( "*** " + relPathFromRoot.convert_ansi <rw::RwStaticMemAllocator> () + " ..." );
 
-                    if ( targetStream )
-                    {
-                        try
-                        {
-                            try
-                            {
-                                rwEngine->Serialize( txd, rwTargetStream );
-                            }
-                            catch( rw::RwException& except )
-                            {
-                                errMsg = "error writing txd: " + except.message;
+        if ( this->couldProcessTXD )
+        {
+            module->OnMessage( "OK\n" );
+        }
+        else
+        {
+            module->OnMessage( "error:\n" + this->errorMessage + "\n" );
+        }
 
-                                throw;
-                            }
-                        }
-                        catch( ... )
-                        {
-                            rwEngine->DeleteStream( rwTargetStream );
+        // Output any warnings.
+        this->warnings.Purge();
+    }
 
-                            throw;
-                        }
+    _discFileSentry_txdgen *sentry;
+    CFileTranslator *sourceRoot;
+    filePath relPathFromRoot;
+    filePath sourcePath;
+    CMemoryFile *sourceData;
+    CMemoryFile *resultData;
+    CFile *targetStream;
+
+    // Archive to put the result into; null for loose files.
+    CFileTranslator *archiveRoot;
+    bool isTXD;
+
+    rw::TexDictionary *txd;
+
+    bool couldProcessTXD;
+    bool isTXDUnchanged;
+    size_t memoryUsage;
+    rw::uint64 budgetReservation;
+    BuildManifestEntry manifestEntry;
+    rw::rwStaticString <char> errorMessage;
+    TxdGenModule::RwWarningBuffer warnings;
+};
 
-                        rwEngine->DeleteStream( rwTargetStream );
+inline bool _discFileSentry_txdgen::OnSingletonFile(
+    CFileTranslator *sourceRoot, CFileTranslator *buildRoot, const filePath& relPathFromRoot,
+    const filePath& fileName, const filePath& extention, CFile*& sourceStream,
+    bool isInArchive, BuildManifestEntry *manifestEntry
+)
+{
+    // If we are asked to terminate, just do it.
+    rw::CheckThreadHazards( module->GetEngine() );
 
-                        hasProcessed = true;
-                    }
-                }
-            }
-            catch( ... )
-            {
-                rwEngine->DeleteRwObject( txd );
+    // Decide whether we need a copy.
+    bool requiresCopy = false;
 
-                txd = NULL;
+    bool anyWork = false;
 
-                throw;
-            }
+    bool isTXD = extention.equals( "TXD", false );
 
-            // Delete the TXD.
-            rwEngine->DeleteRwObject( txd );
-        }
-    }
-    catch( rw::RwException& )
+    if ( isTXD == true || isInArchive )
     {
-        hasProcessed = false;
+        requiresCopy = true;
     }
-    catch( ... )
+
+    // Files can be converted on the worker threads.
+    // The archive translators are only used by this thread, so members of archives
+    // are opened for writing when their task is committed.
+    bool usePipeline = ( sourceStream && this->workerPool != nullptr && ( isInArchive || ( isTXD && requiresCopy ) ) );
+
+    // Other members of archives only go through the queue to keep their position.
+    // If no earlier task is waiting to be committed, they are copied right away.
+    if ( usePipeline && isInArchive && !isTXD )
     {
-        hasProcessed = false;
+        ToolWorkerPool *workerPool = this->workerPool;
 
-        if ( txd_stream )
-        {
-            rwEngine->DeleteStream( txd_stream );
+        workerPool->CommitFinishedTasks();
 
-            txd_stream = NULL;
+        if ( workerPool->GetInflightTaskCount() == 0 )
+        {
+            usePipeline = false;
         }
-
-        throw;
     }
 
-    if ( txd_stream )
-    {
-        rwEngine->DeleteStream( txd_stream );
+    // Open the target stream.
+    CFile *targetStream = NULL;
 
-        txd_stream = NULL;
+    if ( requiresCopy && !( usePipeline && isInArchive ) )
+    {
+        targetStream = buildRoot->Open( relPathFromRoot, L"wb" );
     }
 
-    return hasProcessed;
-}
+    if ( usePipeline && ( targetStream || isInArchive ) )
+    {
+        ToolWorkerPool *workerPool = this->workerPool;
 
-struct _discFileSentry_txdgen
-{
-    TxdGenModule *module;
-    rwkind::eTargetPlatform targetPlatform;
-    rwkind::eTargetGame targetGame;
-    bool clearMipmaps;
-    bool generateMipmaps;
-    rw::eMipmapGenerationMode mipGenMode;
-    rw::uint32 mipGenMaxLevel;
-    bool improveFiltering;
-    bool doCompress;
-    float compressionQuality;
-    rw::LibraryVersion gameVersion;
-    bool outputDebug;
-    CFileTranslator *debugTranslator;
+        // Do not keep more source data in memory than we are allowed to.
+        size_t sourceSize = sourceStream->GetSize();
 
-    inline bool OnSingletonFile(
-        CFileTranslator *sourceRoot, CFileTranslator *buildRoot, const filePath& relPathFromRoot,
-        const filePath& fileName, const filePath& extention, CFile *sourceStream,
-        bool isInArchive
-    )
-    {
-        // If we are asked to terminate, just do it.
-        rw::CheckThreadHazards( module->GetEngine() );
+        while ( this->pipelineMemoryUsage > 0 && workerPool->GetInflightTaskCount() > 0 &&
+                this->pipelineMemoryUsage + sourceSize > this->maxPipelineMemory )
+        {
+            workerPool->CommitOldestTask();
+        }
+
+        _txdgenConversionTask *task = nullptr;
 
-        // Decide whether we need a copy.
-        bool requiresCopy = false;
+        try
+        {
+            task = new _txdgenConversionTask( this, sourceRoot, relPathFromRoot, targetStream );
+        }
+        catch( ... )
+        {
+            if ( targetStream )
+            {
+                delete targetStream;
+            }
 
-        bool anyWork = false;
+            throw;
+        }
 
-        if ( extention.equals( "TXD", false ) == true || isInArchive )
+        if ( isInArchive )
         {
-            requiresCopy = true;
+            task->archiveRoot = buildRoot;
+            task->isTXD = isTXD;
         }
 
-        // Open the target stream.
-        CFile *targetStream = NULL;
+        if ( manifestEntry )
+        {
+            task->manifestEntry = *manifestEntry;
+        }
 
-        if ( requiresCopy )
+        try
+        {
+            task->Prefetch( sourceStream );
+        }
+        catch( ... )
         {
-            targetStream = buildRoot->Open( relPathFromRoot, L"wb" );
+            delete task;
+
+            throw;
         }
 
-        if ( targetStream && sourceStream )
+        this->pipelineMemoryUsage += task->GetMemoryUsage();
+
+        workerPool->SubmitTask( task );
+
+        return isTXD;
+    }
+
+    if ( targetStream && sourceStream )
+    {
+        // Allow to perform custom logic on the source and target streams.
+        bool hasCopiedFile = false;
         {
-            // Allow to perform custom logic on the source and target streams.
-            bool hasCopiedFile = false;
+            if ( isTXD == true )
             {
-                if ( extention.equals( "TXD", false ) == true )
-                {
-                    module->OnMessage( "*** " + relPathFromRoot.convert_ansi <rw::RwStaticMemAllocator> () + " ..." );
+                module->OnMessage( "*** " + relPathFromRoot.convert_ansi <rw::RwStaticMemAllocator> () + " ..." );
 
-                    rw::rwStaticString <char> errorMessage;
+                rw::rwStaticString <char> errorMessage;
 
-                    bool couldProcessTXD = this->module->ProcessTXDArchive(
-                        sourceRoot, sourceStream, targetStream, this->targetPlatform, this->targetGame,
-                        this->clearMipmaps,
-                        this->generateMipmaps, this->mipGenMode, this->mipGenMaxLevel,
-                        this->improveFiltering,
-                        this->doCompress, this->compressionQuality,
-                        this->outputDebug, this->debugTranslator,
-                        this->gameVersion,
-                        errorMessage
-                    );
+                TOOL_TRACE_SCOPE( "ConvertTXD", relPathFromRoot );
 
-                    if ( couldProcessTXD )
-                    {
-                        hasCopiedFile = true;
+                bool couldProcessTXD = this->ConvertTXD( sourceRoot, sourceStream, targetStream, errorMessage );
 
-                        anyWork = true;
+                if ( couldProcessTXD )
+                {
+                    hasCopiedFile = true;
 
-                        module->OnMessage( "OK\n" );
-                    }
-                    else
+                    anyWork = true;
+
+                    module->OnMessage( "OK\n" );
+
+                    if ( manifestEntry )
                     {
-                        module->OnMessage( "error:\n" + errorMessage + "\n" );
+                        manifestEntry->Record();
                     }
-
-                    // Output any warnings.
-                    module->_warningMan.Purge();
                 }
-            }
-
-            if ( requiresCopy )
-            {
-                // If we have not yet created the new copy, we default to simple stream swap.
-                if ( !hasCopiedFile && targetStream )
+                else
                 {
-                    // Make sure we copy from the beginning of the source stream.
-                    sourceStream->Seek( 0, SEEK_SET );
-
-                    // Copy the stream contents.
-                    FileSystem::StreamCopy( *sourceStream, *targetStream );
-
-                    hasCopiedFile = true;
+                    module->OnMessage( "error:\n" + errorMessage + "\n" );
                 }
+
+                // Output any warnings.
+                module->_warningMan.Purge();
             }
         }
 
-        if ( targetStream )
+        if ( requiresCopy )
         {
-            delete targetStream;
-        }
+            // If we have not yet created the new copy, we default to simple stream swap.
+            if ( !hasCopiedFile && targetStream )
+            {
+                // Make sure we copy from the beginning of the source stream.
+                sourceStream->Seek( 0, SEEK_SET );
+
+                // Copy the stream contents.
+                FileSystem::StreamCopy( *sourceStream, *targetStream );
 
-        return anyWork;
+                hasCopiedFile = true;
+            }
+        }
     }
 
-    inline void OnArchiveFail( const filePath& fileName, const filePath& extention )
+    if ( targetStream )
     {
-        module->OnMessage( "failed to create new IMG archive for processing; defaulting to file-copy ...\n" );
+        delete targetStream;
     }
-};
+
+    return anyWork;
+}
 
 inline bool isGoodEngine( const rw::Interface *engineInterface )
 {
@@ -587,80 +1503,201 @@ TxdGenModule::run_config TxdGenModule::ParseConfig( CFileTranslator *root, const
                     cfg.c_compressionQuality = (float)mainEntry->GetFloat( "compressionQuality", 0.0 );
                 }
 
-                // Palette runtime type.
-                if ( const char *palRuntimeType = mainEntry->Get( "palRuntimeType" ) )
+                // Palette runtime type.
+                if ( const char *palRuntimeType = mainEntry->Get( "palRuntimeType" ) )
+                {
+                    if ( strieq( palRuntimeType, "native" ) )
+                    {
+                        cfg.c_palRuntimeType = rw::PALRUNTIME_NATIVE;
+                    }
+                    else if ( strieq( palRuntimeType, "pngquant" ) )
+                    {
+                        cfg.c_palRuntimeType = rw::PALRUNTIME_PNGQUANT;
+                    }
+                }
+
+                // DXT compression method.
+                if ( const char *dxtCompressionMethod = mainEntry->Get( "dxtRuntimeType" ) )
+                {
+                    if ( strieq( dxtCompressionMethod, "native" ) )
+                    {
+                        cfg.c_dxtRuntimeType = rw::DXTRUNTIME_NATIVE;
+                    }
+                    else if ( strieq( dxtCompressionMethod, "squish" ) ||
+                              strieq( dxtCompressionMethod, "libsquish" ) ||
+                              strieq( dxtCompressionMethod, "recommended" ) )
+                    {
+                        cfg.c_dxtRuntimeType = rw::DXTRUNTIME_SQUISH;
+                    }
+                }
+
+                // Warning level.
+                if ( mainEntry->Find( "warningLevel" ) )
+                {
+                    cfg.c_warningLevel = mainEntry->GetInt( "warningLevel" );
+                }
+
+                // Ignore secure warnings.
+                if ( mainEntry->Find( "ignoreSecureWarnings" ) )
+                {
+                    cfg.c_ignoreSecureWarnings = mainEntry->GetBool( "ignoreSecureWarnings" );
+                }
+
+                // Reconstruct IMG Archives.
+                if ( mainEntry->Find( "reconstructIMGArchives" ) )
+                {
+                    cfg.c_reconstructIMGArchives = mainEntry->GetBool( "reconstructIMGArchives" );
+                }
+
+                // Fix incompatible rasters.
+                if ( mainEntry->Find( "fixIncompatibleRasters" ) )
+                {
+                    cfg.c_fixIncompatibleRasters = mainEntry->GetBool( "fixIncompatibleRasters" );
+                }
+
+                // DXT packed decompression.
+                if ( mainEntry->Find( "dxtPackedDecompression" ) )
+                {
+                    cfg.c_dxtPackedDecompression = mainEntry->GetBool( "dxtPackedDecompression" );
+                }
+
+                // IMG archive compression
+                if ( mainEntry->Find( "imgArchivesCompressed" ) )
+                {
+                    cfg.c_imgArchivesCompressed = mainEntry->GetBool( "imgArchivesCompressed" );
+                }
+
+                // Serialization compatibility setting.
+                if ( mainEntry->Find( "ignoreSerializationRegions" ) )
+                {
+                    cfg.c_ignoreSerializationRegions = mainEntry->GetBool( "ignoreSerializationRegions" );
+                }
+
+                // Debug output flag.
+                if ( mainEntry->Find( "outputDebug" ) )
+                {
+                    cfg.c_outputDebug = mainEntry->GetBool( "outputDebug" );
+                }
+
+                // Debug image settings.
+                if ( const char *debugImageFormat = mainEntry->Get( "debugImageFormat" ) )
+                {
+                    if ( strieq( debugImageFormat, "tga" ) )
+                    {
+                        cfg.c_debugImageFormat = "TGA";
+                    }
+                    else if ( strieq( debugImageFormat, "png" ) )
+                    {
+                        cfg.c_debugImageFormat = "PNG";
+                    }
+                }
+
+                if ( mainEntry->Find( "debugSampleRate" ) )
+                {
+                    int debugSampleRateInt = mainEntry->GetInt( "debugSampleRate" );
+
+                    if ( debugSampleRateInt >= 1 )
+                    {
+                        cfg.c_debugSampleRate = (rw::uint32)debugSampleRateInt;
+                    }
+                }
+
+                if ( mainEntry->Find( "debugQueueDepth" ) )
                 {
-                    if ( strieq( palRuntimeType, "native" ) )
+                    int debugQueueDepthInt = mainEntry->GetInt( "debugQueueDepth" );
+
+                    if ( debugQueueDepthInt >= 0 )
                     {
-                        cfg.c_palRuntimeType = rw::PALRUNTIME_NATIVE;
+                        cfg.c_debugQueueDepth = (rw::uint32)debugQueueDepthInt;
                     }
-                    else if ( strieq( palRuntimeType, "pngquant" ) )
+                }
+
+                // Amount of parallel conversions.
+                if ( mainEntry->Find( "workerCount" ) )
+                {
+                    int workerCountInt = mainEntry->GetInt( "workerCount" );
+
+                    if ( workerCountInt >= 0 )
                     {
-                        cfg.c_palRuntimeType = rw::PALRUNTIME_PNGQUANT;
+                        cfg.c_workerCount = (rw::uint32)workerCountInt;
                     }
                 }
 
-                // DXT compression method.
-                if ( const char *dxtCompressionMethod = mainEntry->Get( "dxtRuntimeType" ) )
+                // Conversion pipeline limits.
+                if ( mainEntry->Find( "pipelineDepth" ) )
                 {
-                    if ( strieq( dxtCompressionMethod, "native" ) )
+                    int pipelineDepthInt = mainEntry->GetInt( "pipelineDepth" );
+
+                    if ( pipelineDepthInt >= 0 )
                     {
-                        cfg.c_dxtRuntimeType = rw::DXTRUNTIME_NATIVE;
+                        cfg.c_pipelineDepth = (rw::uint32)pipelineDepthInt;
                     }
-                    else if ( strieq( dxtCompressionMethod, "squish" ) ||
-                              strieq( dxtCompressionMethod, "libsquish" ) ||
-                              strieq( dxtCompressionMethod, "recommended" ) )
+                }
+
+                if ( mainEntry->Find( "writeQueueDepth" ) )
+                {
+                    int writeQueueDepthInt = mainEntry->GetInt( "writeQueueDepth" );
+
+                    if ( writeQueueDepthInt >= 0 )
                     {
-                        cfg.c_dxtRuntimeType = rw::DXTRUNTIME_SQUISH;
+                        cfg.c_writeQueueDepth = (rw::uint32)writeQueueDepthInt;
                     }
                 }
 
-                // Warning level.
-                if ( mainEntry->Find( "warningLevel" ) )
+                if ( mainEntry->Find( "pipelineMemoryLimit" ) )
                 {
-                    cfg.c_warningLevel = mainEntry->GetInt( "warningLevel" );
+                    int pipelineMemoryLimitInt = mainEntry->GetInt( "pipelineMemoryLimit" );
+
+                    if ( pipelineMemoryLimitInt >= 0 )
+                    {
+                        cfg.c_pipelineMemoryLimit = (rw::uint32)pipelineMemoryLimitInt;
+                    }
                 }
 
-                // Ignore secure warnings.
-                if ( mainEntry->Find( "ignoreSecureWarnings" ) )
+                if ( mainEntry->Find( "memoryBudget" ) )
                 {
-                    cfg.c_ignoreSecureWarnings = mainEntry->GetBool( "ignoreSecureWarnings" );
+                    int memoryBudgetInt = mainEntry->GetInt( "memoryBudget" );
+
+                    if ( memoryBudgetInt >= 0 )
+                    {
+                        cfg.c_memoryBudget = (rw::uint32)memoryBudgetInt;
+                    }
                 }
 
-                // Reconstruct IMG Archives.
-                if ( mainEntry->Find( "reconstructIMGArchives" ) )
+                // Incremental builds.
+                if ( mainEntry->Find( "incrementalBuild" ) )
                 {
-                    cfg.c_reconstructIMGArchives = mainEntry->GetBool( "reconstructIMGArchives" );
+                    cfg.c_incrementalBuild = mainEntry->GetBool( "incrementalBuild" );
                 }
 
-                // Fix incompatible rasters.
-                if ( mainEntry->Find( "fixIncompatibleRasters" ) )
+                // Processing of the textures of one TXD on multiple threads.
+                if ( mainEntry->Find( "parallelTextures" ) )
                 {
-                    cfg.c_fixIncompatibleRasters = mainEntry->GetBool( "fixIncompatibleRasters" );
+                    cfg.c_parallelTextures = mainEntry->GetBool( "parallelTextures" );
                 }
 
-                // DXT packed decompression.
-                if ( mainEntry->Find( "dxtPackedDecompression" ) )
+                // Leave textures alone that are in the target format already.
+                if ( mainEntry->Find( "skipUnchangedTextures" ) )
                 {
-                    cfg.c_dxtPackedDecompression = mainEntry->GetBool( "dxtPackedDecompression" );
+                    cfg.c_skipUnchangedTextures = mainEntry->GetBool( "skipUnchangedTextures" );
                 }
 
-                // IMG archive compression
-                if ( mainEntry->Find( "imgArchivesCompressed" ) )
+                // Start with the most expensive files.
+                if ( mainEntry->Find( "largestFirst" ) )
                 {
-                    cfg.c_imgArchivesCompressed = mainEntry->GetBool( "imgArchivesCompressed" );
+                    cfg.c_largestFirst = mainEntry->GetBool( "largestFirst" );
                 }
 
-                // Serialization compatibility setting.
-                if ( mainEntry->Find( "ignoreSerializationRegions" ) )
+                // Index of the game root files.
+                if ( mainEntry->Find( "useScanIndex" ) )
                 {
-                    cfg.c_ignoreSerializationRegions = mainEntry->GetBool( "ignoreSerializationRegions" );
+                    cfg.c_useScanIndex = mainEntry->GetBool( "useScanIndex" );
                 }
 
-                // Debug output flag.
-                if ( mainEntry->Find( "outputDebug" ) )
+                // Performance trace of the run.
+                if ( mainEntry->Find( "writeTrace" ) )
                 {
-                    cfg.c_outputDebug = mainEntry->GetBool( "outputDebug" );
+                    cfg.c_writeTrace = mainEntry->GetBool( "writeTrace" );
                 }
             }
 
@@ -672,6 +1709,62 @@ TxdGenModule::run_config TxdGenModule::ParseConfig( CFileTranslator *root, const
     return cfg;
 }
 
+// Hash of all settings that have an effect on the generated files.
+static rw::uint64 calculateConfigHash( rw::Interface *rwEngine, const TxdGenModule::run_config& cfg, const rw::LibraryVersion& targetVersion )
+{
+    manifestHasher hasher;
+
+    // Increment this if the output of txdgen changes.
+    const rw::uint32 txdgenOutputRevision = 2;
+
+    hasher.FeedValue( txdgenOutputRevision );
+    hasher.FeedValue( targetVersion.rwLibMajor );
+    hasher.FeedValue( targetVersion.rwLibMinor );
+    hasher.FeedValue( targetVersion.rwRevMajor );
+    hasher.FeedValue( targetVersion.rwRevMinor );
+    hasher.FeedValue( cfg.c_gameType );
+    hasher.FeedValue( cfg.c_targetPlatform );
+    hasher.FeedValue( cfg.c_clearMipmaps );
+    hasher.FeedValue( cfg.c_generateMipmaps );
+    hasher.FeedValue( cfg.c_mipGenMode );
+    hasher.FeedValue( cfg.c_mipGenMaxLevel );
+    hasher.FeedValue( cfg.c_improveFiltering );
+    hasher.FeedValue( cfg.c_skipUnchangedTextures );
+    hasher.FeedValue( cfg.compressTextures );
+    hasher.FeedValue( cfg.c_compressionQuality );
+    hasher.FeedValue( cfg.c_palRuntimeType );
+    hasher.FeedValue( cfg.c_dxtRuntimeType );
+    hasher.FeedValue( cfg.c_reconstructIMGArchives );
+    hasher.FeedValue( cfg.c_imgArchivesCompressed );
+    hasher.FeedValue( cfg.c_outputDebug );
+
+    // We inherit these from Magic.TXD.
+    bool fixIncompatibleRasters = rwEngine->GetFixIncompatibleRasters();
+    bool dxtPackedDecompression = rwEngine->GetDXTPackedDecompression();
+    bool ignoreSerializationRegions = rwEngine->GetIgnoreSerializationBlockRegions();
+    bool metaDataTagging = rwEngine->GetMetaDataTagging();
+    bool compatTransformNativeImaging = rwEngine->GetCompatTransformNativeImaging();
+    bool preferPackedSampleExport = rwEngine->GetPreferPackedSampleExport();
+
+    hasher.FeedValue( fixIncompatibleRasters );
+    hasher.FeedValue( dxtPackedDecompression );
+    hasher.FeedValue( ignoreSerializationRegions );
+    hasher.FeedValue( metaDataTagging );
+    hasher.FeedValue( compatTransformNativeImaging );
+    hasher.FeedValue( preferPackedSampleExport );
+
+    return hasher.GetHash();
+}
+
+static void txdgenWorkerInit( rw::Interface *rwEngine, void *ud )
+{
+    const TxdGenModule::run_config& cfg = *(const TxdGenModule::run_config*)ud;
+
+    // Workers start with the global configuration, so apply our settings again.
+    rwEngine->SetPaletteRuntime( cfg.c_palRuntimeType );
+    rwEngine->SetDXTRuntime( cfg.c_dxtRuntimeType );
+}
+
 bool TxdGenModule::ApplicationMain( const run_config& cfg )
 {
     this->OnMessage(
@@ -892,6 +1985,78 @@ bool TxdGenModule::ApplicationMain( const run_config& cfg )
             rw::rwStaticString <char> ( "* ignoreSerializationRegions: " ) + ( rwEngine->GetIgnoreSerializationBlockRegions() ? "true" : "false" ) + "\n"
         );
 
+        rw::uint32 workerCount = cfg.c_workerCount;
+
+        if ( workerCount == 0 )
+        {
+            workerCount = ToolWorkerPool::GetDefaultWorkerCount();
+        }
+
+        this->OnMessage(
+            "* workerCount: " + eir::to_string <char, rw::RwStaticMemAllocator> ( workerCount ) + "\n"
+        );
+
+        this->OnMessage(
+            "* pipelineDepth: " + eir::to_string <char, rw::RwStaticMemAllocator> ( cfg.c_pipelineDepth ) + "\n" \
+            "* writeQueueDepth: " + eir::to_string <char, rw::RwStaticMemAllocator> ( cfg.c_writeQueueDepth ) + "\n" \
+            "* pipelineMemoryLimit: " + eir::to_string <char, rw::RwStaticMemAllocator> ( cfg.c_pipelineMemoryLimit ) + "MB\n" \
+            "* memoryBudget: " + eir::to_string <char, rw::RwStaticMemAllocator> ( cfg.c_memoryBudget ) + "MB\n"
+        );
+
+        this->OnMessage(
+            rw::rwStaticString <char> ( "* incrementalBuild: " ) + ( cfg.c_incrementalBuild ? "true" : "false" ) + "\n"
+        );
+
+        this->OnMessage(
+            rw::rwStaticString <char> ( "* parallelTextures: " ) + ( cfg.c_parallelTextures ? "true" : "false" ) + "\n"
+        );
+
+        this->OnMessage(
+            rw::rwStaticString <char> ( "* skipUnchangedTextures: " ) + ( cfg.c_skipUnchangedTextures ? "true" : "false" ) + "\n"
+        );
+
+        this->OnMessage(
+            rw::rwStaticString <char> ( "* largestFirst: " ) + ( cfg.c_largestFirst ? "true" : "false" ) + "\n"
+        );
+
+        this->OnMessage(
+            rw::rwStaticString <char> ( "* useScanIndex: " ) + ( cfg.c_useScanIndex ? "true" : "false" ) + "\n"
+        );
+
+        this->OnMessage(
+            rw::rwStaticString <char> ( "* writeTrace: " ) + ( cfg.c_writeTrace ? "true" : "false" ) + "\n"
+        );
+
+        // The PNG encoder is optional.
+        const char *debugImageFormat = "TGA";
+
+        if ( cfg.c_outputDebug )
+        {
+            if ( strcmp( cfg.c_debugImageFormat.GetConstString(), "PNG" ) == 0 )
+            {
+                if ( rw::IsImagingFormatAvailable( rwEngine, "PNG" ) )
+                {
+                    debugImageFormat = "PNG";
+                }
+                else
+                {
+                    this->OnMessage( "PNG is not available for debug images; using TGA instead\n" );
+                }
+            }
+
+            this->OnMessage(
+                rw::rwStaticString <char> ( "* debugImageFormat: " ) + debugImageFormat + "\n"
+            );
+
+            this->OnMessage(
+                "* debugSampleRate: " + eir::to_string <char, rw::RwStaticMemAllocator> ( cfg.c_debugSampleRate ) + "\n"
+            );
+
+            this->OnMessage(
+                "* debugQueueDepth: " + eir::to_string <char, rw::RwStaticMemAllocator> ( cfg.c_debugQueueDepth ) + "\n"
+            );
+        }
+
         // Finish with a newline.
         this->OnMessage( "\n" );
 
@@ -915,6 +2080,27 @@ bool TxdGenModule::ApplicationMain( const run_config& cfg )
 
             if ( hasGameRoot && hasOutputRoot )
             {
+                ToolWorkerPool *workerPool = nullptr;
+                ToolJobPool *texturePool = nullptr;
+                ToolBackgroundWriter *debugWriter = nullptr;
+
+                BuildManifest *manifest = nullptr;
+                ToolScanIndex *scanIndex = nullptr;
+
+                ToolRunSession runSession( this, cfg.c_memoryBudget, cfg.c_writeTrace, absOutputRootTranslator, txdgenTraceFileName );
+
+                // The conversion tasks point to these, so they have to outlive the pools below.
+                TxdGenModule::DebugImageOutput debugOutput;
+                debugOutput.root = absDebugOutputTranslator;
+                debugOutput.imageFormat = debugImageFormat;
+                debugOutput.sampleRate = cfg.c_debugSampleRate;
+                debugOutput.writer = nullptr;
+
+                _discFileSentry_txdgen sentry;
+                sentry.module = this;
+                sentry.workerPool = nullptr;
+                sentry.texturePool = nullptr;
+
                 try
                 {
                     // Check for build root conflicts.
@@ -923,6 +2109,49 @@ bool TxdGenModule::ApplicationMain( const run_config& cfg )
                         this->OnMessage( "build root conflict detected; might not process all files\n\n" );
                     }
 
+                    // Loose TXDs are converted by a pipeline, so that reading, converting and
+                    // writing of consecutive files can overlap.
+                    // With a single worker the files are converted one after the other on this thread.
+                    if ( workerCount > 1 )
+                    {
+                        workerPool = new ToolWorkerPool( rwEngine, workerCount, txdgenWorkerInit, (void*)&cfg, true );
+
+                        workerPool->SetQueueDepths( cfg.c_pipelineDepth, cfg.c_writeQueueDepth );
+                    }
+
+                    // A single huge TXD would otherwise be converted by one thread only.
+                    if ( cfg.c_parallelTextures && workerCount > 1 )
+                    {
+                        texturePool = new ToolJobPool( rwEngine, workerCount, txdgenWorkerInit, (void*)&cfg );
+                    }
+
+                    // Debug images are rendered and written off the conversion threads.
+                    // With a queue depth of zero they are written right away.
+                    if ( hasDebugRoot && cfg.c_debugQueueDepth > 0 )
+                    {
+                        debugWriter = new ToolBackgroundWriter( rwEngine, cfg.c_debugQueueDepth, txdgenWorkerInit, (void*)&cfg );
+
+                        debugOutput.writer = debugWriter;
+                    }
+
+                    if ( cfg.c_incrementalBuild )
+                    {
+                        manifest = new BuildManifest( calculateConfigHash( rwEngine, cfg, targetVersion ) );
+
+                        manifest->Load( absOutputRootTranslator, txdgenManifestFileName );
+
+                        // The manifest is only written back after a complete run.
+                        // An interrupted run could have left behind incomplete files.
+                        absOutputRootTranslator->Delete( txdgenManifestFileName );
+                    }
+
+                    if ( cfg.c_useScanIndex )
+                    {
+                        scanIndex = new ToolScanIndex();
+
+                        scanIndex->Load( absOutputRootTranslator, txdgenScanIndexFileName );
+                    }
+
                     // File roots are prepared.
                     // We can start processing files.
                     gtaFileProcessor <_discFileSentry_txdgen> fileProc( this );
@@ -931,8 +2160,13 @@ bool TxdGenModule::ApplicationMain( const run_config& cfg )
 
                     fileProc.setUseCompressedIMGArchives( cfg.c_imgArchivesCompressed );
 
-                    _discFileSentry_txdgen sentry;
-                    sentry.module = this;
+                    fileProc.setManifest( manifest );
+
+                    // The order only matters if files are converted at the same time.
+                    fileProc.setLargestFirst( cfg.c_largestFirst && workerCount > 1 );
+
+                    fileProc.setScanIndex( scanIndex );
+
                     sentry.targetPlatform = cfg.c_targetPlatform;
                     sentry.targetGame = cfg.c_gameType;
                     sentry.clearMipmaps = cfg.c_clearMipmaps;
@@ -943,11 +2177,47 @@ bool TxdGenModule::ApplicationMain( const run_config& cfg )
                     sentry.doCompress = cfg.compressTextures;
                     sentry.compressionQuality = cfg.c_compressionQuality;
                     sentry.gameVersion = targetVersion;
-                    sentry.outputDebug = cfg.c_outputDebug;
-                    sentry.debugTranslator = absDebugOutputTranslator;
+                    sentry.skipUnchangedTextures = cfg.c_skipUnchangedTextures;
+                    sentry.debugOutput = ( hasDebugRoot ? &debugOutput : nullptr );
+                    sentry.workerPool = workerPool;
+                    sentry.texturePool = texturePool;
+                    sentry.maxPipelineMemory = ( (size_t)cfg.c_pipelineMemoryLimit * 1024 * 1024 );
+                    sentry.pipelineMemoryUsage = 0;
 
                     fileProc.process( &sentry, absGameRootTranslator, absOutputRootTranslator );
 
+                    // Wait for the remaining conversions.
+                    if ( workerPool )
+                    {
+                        workerPool->Flush();
+                    }
+
+                    if ( debugWriter )
+                    {
+                        debugWriter->Flush();
+                    }
+
+                    if ( manifest )
+                    {
+                        if ( !manifest->Save( absOutputRootTranslator, txdgenManifestFileName ) )
+                        {
+                            this->OnMessage( "failed to write the build manifest\n" );
+                        }
+                    }
+
+                    if ( scanIndex )
+                    {
+                        this->OnMessage(
+                            "scan index: " + eir::to_string <char, rw::RwStaticMemAllocator> ( scanIndex->GetReusedDirectoryCount() ) + " directories unchanged, " +
+                            eir::to_string <char, rw::RwStaticMemAllocator> ( scanIndex->GetScannedDirectoryCount() ) + " scanned\n"
+                        );
+
+                        if ( !scanIndex->Save( absOutputRootTranslator, txdgenScanIndexFileName ) )
+                        {
+                            this->OnMessage( "failed to write the scan index\n" );
+                        }
+                    }
+
                     // Output any warnings.
                     _warningMan.Purge();
                 }
@@ -960,6 +2230,34 @@ bool TxdGenModule::ApplicationMain( const run_config& cfg )
 
                     successful = false;
                 }
+
+                // The conversion tasks may still wait for texture jobs, so they have to go first.
+                if ( workerPool )
+                {
+                    delete workerPool;
+                }
+
+                if ( texturePool )
+                {
+                    delete texturePool;
+                }
+
+                if ( debugWriter )
+                {
+                    delete debugWriter;
+                }
+
+                if ( manifest )
+                {
+                    delete manifest;
+                }
+
+                if ( scanIndex )
+                {
+                    delete scanIndex;
+                }
+
+                runSession.End();
             }
             else
             {
@@ -998,3 +2296,209 @@ bool TxdGenModule::ApplicationMain( const run_config& cfg )
 
     return successful;
 }
+
+// Throughput assumptions of the dry run, per worker thread.
+static const double dryRunDecodePixelsPerSecond = 60.0e6;
+static const double dryRunEncodePixelsPerSecond = 60.0e6;
+static const double dryRunCompressPixelsPerSecond = 6.0e6;
+static const double dryRunPalettizePixelsPerSecond = 4.0e6;
+static const double dryRunMipmapPixelsPerSecond = 40.0e6;
+static const double dryRunCopyBytesPerSecond = 100.0e6;
+
+static rw::uint32 getTargetNativePlatformId( const TxdGenModule::run_config& cfg )
+{
+    if ( cfg.c_targetPlatform == PLATFORM_PC )
+    {
+        return ( cfg.c_gameType == GAME_GTASA ? rwplatformD3D9 : rwplatformD3D8 );
+    }
+    else if ( cfg.c_targetPlatform == PLATFORM_XBOX )
+    {
+        return rwplatformXBOX;
+    }
+    else if ( cfg.c_targetPlatform == PLATFORM_PS2 )
+    {
+        return rwplatformPS2;
+    }
+
+    return 0;
+}
+
+struct _txdgenDryRunTotals
+{
+    rw::uint64 fileCount = 0;
+    rw::uint64 txdCount = 0;
+    rw::uint64 textureCount = 0;
+    rw::uint64 untouchedTextureCount = 0;
+    rw::uint64 pixelCount = 0;
+    rw::uint64 inputSize = 0;
+    double outputSize = 0;
+    double workSeconds = 0;
+    double copySeconds = 0;
+};
+
+// Predicts what the conversion would do with a texture, using its header only.
+static void estimateTextureConversion( const TxdGenModule::run_config& cfg, rw::uint32 targetPlatformId, const txdTextureHeaderInfo& info, _txdgenDryRunTotals& totals )
+{
+    // Same rules as for loaded textures, but only for formats whose header we understand.
+    _txdgenTextureState state;
+    state.isNativeOnTarget = ( info.hasDimensions && info.platformId == targetPlatformId );
+    state.width = info.width;
+    state.height = info.height;
+    state.mipCount = info.mipmapCount;
+    state.filterMode = info.filterMode;
+    state.isCompressed = info.isCompressed;
+
+    bool isOnTarget =
+        cfg.c_skipUnchangedTextures && !cfg.c_outputDebug &&
+        isTextureStateOnTarget(
+            cfg.c_targetPlatform,
+            cfg.c_clearMipmaps, cfg.c_generateMipmaps, cfg.c_mipGenMaxLevel,
+            cfg.compressTextures, cfg.c_improveFiltering,
+            state
+        );
+
+    totals.textureCount++;
+
+    if ( isOnTarget )
+    {
+        totals.untouchedTextureCount++;
+        totals.outputSize += (double)info.dataSize;
+        return;
+    }
+
+    double pixelCount = (double)info.GetPixelCount();
+
+    // Pixels of the result, depending on the mipmap settings.
+    double basePixelCount = ( info.hasDimensions ? (double)info.width * info.height : pixelCount );
+    double outPixelCount = pixelCount;
+
+    if ( cfg.c_clearMipmaps )
+    {
+        outPixelCount = basePixelCount;
+    }
+
+    double workSeconds = ( pixelCount / dryRunDecodePixelsPerSecond );
+
+    if ( cfg.c_generateMipmaps && outPixelCount < basePixelCount * 1.3 )
+    {
+        outPixelCount = basePixelCount * 4.0 / 3.0;
+
+        workSeconds += ( outPixelCount / dryRunMipmapPixelsPerSecond );
+    }
+
+    double outputSize;
+
+    if ( cfg.compressTextures && ( cfg.c_targetPlatform == PLATFORM_PC || cfg.c_targetPlatform == PLATFORM_XBOX ) && !info.isCompressed )
+    {
+        // DXT1 has half a byte per pixel, DXT5 a full byte.
+        outputSize = outPixelCount * ( info.hasAlpha ? 1.0 : 0.5 );
+
+        workSeconds += ( outPixelCount / dryRunCompressPixelsPerSecond );
+    }
+    else if ( cfg.compressTextures && cfg.c_targetPlatform == PLATFORM_PS2 )
+    {
+        outputSize = outPixelCount;
+
+        workSeconds += ( outPixelCount / dryRunPalettizePixelsPerSecond );
+    }
+    else
+    {
+        // The format stays about the same.
+        outputSize = (double)info.dataSize * ( pixelCount > 0 ? outPixelCount / pixelCount : 1.0 );
+
+        workSeconds += ( outPixelCount / dryRunEncodePixelsPerSecond );
+    }
+
+    totals.pixelCount += (rw::uint64)pixelCount;
+    totals.outputSize += outputSize;
+    totals.workSeconds += workSeconds;
+}
+
+static rw::rwStaticString <char> formatByteSize( double byteSize )
+{
+    return eir::to_string <char, rw::RwStaticMemAllocator> ( (rw::uint64)( byteSize / ( 1024 * 1024 ) ) ) + "MB";
+}
+
+bool TxdGenModule::DryRun( const run_config& cfg )
+{
+    this->OnMessage( "estimating the conversion; no files are written\n\n" );
+
+    CFileTranslator *absGameRootTranslator = nullptr;
+
+    bool hasGameRoot = obtainAbsolutePath( cfg.c_gameRoot.GetConstString(), absGameRootTranslator, false, true );
+
+    if ( !hasGameRoot )
+    {
+        this->OnMessage( "could not get a filesystem handle to the game root\n" );
+
+        return false;
+    }
+
+    _txdgenDryRunTotals totals;
+
+    try
+    {
+        rw::uint32 targetPlatformId = getTargetNativePlatformId( cfg );
+
+        auto per_file_cb = [&]( const filePath& discFilePathAbs )
+        {
+            toolFileEstimate estimate;
+
+            EstimateGameFile( absGameRootTranslator, discFilePathAbs, cfg.c_imgArchivesCompressed, estimate );
+
+            totals.fileCount++;
+            totals.txdCount += estimate.txdCount;
+            totals.inputSize += estimate.fileSize;
+
+            if ( estimate.txdCount == 0 )
+            {
+                // Other files are just copied.
+                totals.outputSize += (double)estimate.fileSize;
+            }
+
+            for ( const txdTextureHeaderInfo& info : estimate.textures )
+            {
+                estimateTextureConversion( cfg, targetPlatformId, info, totals );
+            }
+
+            // Allow termination per file.
+            rw::CheckThreadHazards( this->rwEngine );
+        };
+
+        absGameRootTranslator->ScanDirectory( "//", "*", true, nullptr, std::move( per_file_cb ), nullptr );
+    }
+    catch( ... )
+    {
+        delete absGameRootTranslator;
+
+        throw;
+    }
+
+    delete absGameRootTranslator;
+
+    rw::uint32 workerCount = cfg.c_workerCount;
+
+    if ( workerCount == 0 )
+    {
+        workerCount = ToolWorkerPool::GetDefaultWorkerCount();
+    }
+
+    totals.copySeconds = ( (double)totals.inputSize + totals.outputSize ) / dryRunCopyBytesPerSecond;
+
+    // Disk access does not become faster with more threads.
+    double totalSeconds = std::max( totals.workSeconds / std::max( workerCount, 1u ), totals.copySeconds );
+
+    this->OnMessage(
+        "* files: " + eir::to_string <char, rw::RwStaticMemAllocator> ( totals.fileCount ) + "\n" \
+        "* TXDs: " + eir::to_string <char, rw::RwStaticMemAllocator> ( totals.txdCount ) + "\n" \
+        "* textures: " + eir::to_string <char, rw::RwStaticMemAllocator> ( totals.textureCount ) +
+            " (" + eir::to_string <char, rw::RwStaticMemAllocator> ( totals.untouchedTextureCount ) + " already in the target format)\n" \
+        "* megapixels to process: " + eir::to_string <char, rw::RwStaticMemAllocator> ( totals.pixelCount / 1000000 ) + "\n" \
+        "* input size: " + formatByteSize( (double)totals.inputSize ) + "\n" \
+        "* expected output size: " + formatByteSize( totals.outputSize ) + "\n" \
+        "* expected runtime: " + eir::to_string <char, rw::RwStaticMemAllocator> ( (rw::uint64)totalSeconds + 1 ) + " seconds on " +
+            eir::to_string <char, rw::RwStaticMemAllocator> ( workerCount ) + " workers\n"
+    );
+
+    return true;
+}
@@ -3,6 +3,9 @@
 
 #include "shared.h"
 
+struct ToolJobPool;
+struct ToolBackgroundWriter;
+
 class TxdGenModule : public MessageReceiver
 {
 public:
@@ -32,6 +35,10 @@ public:
 
         bool c_improveFiltering = true;
 
+        // Textures that are in the target format already are not encoded again.
+        // TXDs that would not change at all are copied as they are.
+        bool c_skipUnchangedTextures = true;
+
         bool compressTextures = false;
 
         rw::ePaletteRuntimeType c_palRuntimeType = rw::PALRUNTIME_PNGQUANT;
@@ -51,23 +58,99 @@ public:
 
         bool c_outputDebug = false;
 
+        // Debug images are written as "TGA" or "PNG", for every Nth texture only.
+        rw::rwStaticString <char> c_debugImageFormat = "TGA";
+        rw::uint32 c_debugSampleRate = 1;
+
+        // Amount of debug images that may wait for the writer thread.
+        rw::uint32 c_debugQueueDepth = 16;
+
         int c_warningLevel = 3;
 
         bool c_ignoreSecureWarnings = false;
+
+        // Amount of TXDs that are converted at the same time.
+        // Zero means one per hardware thread.
+        rw::uint32 c_workerCount = 0;
+
+        // Conversion pipeline limits.
+        // The depths are counted in TXDs; zero picks a default based on the worker count.
+        rw::uint32 c_pipelineDepth = 0;
+        rw::uint32 c_writeQueueDepth = 0;
+
+        // Upper limit of source data in megabytes that the pipeline keeps in memory.
+        rw::uint32 c_pipelineMemoryLimit = 256;
+
+        // Upper limit of decoded texture data in megabytes, shared with the other mass tools.
+        // Zero means no limit.
+        rw::uint32 c_memoryBudget = 4096;
+
+        // Skip files that did not change since the last run into the same output root.
+        bool c_incrementalBuild = true;
+
+        // Spread the textures of a TXD across threads, too.
+        bool c_parallelTextures = true;
+
+        // Estimate the cost of all files first and convert the most expensive ones first,
+        // so that no big file is left over at the end of the run.
+        bool c_largestFirst = true;
+
+        // Remember the directory listing of the game root in the output root, so that the
+        // next run only has to list the directories that have changed.
+        // Files are still opened and converted as usual.
+        bool c_useScanIndex = false;
+
+        // Write a Chrome trace of the run into the output root.
+        bool c_writeTrace = false;
+    };
+
+    struct RwWarningBuffer;
+
+    // Where and how the debug images of converted textures are written.
+    struct DebugImageOutput
+    {
+        CFileTranslator *root;
+        const char *imageFormat;
+        rw::uint32 sampleRate;
+        ToolBackgroundWriter *writer;   // if null, the images are written by the converting thread
     };
 
     run_config ParseConfig( CFileTranslator *root, const filePath& cfgPath ) const;
 
     bool ApplicationMain( const run_config& cfg );
 
+    // Estimates the runtime and the output size of a conversion without writing anything.
+    bool DryRun( const run_config& cfg );
+
+    // The conversion of a TXD is split into stages so that they can run on different threads.
+    rw::TexDictionary* ReadTXDArchive( CFile *srcStream, rw::rwStaticString <char>& errMsg ) const;
+
+    bool TransformTXDArchive(
+        rw::TexDictionary *txd, CFileTranslator *srcRoot, const filePath& srcPathAbs,
+        rwkind::eTargetPlatform targetPlatform, rwkind::eTargetGame targetGame,
+        bool clearMipmaps,
+        bool generateMipmaps, rw::eMipmapGenerationMode mipGenMode, rw::uint32 mipGenMaxLevel,
+        bool improveFiltering,
+        bool doCompress, float compressionQuality,
+        const DebugImageOutput *debugOutput,
+        const rw::LibraryVersion& gameVersion,
+        bool skipUnchangedTextures, bool& isUnchangedOut,
+        ToolJobPool *texturePool, RwWarningBuffer *warningsOut,
+        rw::rwStaticString <char>& errMsg
+    ) const;
+
+    bool WriteTXDArchive( rw::TexDictionary *txd, CFile *targetStream, rw::uint64 expectedSize, rw::rwStaticString <char>& errMsg ) const;
+
     bool ProcessTXDArchive(
         CFileTranslator *srcRoot, CFile *srcStream, CFile *targetStream, rwkind::eTargetPlatform targetPlatform, rwkind::eTargetGame targetGame,
         bool clearMipmaps,
         bool generateMipmaps, rw::eMipmapGenerationMode mipGenMode, rw::uint32 mipGenMaxLevel,
         bool improveFiltering,
         bool doCompress, float compressionQuality,
-        bool outputDebug, CFileTranslator *debugRoot,
+        const DebugImageOutput *debugOutput,
         const rw::LibraryVersion& gameVersion,
+        bool skipUnchangedTextures,
+        ToolJobPool *texturePool, RwWarningBuffer *warningsOut,
         rw::rwStaticString <char>& errMsg
     ) const;
 
@@ -0,0 +1,767 @@
+#include "mainwindow.h"
+
+#include "workerpool.h"
+
+#include <thread>
+
+ToolThreadGroup::ToolThreadGroup( rw::Interface *rwEngine, workerInit_t initCB, void *ud )
+{
+    NativeExecutive::CExecutiveManager *nativeExec = (NativeExecutive::CExecutiveManager*)rw::GetThreadingNativeManager( rwEngine );
+
+    this->rwEngine = rwEngine;
+    this->nativeExec = nativeExec;
+    this->initCB = initCB;
+    this->initUD = ud;
+    this->isTerminating = false;
+
+    this->lockQueue = nativeExec->CreateReadWriteLock();
+}
+
+ToolThreadGroup::~ToolThreadGroup( void )
+{
+    this->nativeExec->CloseReadWriteLock( this->lockQueue );
+}
+
+void ToolThreadGroup::SpawnThread( unsigned int role )
+{
+    rw::Interface *rwEngine = this->rwEngine;
+
+    this->threads.emplace_back();
+
+    threadSlot& slot = this->threads.back();
+    slot.group = this;
+    slot.role = role;
+    slot.handle = rw::MakeThread( rwEngine, _threadEntry, &slot );
+
+    if ( slot.handle == nullptr )
+    {
+        this->threads.pop_back();
+
+        throw rw::RwException( "failed to create worker thread" );
+    }
+
+    rw::ResumeThread( rwEngine, slot.handle );
+}
+
+void ToolThreadGroup::TerminateThreads( void )
+{
+    rw::Interface *rwEngine = this->rwEngine;
+
+    // Tell the threads to quit.
+    {
+        NativeExecutive::CReadWriteWriteContext <> ctxTerminate( this->lockQueue );
+
+        this->isTerminating = true;
+
+        this->OnTerminate();
+    }
+
+    // Wait for all of them.
+    // If a thread is still busy with work it is interrupted at the next hazard check.
+    for ( threadSlot& slot : this->threads )
+    {
+        rw::TerminateThread( rwEngine, slot.handle );
+
+        rw::CloseThread( rwEngine, slot.handle );
+    }
+
+    this->threads.clear();
+}
+
+void ToolThreadGroup::_threadEntry( rw::thread_t threadHandle, rw::Interface *rwEngine, void *ud )
+{
+    threadSlot *slot = (threadSlot*)ud;
+
+    ToolThreadGroup *group = slot->group;
+    unsigned int role = slot->role;
+
+    // Every thread needs its own RenderWare configuration, for example its own warning manager.
+    rw::AssignThreadedRuntimeConfig( rwEngine );
+
+    try
+    {
+        if ( workerInit_t initCB = group->initCB )
+        {
+            initCB( rwEngine, group->initUD );
+        }
+
+        group->RunThread( rwEngine, role );
+    }
+    catch( ... )
+    {
+        // We were asked to terminate; quit normally.
+    }
+
+    group->OnThreadQuit( role );
+
+    rw::ReleaseThreadedRuntimeConfig( rwEngine );
+}
+
+ToolWorkerPool::ToolWorkerPool( rw::Interface *rwEngine, unsigned int workerCount, workerInit_t initCB, void *ud, bool hasWriter )
+    : ToolThreadGroup( rwEngine, initCB, ud )
+{
+    NativeExecutive::CExecutiveManager *nativeExec = this->nativeExec;
+
+    if ( workerCount == 0 )
+    {
+        workerCount = 1;
+    }
+
+    this->numPendingWrites = 0;
+    this->workerCount = workerCount;
+    this->hasWriter = hasWriter;
+
+    this->SetQueueDepths( 0, 0 );
+
+    this->condHasTasks = nativeExec->CreateConditionVariable();
+    this->condTaskExecuted = nativeExec->CreateConditionVariable();
+    this->condTaskFinished = nativeExec->CreateConditionVariable();
+
+    try
+    {
+        for ( unsigned int n = 0; n < workerCount; n++ )
+        {
+            this->SpawnThread( THREAD_WORKER );
+        }
+
+        if ( hasWriter )
+        {
+            this->SpawnThread( THREAD_WRITER );
+        }
+    }
+    catch( ... )
+    {
+        this->Shutdown();
+
+        throw;
+    }
+}
+
+ToolWorkerPool::~ToolWorkerPool( void )
+{
+    this->Shutdown();
+}
+
+void ToolWorkerPool::OnTerminate( void )
+{
+    this->condHasTasks->Signal();
+    this->condTaskExecuted->Signal();
+}
+
+void ToolWorkerPool::Shutdown( void )
+{
+    this->TerminateThreads();
+
+    // Any task that was not committed is thrown away.
+    for ( ToolWorkerTask *task : this->inflightTasks )
+    {
+        delete task;
+    }
+
+    this->inflightTasks.clear();
+    this->pendingTasks.clear();
+    this->writeTasks.clear();
+
+    NativeExecutive::CExecutiveManager *nativeExec = this->nativeExec;
+
+    nativeExec->CloseConditionVariable( this->condTaskFinished );
+    nativeExec->CloseConditionVariable( this->condTaskExecuted );
+    nativeExec->CloseConditionVariable( this->condHasTasks );
+}
+
+void ToolWorkerPool::SetQueueDepths( size_t maxInflightTasks, size_t maxPendingWrites )
+{
+    size_t workerCount = this->workerCount;
+
+    // Keep enough tasks around so that no worker has to idle while the submitting thread
+    // is busy, but do not open too many files at once.
+    if ( maxInflightTasks == 0 )
+    {
+        maxInflightTasks = ( workerCount * 2 );
+    }
+
+    if ( maxPendingWrites == 0 )
+    {
+        maxPendingWrites = workerCount;
+    }
+
+    this->maxInflightTasks = maxInflightTasks;
+    this->maxPendingWrites = maxPendingWrites;
+}
+
+void ToolWorkerPool::RunThread( rw::Interface *rwEngine, unsigned int role )
+{
+    if ( role == THREAD_WRITER )
+    {
+        this->RunWriter( rwEngine );
+    }
+    else
+    {
+        this->RunWorker( rwEngine );
+    }
+}
+
+void ToolWorkerPool::RunWorker( rw::Interface *rwEngine )
+{
+    bool hasWriter = this->hasWriter;
+
+    while ( true )
+    {
+        ToolWorkerTask *task = nullptr;
+        {
+            NativeExecutive::CReadWriteWriteContextSafe <> ctxFetchTask( this->lockQueue );
+
+            // Do not run ahead of the writer too far, because executed tasks hold on to their memory.
+            while ( this->isTerminating == false &&
+                    ( this->pendingTasks.empty() || ( hasWriter && this->numPendingWrites >= this->maxPendingWrites ) ) )
+            {
+                this->condHasTasks->Wait( ctxFetchTask );
+            }
+
+            if ( this->isTerminating )
+            {
+                break;
+            }
+
+            task = this->pendingTasks.front();
+
+            this->pendingTasks.pop_front();
+        }
+
+        try
+        {
+            task->Execute( rwEngine );
+        }
+        catch( ... )
+        {
+            // The error is reported to the submitting thread.
+            task->error = std::current_exception();
+        }
+
+        {
+            NativeExecutive::CReadWriteWriteContext <> ctxFinishTask( this->lockQueue );
+
+            task->isExecuted = true;
+
+            if ( hasWriter )
+            {
+                this->numPendingWrites++;
+
+                this->condTaskExecuted->Signal();
+            }
+            else
+            {
+                task->isFinished = true;
+
+                this->condTaskFinished->Signal();
+            }
+        }
+    }
+}
+
+void ToolWorkerPool::RunWriter( rw::Interface *rwEngine )
+{
+    while ( true )
+    {
+        ToolWorkerTask *task = nullptr;
+        {
+            NativeExecutive::CReadWriteWriteContextSafe <> ctxFetchTask( this->lockQueue );
+
+            // We write the tasks in submission order.
+            while ( this->isTerminating == false &&
+                    ( this->writeTasks.empty() || this->writeTasks.front()->isExecuted == false ) )
+            {
+                this->condTaskExecuted->Wait( ctxFetchTask );
+            }
+
+            if ( this->isTerminating )
+            {
+                break;
+            }
+
+            task = this->writeTasks.front();
+
+            this->writeTasks.pop_front();
+        }
+
+        // Failed tasks are not written.
+        if ( !task->error )
+        {
+            try
+            {
+                task->Write( rwEngine );
+            }
+            catch( ... )
+            {
+                task->error = std::current_exception();
+            }
+        }
+
+        {
+            NativeExecutive::CReadWriteWriteContext <> ctxFinishTask( this->lockQueue );
+
+            task->isFinished = true;
+
+            this->numPendingWrites--;
+
+            this->condTaskFinished->Signal();
+
+            // A worker might wait for us.
+            this->condHasTasks->Signal();
+        }
+    }
+}
+
+void ToolWorkerPool::SubmitTask( ToolWorkerTask *task )
+{
+    try
+    {
+        // Make sure we do not queue up too much work.
+        while ( this->inflightTasks.size() >= this->maxInflightTasks )
+        {
+            this->CommitOldestTask();
+        }
+
+        this->inflightTasks.push_back( task );
+    }
+    catch( ... )
+    {
+        delete task;
+
+        throw;
+    }
+
+    {
+        NativeExecutive::CReadWriteWriteContext <> ctxPutTask( this->lockQueue );
+
+        this->pendingTasks.push_back( task );
+
+        if ( this->hasWriter )
+        {
+            this->writeTasks.push_back( task );
+        }
+
+        this->condHasTasks->Signal();
+    }
+
+    // Output whatever is done already.
+    this->CommitFinishedTasks();
+}
+
+void ToolWorkerPool::CommitFinishedTasks( void )
+{
+    while ( this->inflightTasks.empty() == false )
+    {
+        bool isFinished;
+        {
+            NativeExecutive::CReadWriteWriteContext <> ctxCheckTask( this->lockQueue );
+
+            isFinished = this->inflightTasks.front()->isFinished;
+        }
+
+        if ( isFinished == false )
+        {
+            break;
+        }
+
+        this->CommitOldestTask();
+    }
+}
+
+void ToolWorkerPool::Flush( void )
+{
+    while ( this->inflightTasks.empty() == false )
+    {
+        this->CommitOldestTask();
+    }
+}
+
+void ToolWorkerPool::CommitOldestTask( void )
+{
+    if ( this->inflightTasks.empty() )
+        return;
+
+    ToolWorkerTask *task = this->inflightTasks.front();
+
+    {
+        NativeExecutive::CReadWriteWriteContextSafe <> ctxWaitTask( this->lockQueue );
+
+        while ( task->isFinished == false )
+        {
+            this->condTaskFinished->Wait( ctxWaitTask );
+        }
+    }
+
+    this->inflightTasks.pop_front();
+
+    try
+    {
+        if ( task->error )
+        {
+            std::rethrow_exception( task->error );
+        }
+
+        task->Commit();
+    }
+    catch( ... )
+    {
+        delete task;
+
+        throw;
+    }
+
+    delete task;
+}
+
+unsigned int ToolWorkerPool::GetDefaultWorkerCount( void )
+{
+    unsigned int hardwareThreads = std::thread::hardware_concurrency();
+
+    if ( hardwareThreads == 0 )
+    {
+        hardwareThreads = 1;
+    }
+
+    return hardwareThreads;
+}
+
+ToolJobPool::ToolJobPool( rw::Interface *rwEngine, unsigned int helperCount, workerInit_t initCB, void *ud )
+    : ToolThreadGroup( rwEngine, initCB, ud )
+{
+    NativeExecutive::CExecutiveManager *nativeExec = this->nativeExec;
+
+    if ( helperCount == 0 )
+    {
+        helperCount = 1;
+    }
+
+    this->condHasJobs = nativeExec->CreateConditionVariable();
+    this->condBatchFinished = nativeExec->CreateConditionVariable();
+
+    try
+    {
+        for ( unsigned int n = 0; n < helperCount; n++ )
+        {
+            this->SpawnThread( 0 );
+        }
+    }
+    catch( ... )
+    {
+        this->Shutdown();
+
+        throw;
+    }
+}
+
+ToolJobPool::~ToolJobPool( void )
+{
+    this->Shutdown();
+}
+
+void ToolJobPool::OnTerminate( void )
+{
+    this->condHasJobs->Signal();
+}
+
+void ToolJobPool::Shutdown( void )
+{
+    this->TerminateThreads();
+
+    NativeExecutive::CExecutiveManager *nativeExec = this->nativeExec;
+
+    nativeExec->CloseConditionVariable( this->condBatchFinished );
+    nativeExec->CloseConditionVariable( this->condHasJobs );
+}
+
+void ToolJobPool::RunThread( rw::Interface *rwEngine, unsigned int role )
+{
+    while ( true )
+    {
+        jobBatch *batch = nullptr;
+        size_t jobIndex = 0;
+        {
+            NativeExecutive::CReadWriteWriteContextSafe <> ctxFetchJob( this->lockQueue );
+
+            while ( this->isTerminating == false && this->openBatches.empty() )
+            {
+                this->condHasJobs->Wait( ctxFetchJob );
+            }
+
+            if ( this->isTerminating )
+            {
+                break;
+            }
+
+            batch = this->openBatches.front();
+
+            jobIndex = batch->nextJob++;
+
+            // Once all jobs are handed out, the batch is no longer open.
+            if ( batch->nextJob == batch->jobCount )
+            {
+                this->openBatches.pop_front();
+            }
+        }
+
+        try
+        {
+            batch->cb( rwEngine, jobIndex, batch->ud );
+        }
+        catch( ... )
+        {
+            batch->errors[ jobIndex ] = std::current_exception();
+        }
+
+        {
+            NativeExecutive::CReadWriteWriteContext <> ctxFinishJob( this->lockQueue );
+
+            batch->numFinished++;
+
+            if ( batch->numFinished == batch->jobCount )
+            {
+                this->condBatchFinished->Signal();
+            }
+        }
+    }
+}
+
+void ToolJobPool::RunJobs( size_t jobCount, jobRuntime_t cb, void *ud )
+{
+    if ( jobCount == 0 )
+        return;
+
+    jobBatch batch;
+    batch.cb = cb;
+    batch.ud = ud;
+    batch.jobCount = jobCount;
+    batch.nextJob = 0;
+    batch.numFinished = 0;
+    batch.errors.resize( jobCount );
+
+    std::exception_ptr interruption;
+    {
+        NativeExecutive::CReadWriteWriteContextSafe <> ctxRunBatch( this->lockQueue );
+
+        this->openBatches.push_back( &batch );
+
+        this->condHasJobs->Signal();
+
+        try
+        {
+            while ( batch.numFinished != batch.jobCount )
+            {
+                this->condBatchFinished->Wait( ctxRunBatch );
+            }
+        }
+        catch( ... )
+        {
+            // We were interrupted; jobs that were not handed out yet must not run anymore.
+            if ( batch.nextJob != batch.jobCount )
+            {
+                this->openBatches.remove( &batch );
+
+                batch.jobCount = batch.nextJob;
+            }
+
+            interruption = std::current_exception();
+        }
+    }
+
+    if ( interruption )
+    {
+        // Jobs that are running right now still reference the batch, so we have to wait for them.
+        // Waiting on the condition variable is not possible anymore on an interrupted thread.
+        while ( true )
+        {
+            {
+                NativeExecutive::CReadWriteWriteContext <> ctxCheckBatch( this->lockQueue );
+
+                if ( batch.numFinished == batch.jobCount )
+                    break;
+            }
+
+            std::this_thread::yield();
+        }
+
+        std::rethrow_exception( interruption );
+    }
+
+    // Report the first error, so that the result does not depend on timing.
+    for ( std::exception_ptr& error : batch.errors )
+    {
+        if ( error )
+        {
+            std::rethrow_exception( error );
+        }
+    }
+}
+
+ToolBackgroundWriter::ToolBackgroundWriter( rw::Interface *rwEngine, size_t maxQueuedJobs, workerInit_t initCB, void *ud )
+    : ToolThreadGroup( rwEngine, initCB, ud )
+{
+    NativeExecutive::CExecutiveManager *nativeExec = this->nativeExec;
+
+    if ( maxQueuedJobs == 0 )
+    {
+        maxQueuedJobs = 1;
+    }
+
+    this->hasQuit = false;
+    this->isBusy = false;
+    this->maxQueuedJobs = maxQueuedJobs;
+
+    this->condHasJobs = nativeExec->CreateConditionVariable();
+    this->condJobTaken = nativeExec->CreateConditionVariable();
+    this->condIdle = nativeExec->CreateConditionVariable();
+
+    try
+    {
+        this->SpawnThread( 0 );
+    }
+    catch( ... )
+    {
+        this->Shutdown();
+
+        throw;
+    }
+}
+
+ToolBackgroundWriter::~ToolBackgroundWriter( void )
+{
+    this->Shutdown();
+}
+
+void ToolBackgroundWriter::OnTerminate( void )
+{
+    this->condHasJobs->Signal();
+    this->condJobTaken->Signal();
+    this->condIdle->Signal();
+}
+
+void ToolBackgroundWriter::Shutdown( void )
+{
+    this->TerminateThreads();
+
+    for ( ToolBackgroundJob *job : this->queuedJobs )
+    {
+        delete job;
+    }
+
+    this->queuedJobs.clear();
+
+    NativeExecutive::CExecutiveManager *nativeExec = this->nativeExec;
+
+    nativeExec->CloseConditionVariable( this->condIdle );
+    nativeExec->CloseConditionVariable( this->condJobTaken );
+    nativeExec->CloseConditionVariable( this->condHasJobs );
+}
+
+void ToolBackgroundWriter::RunThread( rw::Interface *rwEngine, unsigned int role )
+{
+    while ( true )
+    {
+        ToolBackgroundJob *job = nullptr;
+        {
+            NativeExecutive::CReadWriteWriteContextSafe <> ctxFetchJob( this->lockQueue );
+
+            while ( this->isTerminating == false && this->queuedJobs.empty() )
+            {
+                this->condHasJobs->Wait( ctxFetchJob );
+            }
+
+            if ( this->isTerminating )
+            {
+                break;
+            }
+
+            job = this->queuedJobs.front();
+
+            this->queuedJobs.pop_front();
+
+            this->isBusy = true;
+
+            this->condJobTaken->Signal();
+        }
+
+        try
+        {
+            job->Run( rwEngine );
+        }
+        catch( rw::RwException& )
+        {
+            // Nobody waits for the result, so errors of a job are not fatal.
+        }
+        catch( ... )
+        {
+            delete job;
+
+            throw;
+        }
+
+        delete job;
+
+        {
+            NativeExecutive::CReadWriteWriteContext <> ctxFinishJob( this->lockQueue );
+
+            this->isBusy = false;
+
+            if ( this->queuedJobs.empty() )
+            {
+                this->condIdle->Signal();
+            }
+        }
+    }
+}
+
+void ToolBackgroundWriter::OnThreadQuit( unsigned int role )
+{
+    // Nobody must wait for us anymore.
+    NativeExecutive::CReadWriteWriteContext <> ctxQuit( this->lockQueue );
+
+    this->hasQuit = true;
+    this->isBusy = false;
+
+    this->condJobTaken->Signal();
+    this->condIdle->Signal();
+}
+
+void ToolBackgroundWriter::SubmitJob( ToolBackgroundJob *job )
+{
+    try
+    {
+        NativeExecutive::CReadWriteWriteContextSafe <> ctxPutJob( this->lockQueue );
+
+        while ( this->isTerminating == false && this->hasQuit == false && this->queuedJobs.size() >= this->maxQueuedJobs )
+        {
+            this->condJobTaken->Wait( ctxPutJob );
+        }
+
+        if ( this->isTerminating || this->hasQuit )
+        {
+            // The job would never run.
+            delete job;
+
+            return;
+        }
+
+        this->queuedJobs.push_back( job );
+
+        this->condHasJobs->Signal();
+    }
+    catch( ... )
+    {
+        delete job;
+
+        throw;
+    }
+}
+
+void ToolBackgroundWriter::Flush( void )
+{
+    NativeExecutive::CReadWriteWriteContextSafe <> ctxWaitIdle( this->lockQueue );
+
+    while ( this->hasQuit == false && ( this->queuedJobs.empty() == false || this->isBusy ) )
+    {
+        this->condIdle->Wait( ctxWaitIdle );
+    }
+}
@@ -0,0 +1,263 @@
+// Worker thread pool for the mass processing tools.
+// Tasks are executed concurrently but committed in the order they were submitted,
+// so the output of a tool does not depend on the amount of workers.
+// Optionally there is a writer thread that runs the last stage of each task in
+// submission order, so that writing to disk overlaps with the work of the next tasks.
+
+#pragma once
+
+#include <NativeExecutive/CExecutiveManager.h>
+
+#include <list>
+#include <vector>
+#include <exception>
+
+struct ToolWorkerTask abstract
+{
+    inline ToolWorkerTask( void )
+    {
+        this->isExecuted = false;
+        this->isFinished = false;
+    }
+
+    virtual ~ToolWorkerTask( void )
+    {
+        return;
+    }
+
+    // Called on a worker thread.
+    virtual void Execute( rw::Interface *rwEngine ) = 0;
+
+    // Called on the writer thread in submission order, after Execute.
+    // Only used if the pool has a writer thread.
+    virtual void Write( rw::Interface *rwEngine )
+    {
+        return;
+    }
+
+    // Called on the thread that submitted the task, in submission order.
+    virtual void Commit( void ) = 0;
+
+private:
+    friend struct ToolWorkerPool;
+
+    bool isExecuted;
+    bool isFinished;
+    std::exception_ptr error;
+};
+
+// Common part of the thread sets below.
+// Each thread gets its own RenderWare runtime configuration and quits when the group is terminated.
+// The queue of the derived group is protected by lockQueue.
+struct ToolThreadGroup abstract
+{
+    // Called on each thread after it has received its own RenderWare runtime configuration.
+    typedef void (*workerInit_t)( rw::Interface *rwEngine, void *ud );
+
+protected:
+    ToolThreadGroup( rw::Interface *rwEngine, workerInit_t initCB, void *ud );
+    ~ToolThreadGroup( void );
+
+    // Threads of different roles run different loops.
+    void SpawnThread( unsigned int role );
+
+    // Asks all threads to quit and waits for them.
+    // Has to be called by the derived group before it goes away.
+    void TerminateThreads( void );
+
+    // Called on a thread of the group; returns or throws once the group is terminating.
+    virtual void RunThread( rw::Interface *rwEngine, unsigned int role ) = 0;
+
+    // Called with lockQueue held when the group starts to terminate, to wake up waiting threads.
+    virtual void OnTerminate( void ) = 0;
+
+    // Called on a thread of the group right before it quits.
+    virtual void OnThreadQuit( unsigned int role )
+    {
+        return;
+    }
+
+    rw::Interface *rwEngine;
+
+    NativeExecutive::CExecutiveManager *nativeExec;
+
+    NativeExecutive::CReadWriteLock *lockQueue;
+
+    bool isTerminating;
+
+private:
+    static void _threadEntry( rw::thread_t threadHandle, rw::Interface *rwEngine, void *ud );
+
+    struct threadSlot
+    {
+        ToolThreadGroup *group;
+        unsigned int role;
+        rw::thread_t handle;
+    };
+
+    workerInit_t initCB;
+    void *initUD;
+
+    std::list <threadSlot> threads;
+};
+
+struct ToolWorkerPool : public ToolThreadGroup
+{
+    ToolWorkerPool( rw::Interface *rwEngine, unsigned int workerCount, workerInit_t initCB, void *ud, bool hasWriter = false );
+    ~ToolWorkerPool( void );
+
+    // Limits the amount of tasks that are not committed yet and the amount of executed tasks
+    // that wait for the writer thread. Zero means the default.
+    void SetQueueDepths( size_t maxInflightTasks, size_t maxPendingWrites );
+
+    // The pool takes ownership of the task.
+    void SubmitTask( ToolWorkerTask *task );
+
+    // Commits all tasks at the front of the queue that have finished already.
+    void CommitFinishedTasks( void );
+
+    // Waits for the oldest task and commits it.
+    void CommitOldestTask( void );
+
+    // Waits for all submitted tasks and commits them.
+    void Flush( void );
+
+    inline unsigned int GetWorkerCount( void ) const
+    {
+        return this->workerCount;
+    }
+
+    inline size_t GetInflightTaskCount( void ) const
+    {
+        return this->inflightTasks.size();
+    }
+
+    // Returns the amount of workers that should be used if the user did not specify any.
+    static unsigned int GetDefaultWorkerCount( void );
+
+private:
+    enum eThreadRole
+    {
+        THREAD_WORKER,
+        THREAD_WRITER
+    };
+
+    void RunThread( rw::Interface *rwEngine, unsigned int role ) override;
+    void OnTerminate( void ) override;
+
+    void RunWorker( rw::Interface *rwEngine );
+    void RunWriter( rw::Interface *rwEngine );
+
+    void Shutdown( void );
+
+    NativeExecutive::CCondVar *condHasTasks;
+    NativeExecutive::CCondVar *condTaskExecuted;
+    NativeExecutive::CCondVar *condTaskFinished;
+
+    // Tasks that have not been picked up by a worker yet.
+    std::list <ToolWorkerTask*> pendingTasks;
+
+    // Tasks that still have to go through the writer thread, in submission order.
+    std::list <ToolWorkerTask*> writeTasks;
+
+    // Amount of executed tasks that wait for the writer thread.
+    size_t numPendingWrites;
+
+    // All tasks that have not been committed yet, in submission order.
+    // Only accessed by the submitting thread.
+    std::list <ToolWorkerTask*> inflightTasks;
+
+    size_t maxInflightTasks;
+    size_t maxPendingWrites;
+
+    unsigned int workerCount;
+    bool hasWriter;
+};
+
+// Runs the independent jobs of a batch on a set of helper threads and waits for them.
+// Batches may be started from any thread at the same time, for example to process the
+// textures of a TXD while other TXDs are processed by a ToolWorkerPool.
+struct ToolJobPool : public ToolThreadGroup
+{
+    // Called on a helper thread for each job of a batch.
+    typedef void (*jobRuntime_t)( rw::Interface *rwEngine, size_t jobIndex, void *ud );
+
+    ToolJobPool( rw::Interface *rwEngine, unsigned int helperCount, workerInit_t initCB, void *ud );
+    ~ToolJobPool( void );
+
+    // Blocks until all jobs have finished.
+    // If jobs failed then the error of the first failed job is rethrown.
+    void RunJobs( size_t jobCount, jobRuntime_t cb, void *ud );
+
+private:
+    void RunThread( rw::Interface *rwEngine, unsigned int role ) override;
+    void OnTerminate( void ) override;
+
+    void Shutdown( void );
+
+    struct jobBatch
+    {
+        jobRuntime_t cb;
+        void *ud;
+
+        size_t jobCount;
+        size_t nextJob;
+        size_t numFinished;
+
+        std::vector <std::exception_ptr> errors;
+    };
+
+    NativeExecutive::CCondVar *condHasJobs;
+    NativeExecutive::CCondVar *condBatchFinished;
+
+    // Batches that still have jobs to hand out.
+    std::list <jobBatch*> openBatches;
+};
+
+// Work that is handed to a ToolBackgroundWriter.
+struct ToolBackgroundJob abstract
+{
+    virtual ~ToolBackgroundJob( void )
+    {
+        return;
+    }
+
+    // Called on the background thread; the job is deleted afterwards.
+    virtual void Run( rw::Interface *rwEngine ) = 0;
+};
+
+// Runs jobs on a single background thread in submission order, for output that nobody
+// has to wait for, like debug images. The queue is bounded, so that a slow disk slows
+// down the submitting threads instead of piling up memory.
+struct ToolBackgroundWriter : public ToolThreadGroup
+{
+    ToolBackgroundWriter( rw::Interface *rwEngine, size_t maxQueuedJobs, workerInit_t initCB, void *ud );
+
+    // Jobs that did not run yet are thrown away; call Flush before if they matter.
+    ~ToolBackgroundWriter( void );
+
+    // The writer takes ownership of the job.
+    // May be called from any thread; blocks while the queue is full.
+    void SubmitJob( ToolBackgroundJob *job );
+
+    // Waits until all submitted jobs have run.
+    void Flush( void );
+
+private:
+    void RunThread( rw::Interface *rwEngine, unsigned int role ) override;
+    void OnTerminate( void ) override;
+    void OnThreadQuit( unsigned int role ) override;
+
+    void Shutdown( void );
+
+    NativeExecutive::CCondVar *condHasJobs;
+    NativeExecutive::CCondVar *condJobTaken;
+    NativeExecutive::CCondVar *condIdle;
+
+    bool hasQuit;
+    bool isBusy;
+
+    std::list <ToolBackgroundJob*> queuedJobs;
+
+    size_t maxQueuedJobs;
+};